@@ -23,6 +23,7 @@ THE SOFTWARE.
 #include <math.h>
 
 #include <grrlib.h>
+#include "grrlib/GRRLIB_private.h"
 
 // User should not directly modify these
 Mtx       _GRR_view;  // Should be static as soon as all light functions needing this var will be in this file ;)
@@ -85,6 +86,8 @@ void GRRLIB_Camera3dSettings(f32 posx, f32 posy, f32 posz,
 void GRRLIB_3dMode(f32 minDist, f32 maxDist, f32 fov, bool texturemode, bool normalmode) {
     Mtx m;
 
+    GRRLIB_BatchMode2D(false);
+
     guLookAt(_GRR_view, &_GRR_cam, &_GRR_up, &_GRR_look);
     guPerspective(m, fov, (f32)rmode->fbWidth/rmode->efbHeight, minDist, maxDist);
     GX_LoadProjectionMtx(m, GX_PERSPECTIVE);
@@ -113,6 +116,8 @@ void GRRLIB_3dMode(f32 minDist, f32 maxDist, f32 fov, bool texturemode, bool nor
 void GRRLIB_2dMode() {
     Mtx view, m;
 
+    GRRLIB_BatchMode2D(true);
+
     GX_SetZMode(GX_FALSE, GX_LEQUAL, GX_TRUE);
 
     GX_SetBlendMode(GX_BM_BLEND, GX_BL_SRCALPHA, GX_BL_INVSRCALPHA, GX_LO_CLEAR);
@@ -132,6 +137,11 @@ void GRRLIB_2dMode() {
     GX_SetVtxAttrFmt(GX_VTXFMT0, GX_VA_CLR0, GX_CLR_RGBA, GX_RGBA8, 0);
     GX_SetVtxAttrFmt(GX_VTXFMT0, GX_VA_TEX0, GX_TEX_ST, GX_F32, 0);
 
+    // Compact 2D format: positions in 1/16 pixel, texture coordinates in 1/32768
+    GX_SetVtxAttrFmt(GRRLIB_VTXFMT_S16, GX_VA_POS,  GX_POS_XY, GX_S16, GRRLIB_POS_FRAC);
+    GX_SetVtxAttrFmt(GRRLIB_VTXFMT_S16, GX_VA_TEX0, GX_TEX_ST, GX_U16, GRRLIB_TEX_FRAC);
+    GX_SetVtxAttrFmt(GRRLIB_VTXFMT_S16, GX_VA_CLR0, GX_CLR_RGBA, GX_RGBA8, 0);
+
     GX_SetNumTexGens(1);  // One texture exists
     GX_SetTevOp(GX_TEVSTAGE0, GX_PASSCLR);
     GX_SetTevOrder(GX_TEVSTAGE0, GX_TEXCOORD0, GX_TEXMAP0, GX_COLOR0A0);
@@ -152,6 +162,8 @@ void GRRLIB_2dMode() {
  * Init the object matrix to draw object.
  */
 void GRRLIB_ObjectViewBegin(void) {
+    GRRLIB_FlushPrimitives();
+
     guMtxIdentity(_ObjTransformationMtx);
 }
 
@@ -164,6 +176,8 @@ void GRRLIB_ObjectViewBegin(void) {
 void GRRLIB_ObjectViewScale(f32 scalx, f32 scaly, f32 scalz) {
     Mtx m;
 
+    GRRLIB_FlushPrimitives();
+
     guMtxIdentity(m);
     guMtxScaleApply(m, m, scalx, scaly, scalz);
 
@@ -179,6 +193,8 @@ void GRRLIB_ObjectViewScale(f32 scalx, f32 scaly, f32 scalz) {
 void GRRLIB_ObjectViewRotate(f32 angx, f32 angy, f32 angz) {
     Mtx m, rx,ry,rz;
 
+    GRRLIB_FlushPrimitives();
+
     guMtxIdentity(m);
     guMtxRotAxisDeg(rx, &_GRRaxisx, angx);
     guMtxRotAxisDeg(ry, &_GRRaxisy, angy);
@@ -198,6 +214,8 @@ void GRRLIB_ObjectViewRotate(f32 angx, f32 angy, f32 angz) {
 void GRRLIB_ObjectViewTrans(f32 posx, f32 posy, f32 posz) {
     Mtx m;
 
+    GRRLIB_FlushPrimitives();
+
     guMtxIdentity(m);
     guMtxTransApply(m, m, posx, posy, posz);
 
@@ -210,6 +228,8 @@ void GRRLIB_ObjectViewTrans(f32 posx, f32 posy, f32 posz) {
 void GRRLIB_ObjectViewEnd(void) {
     Mtx mv, mvi;
 
+    GRRLIB_BatchMode2D(false);
+
     guMtxConcat(_GRR_view, _ObjTransformationMtx, mv);
     GX_LoadPosMtxImm(mv, GX_PNMTX0);
 
@@ -235,6 +255,8 @@ void GRRLIB_ObjectView(f32 posx, f32 posy, f32 posz, f32 angx, f32 angy, f32 ang
     Mtx m, rx,ry,rz;
     Mtx mv, mvi;
 
+    GRRLIB_BatchMode2D(false);
+
     guMtxIdentity(ObjTransformationMtx);
 
     if((scalx !=1.0f) || (scaly !=1.0f) || (scalz !=1.0f)) {
@@ -287,6 +309,8 @@ void GRRLIB_ObjectViewInv(f32 posx, f32 posy, f32 posz, f32 angx, f32 angy, f32
     Mtx m, rx,ry,rz;
     Mtx mv, mvi;
 
+    GRRLIB_BatchMode2D(false);
+
     guMtxIdentity(ObjTransformationMtx);
 
     if((scalx !=1.0f) || (scaly !=1.0f) || (scalz !=1.0f)) {
@@ -330,11 +354,13 @@ void GRRLIB_ObjectViewInv(f32 posx, f32 posy, f32 posz, f32 angx, f32 angy, f32
 void GRRLIB_SetTexture(GRRLIB_texImg *tex, bool rep) {
     GXTexObj  texObj;
 
+    GRRLIB_FlushPrimitives();
+
     if (rep) {
-        GX_InitTexObj(&texObj, tex->data, tex->w, tex->h, GX_TF_RGBA8, GX_REPEAT, GX_REPEAT, GX_FALSE);
+        GX_InitTexObj(&texObj, tex->data, tex->w, tex->h, GRRLIB_TexFmtGX(tex->format), GX_REPEAT, GX_REPEAT, GX_FALSE);
     }
     else {
-        GX_InitTexObj(&texObj, tex->data, tex->w, tex->h, GX_TF_RGBA8, GX_CLAMP, GX_CLAMP, GX_FALSE);
+        GX_InitTexObj(&texObj, tex->data, tex->w, tex->h, GRRLIB_TexFmtGX(tex->format), GX_CLAMP, GX_CLAMP, GX_FALSE);
     }
     if (GRRLIB_Settings.antialias == false) {
         GX_InitTexObjLOD(&texObj, GX_NEAR, GX_NEAR, 0.0f, 0.0f, 0.0f, 0, 0, GX_ANISO_1);
@@ -366,6 +392,8 @@ void GRRLIB_DrawTorus(f32 r, f32 R, int nsides, int rings, bool filled, u32 col)
     f32 ringDelta, sideDelta;
     f32 cosPhi, sinPhi, dist;
 
+    GRRLIB_FlushPrimitives();
+
     ringDelta = 2.0 * M_PI / rings;
     sideDelta = 2.0 * M_PI / nsides;
 
@@ -393,6 +421,7 @@ void GRRLIB_DrawTorus(f32 r, f32 R, int nsides, int rings, bool filled, u32 col)
             GX_Color1u32(col);
         }
         GX_End();
+        GRRLIB_FifoSample();
         theta = theta1;
         cosTheta = cosTheta1;
         sinTheta = sinTheta1;
@@ -413,6 +442,8 @@ void GRRLIB_DrawSphere(f32 r, int lats, int longs, bool filled, u32 col) {
         lat1, z1, zr1,
         lng, x, y;
 
+    GRRLIB_FlushPrimitives();
+
     for(i = 0; i <= lats; i++) {
         lat0 = M_PI * (-0.5F + (f32) (i - 1) / lats);
         z0  = sin(lat0);
@@ -436,6 +467,7 @@ void GRRLIB_DrawSphere(f32 r, int lats, int longs, bool filled, u32 col) {
             GX_Color1u32(col);
         }
         GX_End();
+        GRRLIB_FifoSample();
     }
 }
 
@@ -467,6 +499,8 @@ void GRRLIB_DrawCube(f32 size, bool filled, u32 col) {
     f32 v[8][3];
     int i;
 
+    GRRLIB_FlushPrimitives();
+
     v[0][0] = v[1][0] = v[2][0] = v[3][0] = -size / 2;
     v[4][0] = v[5][0] = v[6][0] = v[7][0] = size / 2;
     v[0][1] = v[1][1] = v[4][1] = v[5][1] = -size / 2;
@@ -495,6 +529,7 @@ void GRRLIB_DrawCube(f32 size, bool filled, u32 col) {
             GX_Color1u32(col);
         }
         GX_End();
+        GRRLIB_FifoSample();
     }
 }
 
@@ -510,6 +545,8 @@ void GRRLIB_DrawCylinder(f32 r, f32 h, int d, bool filled, u32 col) {
     int i;
     f32 dx, dy;
 
+    GRRLIB_FlushPrimitives();
+
     if(filled) GX_Begin(GX_TRIANGLESTRIP, GX_VTXFMT0, 2 * (d+1));
     else       GX_Begin(GX_LINESTRIP, GX_VTXFMT0, 2 * (d+1));
     for(i = 0 ; i <= d ; i++) {
@@ -523,6 +560,7 @@ void GRRLIB_DrawCylinder(f32 r, f32 h, int d, bool filled, u32 col) {
         GX_Color1u32(col);
     }
     GX_End();
+    GRRLIB_FifoSample();
 
     if(filled) GX_Begin(GX_TRIANGLEFAN, GX_VTXFMT0, d+2);
     else       GX_Begin(GX_LINESTRIP, GX_VTXFMT0, d+2);
@@ -535,6 +573,7 @@ void GRRLIB_DrawCylinder(f32 r, f32 h, int d, bool filled, u32 col) {
         GX_Color1u32(col);
     }
     GX_End();
+    GRRLIB_FifoSample();
 
     if(filled) GX_Begin(GX_TRIANGLEFAN, GX_VTXFMT0, d+2);
     else       GX_Begin(GX_LINESTRIP, GX_VTXFMT0, d+2);
@@ -547,6 +586,7 @@ void GRRLIB_DrawCylinder(f32 r, f32 h, int d, bool filled, u32 col) {
         GX_Color1u32(col);
     }
     GX_End();
+    GRRLIB_FifoSample();
 }
 
 /**
@@ -561,6 +601,8 @@ void GRRLIB_DrawCone(f32 r, f32 h, int d, bool filled, u32 col) {
     int i;
     f32 dx, dy;
 
+    GRRLIB_FlushPrimitives();
+
     if(filled) GX_Begin(GX_TRIANGLESTRIP, GX_VTXFMT0, 2 * (d+1));
     else       GX_Begin(GX_LINESTRIP, GX_VTXFMT0, 2 * (d+1));
     for(i = 0 ; i <= d ; i++) {
@@ -574,6 +616,7 @@ void GRRLIB_DrawCone(f32 r, f32 h, int d, bool filled, u32 col) {
         GX_Color1u32(col);
     }
     GX_End();
+    GRRLIB_FifoSample();
 
     if(filled) GX_Begin(GX_TRIANGLEFAN, GX_VTXFMT0, d+2);
     else       GX_Begin(GX_LINESTRIP, GX_VTXFMT0, d+2);
@@ -586,6 +629,7 @@ void GRRLIB_DrawCone(f32 r, f32 h, int d, bool filled, u32 col) {
         GX_Color1u32(col);
     }
     GX_End();
+    GRRLIB_FifoSample();
 }
 
 /**
@@ -601,6 +645,8 @@ void GRRLIB_DrawTessPanel(f32 w, f32 wstep, f32 h, f32 hstep, bool filled, u32 c
     f32 x, y, tmpx, tmpy;
     int tmp;
 
+    GRRLIB_FlushPrimitives();
+
     tmpy = h/2.0f;
     tmpx = w/2.0f;
     tmp = ((w/wstep)*2)+2;
@@ -618,6 +664,7 @@ void GRRLIB_DrawTessPanel(f32 w, f32 wstep, f32 h, f32 hstep, bool filled, u32 c
             GX_Color1u32(col);
         }
         GX_End();
+        GRRLIB_FifoSample();
     }
 }
 
@@ -627,6 +674,8 @@ void GRRLIB_DrawTessPanel(f32 w, f32 wstep, f32 h, f32 hstep, bool filled, u32 c
  * @param ambientcolor Ambient color in RGBA format.
  */
 void GRRLIB_SetLightAmbient(u32 ambientcolor) {
+    GRRLIB_FlushPrimitives();
+
     GX_SetChanAmbColor(GX_COLOR0A0, (GXColor) { R(ambientcolor), G(ambientcolor), B(ambientcolor), 0xFF});
 }
 
@@ -642,6 +691,8 @@ void GRRLIB_SetLightDiff(u8 num, guVector pos, f32 distattn, f32 brightness, u32
     GXLightObj MyLight;
     guVector lpos = {pos.x, pos.y, pos.z};
 
+    GRRLIB_FlushPrimitives();
+
     GRRLIB_Settings.lights |= (1<<num);
 
     guVecMultiply(_GRR_view, &lpos, &lpos);
@@ -669,6 +720,8 @@ void GRRLIB_SetLightSpec(u8 num, guVector dir, f32 shy, u32 lightcolor, u32 spec
     GXLightObj MyLight;
     guVector ldir = {dir.x, dir.y, dir.z};
 
+    GRRLIB_FlushPrimitives();
+
     GRRLIB_Settings.lights |= (1<<num);
 
     guMtxInverse(_GRR_view,mr);
@@ -717,6 +770,9 @@ void GRRLIB_SetLightSpot(u8 num, guVector pos, guVector lookat, f32 angAttn0, f3
     GXLightObj lobj;
     guVector lpos = (guVector){ pos.x, pos.y, pos.z };
     guVector ldir = (guVector){ lookat.x-pos.x, lookat.y-pos.y, lookat.z-pos.z };
+
+    GRRLIB_FlushPrimitives();
+
     guVecNormalize(&ldir);
 
     GRRLIB_Settings.lights |= (1<<num);
@@ -744,6 +800,8 @@ void GRRLIB_SetLightSpot(u8 num, guVector pos, guVector lookat, f32 angAttn0, f3
  * Set all lights off, like at init.
  */
 void GRRLIB_SetLightOff(void) {
+    GRRLIB_FlushPrimitives();
+
     GX_SetNumTevStages(1);
 
     GX_SetTevOp  (GX_TEVSTAGE0, GX_PASSCLR);
@@ -20,44 +20,559 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 THE SOFTWARE.
 ------------------------------------------------------------------------------*/
 
+#include <math.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <grrlib.h>
+#include "grrlib/GRRLIB_private.h"
 
 /**
- * Flip texture horizontal.
+ * Read a horizontal run of pixels from a texture.
+ * The 4x4 tile layout is walked incrementally, so the tiled address is
+ * only computed once for the whole run. Colours of a premultiplied texture
+ * are returned unpremultiplied, and a texture that is not in
+ * GRRLIB_TEXFMT_RGBA8 reads as transparent black.
+ * @param tex The texture to read from.
+ * @param x The x-coordinate of the first pixel.
+ * @param y The y-coordinate of the run.
+ * @param n Number of pixels to read.
+ * @param row Destination array of n colours in RGBA format.
+ */
+void  GRRLIB_ReadTexRow (const GRRLIB_texImg *tex, const int x, const int y,
+                         const uint n, u32 *row) {
+    const u8  *bp = (const u8*)tex->data
+                  + (((y&(~3))<<2)*tex->w) + ((x&(~3))<<4) + ((y&3)<<3);
+    uint      p   = (x&3)<<1;
+    uint      i;
+
+    if (tex->format != GRRLIB_TEXFMT_RGBA8) {
+        memset(row, 0, n * sizeof(u32));
+        return;
+    }
+    for (i = 0; i < n; i++) {
+        row[i] = RGBA(bp[p+1], bp[p+32], bp[p+33], bp[p]);
+        if ((p += 2) == 8) {
+            p = 0;
+            bp += 64;
+        }
+    }
+    if (tex->premult) {
+        for (i = 0; i < n; i++)  row[i] = GRRLIB_Unpremultiply(row[i]);
+    }
+}
+
+/**
+ * Write a horizontal run of pixels to a texture.
+ * The colours are premultiplied if the texture is. Nothing is written to a
+ * texture that is not in GRRLIB_TEXFMT_RGBA8.
  * @see GRRLIB_FlushTex
+ * @param tex The texture to write to.
+ * @param x The x-coordinate of the first pixel.
+ * @param y The y-coordinate of the run.
+ * @param n Number of pixels to write.
+ * @param row Array of n colours in RGBA format.
+ */
+void  GRRLIB_WriteTexRow (GRRLIB_texImg *tex, const int x, const int y,
+                          const uint n, const u32 *row) {
+    u8    *bp = (u8*)tex->data
+              + (((y&(~3))<<2)*tex->w) + ((x&(~3))<<4) + ((y&3)<<3);
+    uint  p   = (x&3)<<1;
+    uint  i;
+
+    if (tex->format != GRRLIB_TEXFMT_RGBA8)  return;
+    for (i = 0; i < n; i++) {
+        const u32  c = tex->premult ? GRRLIB_Premultiply(row[i]) : row[i];
+        bp[p   ] = A(c);
+        bp[p+ 1] = R(c);
+        bp[p+32] = G(c);
+        bp[p+33] = B(c);
+        if ((p += 2) == 8) {
+            p = 0;
+            bp += 64;
+        }
+    }
+}
+
+/**
+ * Check that the CPU can edit the textures of an operation.
  * @param texsrc The texture source.
  * @param texdest The texture destination.
+ * @return true if both textures are in GRRLIB_TEXFMT_RGBA8.
  */
-void  GRRLIB_BMFX_FlipH (const GRRLIB_texImg *texsrc, GRRLIB_texImg *texdest) {
-    unsigned int x, y, txtWidth = texsrc->w - 1;
+static inline
+bool  BMFX_Editable (const GRRLIB_texImg *texsrc, const GRRLIB_texImg *texdest) {
+    return texsrc->format  == GRRLIB_TEXFMT_RGBA8 &&
+           texdest->format == GRRLIB_TEXFMT_RGBA8;
+}
+
+/**
+ * Check a region operation and protect it against overlapping areas.
+ * The source rectangle must lie inside texsrc and the dw x dh destination
+ * area at (dx, dy) inside texdest. When both areas overlap at different
+ * positions of the same texture, the source rectangle is first copied to a
+ * temporary texture, and texsrc and rect are updated to point to the copy.
+ * @param texsrc Pointer to the texture source, may be replaced.
+ * @param texdest The texture destination.
+ * @param rect The source rectangle, may be replaced.
+ * @param dx The x-coordinate of the destination area.
+ * @param dy The y-coordinate of the destination area.
+ * @param dw The width of the destination area.
+ * @param dh The height of the destination area.
+ * @param copy Storage for the temporary texture, released by BMFX_End.
+ * @return true if the operation can proceed.
+ */
+static
+bool  BMFX_Begin (const GRRLIB_texImg **texsrc, GRRLIB_texImg *texdest,
+                  GRRLIB_rect *rect, const int dx, const int dy,
+                  const uint dw, const uint dh, GRRLIB_texImg *copy) {
+    const GRRLIB_texImg  *src = *texsrc;
+    u32                  *line;
+    uint                 j;
+
+    memset(copy, 0, sizeof(GRRLIB_texImg));
+    if (!BMFX_Editable(src, texdest))  return false;
+    if (rect->x < 0 || rect->y < 0 || rect->w == 0 || rect->h == 0 ||
+        rect->x + rect->w > src->w || rect->y + rect->h > src->h ||
+        dx < 0 || dy < 0 || dx + dw > texdest->w || dy + dh > texdest->h) {
+        return false;
+    }
+
+    if (src->data != texdest->data || (rect->x == dx && rect->y == dy) ||
+        rect->x >= dx + (int)dw || dx >= rect->x + (int)rect->w ||
+        rect->y >= dy + (int)dh || dy >= rect->y + (int)rect->h) {
+        return true;
+    }
+
+    copy->w    = (rect->w + 3) & ~3;
+    copy->h    = (rect->h + 3) & ~3;
+    copy->data = malloc(copy->w * copy->h * 4);
+    line       = malloc(rect->w * sizeof(u32));
+    if (copy->data == NULL || line == NULL) {
+        free(line);
+        free(copy->data);
+        copy->data = NULL;
+        return false;
+    }
+    for (j = 0; j < rect->h; j++) {
+        GRRLIB_ReadTexRow (src,  rect->x, rect->y + j, rect->w, line);
+        GRRLIB_WriteTexRow(copy, 0,       j,           rect->w, line);
+    }
+    free(line);
+
+    rect->x = 0;
+    rect->y = 0;
+    *texsrc = copy;
+    return true;
+}
+
+/**
+ * Finish a region operation started with BMFX_Begin.
+ * The temporary copy is released and the destination area is flushed.
+ * @param texdest The texture destination.
+ * @param dx The x-coordinate of the destination area.
+ * @param dy The y-coordinate of the destination area.
+ * @param dw The width of the destination area.
+ * @param dh The height of the destination area.
+ * @param copy The temporary texture filled by BMFX_Begin.
+ */
+static
+void  BMFX_End (GRRLIB_texImg *texdest, const int dx, const int dy,
+                const uint dw, const uint dh, GRRLIB_texImg *copy) {
+    const GRRLIB_rect  area = { dx, dy, dw, dh };
+
+    free(copy->data);
+    GRRLIB_FlushTexRect(texdest, &area);
+}
+
+/**
+ * Operation applied to every pixel of a run of 4x4 blocks.
+ * Each block holds 16 AR pairs followed by 16 GB pairs.
+ */
+typedef void (*BMFX_BlockOp) (const u8 *sp, u8 *dp, const uint nblocks,
+                              const void *ctx);
+
+/**
+ * Run a per pixel operation over a region.
+ * Tile aligned regions of straight alpha textures are processed in place,
+ * one row of blocks at a time. Otherwise each row is read (unpremultiplied),
+ * packed into whole blocks, processed and written back, the pixel order
+ * does not matter to these operations.
+ * @param texsrc The texture source.
+ * @param texdest The texture destination.
+ * @param rect The source rectangle.
+ * @param dx The x-coordinate of the destination area.
+ * @param dy The y-coordinate of the destination area.
+ * @param op The operation.
+ * @param ctx The operation parameters.
+ */
+static
+void  BMFX_PointOp (const GRRLIB_texImg *texsrc, GRRLIB_texImg *texdest,
+                    const GRRLIB_rect *rect, const int dx, const int dy,
+                    const BMFX_BlockOp op, const void *ctx) {
+    const uint  nb = (rect->w + 15) >> 4;
+    u32         *row;
+    u8          *blocks, *b;
+    uint        i, j;
+
+    if (!BMFX_Editable(texsrc, texdest))  return;
+
+    if (((rect->x | rect->y | rect->w | rect->h | dx | dy) & 3) == 0 &&
+        !texsrc->premult && !texdest->premult) {
+        const uint  sbw = texsrc->w >> 2;
+        const uint  dbw = texdest->w >> 2;
+        for (j = 0; j < rect->h >> 2; j++) {
+            op((const u8*)texsrc->data + ((((rect->y >> 2) + j)*sbw + (rect->x >> 2)) << 6),
+               (u8*)texdest->data      + ((((dy >> 2)      + j)*dbw + (dx >> 2))      << 6),
+               rect->w >> 2, ctx);
+        }
+        return;
+    }
+
+    row = malloc(rect->w * sizeof(u32) + nb * 64);
+    if (row == NULL)  return;
+    blocks = (u8*)(row + rect->w);
+    memset(blocks, 0, nb * 64);
+
+    for (j = 0; j < rect->h; j++) {
+        GRRLIB_ReadTexRow(texsrc, rect->x, rect->y + j, rect->w, row);
+        for (i = 0; i < rect->w; i++) {
+            b = blocks + ((i >> 4) << 6) + ((i & 15) << 1);
+            b[ 0] = A(row[i]);
+            b[ 1] = R(row[i]);
+            b[32] = G(row[i]);
+            b[33] = B(row[i]);
+        }
+        op(blocks, blocks, nb, ctx);
+        for (i = 0; i < rect->w; i++) {
+            b = blocks + ((i >> 4) << 6) + ((i & 15) << 1);
+            row[i] = RGBA(b[1], b[32], b[33], b[0]);
+        }
+        GRRLIB_WriteTexRow(texdest, dx, dy + j, rect->w, row);
+    }
+
+    free(row);
+}
+
+/**
+ * Block permutations supported by BMFX_Permute.
+ */
+enum {
+    BMFX_FLIPH = 0,
+    BMFX_FLIPV,
+    BMFX_ROT90,
+    BMFX_ROT180,
+    BMFX_ROT270,
+};
+
+/**
+ * Destination of each pixel of a 4x4 block, for each permutation.
+ */
+static const u8  BMFX_Shuffle[5][16] = {
+    {  3,  2,  1,  0,  7,  6,  5,  4, 11, 10,  9,  8, 15, 14, 13, 12 },  // FlipH,
+    { 12, 13, 14, 15,  8,  9, 10, 11,  4,  5,  6,  7,  0,  1,  2,  3 },  // FlipV,
+    {  3,  7, 11, 15,  2,  6, 10, 14,  1,  5,  9, 13,  0,  4,  8, 12 },  // Rot90,
+    { 15, 14, 13, 12, 11, 10,  9,  8,  7,  6,  5,  4,  3,  2,  1,  0 },  // Rot180,
+    { 12,  8,  4,  0, 13,  9,  5,  1, 14, 10,  6,  2, 15, 11,  7,  3 },  // Rot270
+};
+
+/**
+ * Mirror or rotate a region of a texture.
+ * Tile aligned regions are handled by moving whole 4x4 blocks: every block
+ * is copied to its new position and its 16 pixels are shuffled with a fixed
+ * table, no per-pixel address is ever computed. Other regions are buffered
+ * and remapped pixel by pixel, as are textures of different alpha types.
+ * @param texsrc The texture source.
+ * @param texdest The texture destination (may be the same as texsrc).
+ * @param rect The source rectangle.
+ * @param dx The x-coordinate of the destination area.
+ * @param dy The y-coordinate of the destination area.
+ * @param op One of the BMFX_FLIP* / BMFX_ROT* permutations.
+ */
+static
+void  BMFX_Permute (const GRRLIB_texImg *texsrc, GRRLIB_texImg *texdest,
+                    const GRRLIB_rect *rect, const int dx, const int dy,
+                    const int op) {
+    const bool  turn = (op == BMFX_ROT90 || op == BMFX_ROT270);
+    const uint  w    = rect->w;
+    const uint  h    = rect->h;
+    const uint  dw   = turn ? h : w;
+    const uint  dh   = turn ? w : h;
+
+    if (!BMFX_Editable(texsrc, texdest))  return;
+
+    if (((rect->x | rect->y | w | h | dx | dy) & 3) == 0 &&
+        texsrc->premult == texdest->premult) {
+        const u8   *sh  = BMFX_Shuffle[op];
+        const uint  nbw = w >> 2;
+        const uint  nbh = h >> 2;
+        const uint  dbw = texdest->w >> 2;
+        uint        sbw = texsrc->w >> 2;
+        const u16  *sdata = (const u16*)texsrc->data
+                          + ((((rect->y >> 2) * sbw) + (rect->x >> 2)) << 5);
+        u16        *ddata = (u16*)texdest->data
+                          + ((((dy >> 2) * dbw) + (dx >> 2)) << 5);
+        u16        *copy = NULL;
+        u16        tmps[32], tmpd[32];
+        bool       swap = false;
+        uint       bx, by, dbx, dby, sb, db, p;
+
+        if (texsrc->data == texdest->data) {
+            if (!turn && rect->x == dx && rect->y == dy) {
+                // Flips are involutions: exchange blocks two by two
+                swap = true;
+            }
+            else {
+                // Work from a copy of the source blocks
+                copy = malloc(w * h * 4);
+                if (copy == NULL)  return;
+                for (by = 0; by < nbh; by++)
+                    memcpy(copy + ((by * nbw) << 5), sdata + ((by * sbw) << 5), nbw << 6);
+                sdata = copy;
+                sbw   = nbw;
+            }
+        }
+
+        for (by = 0; by < nbh; by++) {
+            for (bx = 0; bx < nbw; bx++) {
+                switch (op) {
+                    case BMFX_FLIPH:   dbx = nbw-1-bx;  dby = by;        break;
+                    case BMFX_FLIPV:   dbx = bx;        dby = nbh-1-by;  break;
+                    case BMFX_ROT90:   dbx = nbh-1-by;  dby = bx;        break;
+                    case BMFX_ROT180:  dbx = nbw-1-bx;  dby = nbh-1-by;  break;
+                    default:           dbx = by;        dby = nbw-1-bx;  break;
+                }
+                sb = (by*sbw + bx) << 5;
+                db = (dby*dbw + dbx) << 5;
+
+                if (swap) {
+                    if (db < sb)  continue;  // Already exchanged
+                    memcpy(tmps, sdata + sb, 64);
+                    memcpy(tmpd, sdata + db, 64);
+                    for (p = 0; p < 16; p++) {
+                        ddata[db + sh[p]]      = tmps[p];
+                        ddata[db + sh[p] + 16] = tmps[p + 16];
+                        ddata[sb + sh[p]]      = tmpd[p];
+                        ddata[sb + sh[p] + 16] = tmpd[p + 16];
+                    }
+                }
+                else {
+                    for (p = 0; p < 16; p++) {
+                        ddata[db + sh[p]]      = sdata[sb + p];
+                        ddata[db + sh[p] + 16] = sdata[sb + p + 16];
+                    }
+                }
+            }
+        }
+
+        free(copy);
+    }
+    else {
+        u32   *buf, *line;
+        uint  i, j, sx, sy;
+
+        buf = malloc((w * h + dw) * sizeof(u32));
+        if (buf == NULL)  return;
+        line = buf + w * h;
 
-    for (y = 0; y < texsrc->h; y++) {
-        for (x = 0; x < texsrc->w; x++) {
-            GRRLIB_SetPixelTotexImg(txtWidth - x, y, texdest,
-                GRRLIB_GetPixelFromtexImg(x, y, texsrc));
+        for (j = 0; j < h; j++)
+            GRRLIB_ReadTexRow(texsrc, rect->x, rect->y + j, w, buf + j*w);
+
+        for (j = 0; j < dh; j++) {
+            for (i = 0; i < dw; i++) {
+                switch (op) {
+                    case BMFX_FLIPH:   sx = w-1-i;  sy = j;      break;
+                    case BMFX_FLIPV:   sx = i;      sy = h-1-j;  break;
+                    case BMFX_ROT90:   sx = j;      sy = h-1-i;  break;
+                    case BMFX_ROT180:  sx = w-1-i;  sy = h-1-j;  break;
+                    default:           sx = w-1-j;  sy = i;      break;
+                }
+                line[i] = buf[sy*w + sx];
+            }
+            GRRLIB_WriteTexRow(texdest, dx, dy + j, dw, line);
         }
+
+        free(buf);
     }
 }
 
+/**
+ * Mirror or rotate a region of a texture, then flush the destination area.
+ * @param texsrc The texture source.
+ * @param texdest The texture destination.
+ * @param rect The source rectangle.
+ * @param dx The x-coordinate of the destination area.
+ * @param dy The y-coordinate of the destination area.
+ * @param op One of the BMFX_FLIP* / BMFX_ROT* permutations.
+ */
+static
+void  BMFX_PermuteRect (const GRRLIB_texImg *texsrc, GRRLIB_texImg *texdest,
+                        const GRRLIB_rect *rect, const int dx, const int dy,
+                        const int op) {
+    const bool     turn = (op == BMFX_ROT90 || op == BMFX_ROT270);
+    const uint     dw   = turn ? rect->h : rect->w;
+    const uint     dh   = turn ? rect->w : rect->h;
+    GRRLIB_rect    r    = *rect;
+    GRRLIB_texImg  copy;
+
+    if (!BMFX_Begin(&texsrc, texdest, &r, dx, dy, dw, dh, &copy))  return;
+    BMFX_Permute(texsrc, texdest, &r, dx, dy, op);
+    BMFX_End(texdest, dx, dy, dw, dh, &copy);
+}
+
+/**
+ * Flip texture horizontal.
+ * @see GRRLIB_FlushTex
+ * @see GRRLIB_SetFlip
+ * @param texsrc The texture source.
+ * @param texdest The texture destination.
+ */
+void  GRRLIB_BMFX_FlipH (const GRRLIB_texImg *texsrc, GRRLIB_texImg *texdest) {
+    const GRRLIB_rect  rect = { 0, 0, texsrc->w, texsrc->h };
+    BMFX_Permute(texsrc, texdest, &rect, 0, 0, BMFX_FLIPH);
+}
+
+/**
+ * Flip a region of a texture horizontal.
+ * The destination area is flushed.
+ * @param texsrc The texture source.
+ * @param texdest The texture destination.
+ * @param rect The source rectangle.
+ * @param dx The x-coordinate of the destination area.
+ * @param dy The y-coordinate of the destination area.
+ */
+void  GRRLIB_BMFX_FlipHRect (const GRRLIB_texImg *texsrc, GRRLIB_texImg *texdest,
+                             const GRRLIB_rect *rect, const int dx, const int dy) {
+    BMFX_PermuteRect(texsrc, texdest, rect, dx, dy, BMFX_FLIPH);
+}
+
 /**
  * Flip texture vertical.
  * @see GRRLIB_FlushTex
+ * @see GRRLIB_SetFlip
  * @param texsrc The texture source.
  * @param texdest The texture destination.
  */
 void  GRRLIB_BMFX_FlipV (const GRRLIB_texImg *texsrc, GRRLIB_texImg *texdest) {
-    unsigned int x, y, texHeight = texsrc->h - 1;
+    const GRRLIB_rect  rect = { 0, 0, texsrc->w, texsrc->h };
+    BMFX_Permute(texsrc, texdest, &rect, 0, 0, BMFX_FLIPV);
+}
 
-    for (y = 0; y < texsrc->h; y++) {
-        for (x = 0; x < texsrc->w; x++) {
-            GRRLIB_SetPixelTotexImg(x, texHeight - y, texdest,
-                GRRLIB_GetPixelFromtexImg(x, y, texsrc));
-        }
-    }
+/**
+ * Flip a region of a texture vertical.
+ * The destination area is flushed.
+ * @param texsrc The texture source.
+ * @param texdest The texture destination.
+ * @param rect The source rectangle.
+ * @param dx The x-coordinate of the destination area.
+ * @param dy The y-coordinate of the destination area.
+ */
+void  GRRLIB_BMFX_FlipVRect (const GRRLIB_texImg *texsrc, GRRLIB_texImg *texdest,
+                             const GRRLIB_rect *rect, const int dx, const int dy) {
+    BMFX_PermuteRect(texsrc, texdest, rect, dx, dy, BMFX_FLIPV);
+}
+
+/**
+ * Rotate texture by 90 degrees clockwise.
+ * The destination must be as wide as the source is high and vice versa.
+ * @see GRRLIB_FlushTex
+ * @param texsrc The texture source.
+ * @param texdest The texture destination.
+ */
+void  GRRLIB_BMFX_Rotate90 (const GRRLIB_texImg *texsrc, GRRLIB_texImg *texdest) {
+    const GRRLIB_rect  rect = { 0, 0, texsrc->w, texsrc->h };
+    if (texdest->w != texsrc->h || texdest->h != texsrc->w)  return;
+    BMFX_Permute(texsrc, texdest, &rect, 0, 0, BMFX_ROT90);
+}
+
+/**
+ * Rotate a region of a texture by 90 degrees clockwise.
+ * The destination area is rect->h pixels wide and rect->w pixels high.
+ * It is flushed.
+ * @param texsrc The texture source.
+ * @param texdest The texture destination.
+ * @param rect The source rectangle.
+ * @param dx The x-coordinate of the destination area.
+ * @param dy The y-coordinate of the destination area.
+ */
+void  GRRLIB_BMFX_Rotate90Rect (const GRRLIB_texImg *texsrc, GRRLIB_texImg *texdest,
+                                const GRRLIB_rect *rect, const int dx, const int dy) {
+    BMFX_PermuteRect(texsrc, texdest, rect, dx, dy, BMFX_ROT90);
+}
+
+/**
+ * Rotate texture by 180 degrees.
+ * @see GRRLIB_FlushTex
+ * @param texsrc The texture source.
+ * @param texdest The texture destination.
+ */
+void  GRRLIB_BMFX_Rotate180 (const GRRLIB_texImg *texsrc, GRRLIB_texImg *texdest) {
+    const GRRLIB_rect  rect = { 0, 0, texsrc->w, texsrc->h };
+    BMFX_Permute(texsrc, texdest, &rect, 0, 0, BMFX_ROT180);
+}
+
+/**
+ * Rotate a region of a texture by 180 degrees.
+ * The destination area is flushed.
+ * @param texsrc The texture source.
+ * @param texdest The texture destination.
+ * @param rect The source rectangle.
+ * @param dx The x-coordinate of the destination area.
+ * @param dy The y-coordinate of the destination area.
+ */
+void  GRRLIB_BMFX_Rotate180Rect (const GRRLIB_texImg *texsrc, GRRLIB_texImg *texdest,
+                                 const GRRLIB_rect *rect, const int dx, const int dy) {
+    BMFX_PermuteRect(texsrc, texdest, rect, dx, dy, BMFX_ROT180);
+}
+
+/**
+ * Rotate texture by 90 degrees counterclockwise.
+ * The destination must be as wide as the source is high and vice versa.
+ * @see GRRLIB_FlushTex
+ * @param texsrc The texture source.
+ * @param texdest The texture destination.
+ */
+void  GRRLIB_BMFX_Rotate270 (const GRRLIB_texImg *texsrc, GRRLIB_texImg *texdest) {
+    const GRRLIB_rect  rect = { 0, 0, texsrc->w, texsrc->h };
+    if (texdest->w != texsrc->h || texdest->h != texsrc->w)  return;
+    BMFX_Permute(texsrc, texdest, &rect, 0, 0, BMFX_ROT270);
+}
+
+/**
+ * Rotate a region of a texture by 90 degrees counterclockwise.
+ * The destination area is rect->h pixels wide and rect->w pixels high.
+ * It is flushed.
+ * @param texsrc The texture source.
+ * @param texdest The texture destination.
+ * @param rect The source rectangle.
+ * @param dx The x-coordinate of the destination area.
+ * @param dy The y-coordinate of the destination area.
+ */
+void  GRRLIB_BMFX_Rotate270Rect (const GRRLIB_texImg *texsrc, GRRLIB_texImg *texdest,
+                                 const GRRLIB_rect *rect, const int dx, const int dy) {
+    BMFX_PermuteRect(texsrc, texdest, rect, dx, dy, BMFX_ROT270);
 }
 
+/**
+ * Colour matrix used by GRRLIB_BMFX_Grayscale.
+ */
+static const f32  BMFX_GrayMatrix[20] = {
+    77/255.0f, 150/255.0f, 28/255.0f, 0.0f, 0.0f,
+    77/255.0f, 150/255.0f, 28/255.0f, 0.0f, 0.0f,
+    77/255.0f, 150/255.0f, 28/255.0f, 0.0f, 0.0f,
+    0.0f,      0.0f,       0.0f,      1.0f, 0.0f,
+};
+
+/**
+ * Colour matrix used by GRRLIB_BMFX_Sepia.
+ */
+static const f32  BMFX_SepiaMatrix[20] = {
+    0.393f, 0.769f, 0.189f, 0.0f, 0.0f,
+    0.349f, 0.686f, 0.168f, 0.0f, 0.0f,
+    0.272f, 0.534f, 0.131f, 0.0f, 0.0f,
+    0.0f,   0.0f,   0.0f,   1.0f, 0.0f,
+};
+
 /**
  * Change a texture to gray scale.
  * @see GRRLIB_FlushTex
@@ -66,25 +581,24 @@ void  GRRLIB_BMFX_FlipV (const GRRLIB_texImg *texsrc, GRRLIB_texImg *texdest) {
  */
 void  GRRLIB_BMFX_Grayscale (const GRRLIB_texImg *texsrc,
                              GRRLIB_texImg *texdest) {
-    unsigned int x, y;
-    u8 gray;
-    u32 color;
-
-    for (y = 0; y < texsrc->h; y++) {
-        for (x = 0; x < texsrc->w; x++) {
-            color = GRRLIB_GetPixelFromtexImg(x, y, texsrc);
-
-            gray = ((R(color)* 77 +
-                     G(color)*150 +
-                     B(color)* 28 ) / 255);
-
-            GRRLIB_SetPixelTotexImg(x, y, texdest,
-                ((gray << 24) | (gray << 16) | (gray << 8) | A(color)));
-        }
-    }
+    GRRLIB_BMFX_ColorMatrix(texsrc, texdest, BMFX_GrayMatrix);
     GRRLIB_SetHandle(texdest, 0, 0);
 }
 
+/**
+ * Change a region of a texture to gray scale.
+ * The destination area is flushed.
+ * @param texsrc The texture source.
+ * @param texdest The texture destination.
+ * @param rect The source rectangle.
+ * @param dx The x-coordinate of the destination area.
+ * @param dy The y-coordinate of the destination area.
+ */
+void  GRRLIB_BMFX_GrayscaleRect (const GRRLIB_texImg *texsrc, GRRLIB_texImg *texdest,
+                                 const GRRLIB_rect *rect, const int dx, const int dy) {
+    GRRLIB_BMFX_ColorMatrixRect(texsrc, texdest, rect, dx, dy, BMFX_GrayMatrix);
+}
+
 /**
  * Change a texture to sepia (old photo style).
  * @see GRRLIB_FlushTex
@@ -93,23 +607,24 @@ void  GRRLIB_BMFX_Grayscale (const GRRLIB_texImg *texsrc,
  * @author elisherer
  */
 void  GRRLIB_BMFX_Sepia (const GRRLIB_texImg *texsrc, GRRLIB_texImg *texdest) {
-    unsigned int  x, y;
-    u16           sr, sg, sb;
-    u32           color;
-
-    for (y = 0; y < texsrc->h; y++) {
-        for (x = 0; x < texsrc->w; x++) {
-            color = GRRLIB_GetPixelFromtexImg(x, y, texsrc);
-            sr = R(color)*0.393 + G(color)*0.769 + B(color)*0.189;
-            sg = R(color)*0.349 + G(color)*0.686 + B(color)*0.168;
-            sb = R(color)*0.272 + G(color)*0.534 + B(color)*0.131;
-            if (sr>255) sr=255;  if (sg>255) sg=255;
-            GRRLIB_SetPixelTotexImg(x, y, texdest,
-                                    RGBA(sr, sg, sb, A(color)));
-        }
-    }
+    GRRLIB_BMFX_ColorMatrix(texsrc, texdest, BMFX_SepiaMatrix);
     GRRLIB_SetHandle(texdest, 0, 0);
 }
+
+/**
+ * Change a region of a texture to sepia (old photo style).
+ * The destination area is flushed.
+ * @param texsrc The texture source.
+ * @param texdest The texture destination.
+ * @param rect The source rectangle.
+ * @param dx The x-coordinate of the destination area.
+ * @param dy The y-coordinate of the destination area.
+ */
+void  GRRLIB_BMFX_SepiaRect (const GRRLIB_texImg *texsrc, GRRLIB_texImg *texdest,
+                             const GRRLIB_rect *rect, const int dx, const int dy) {
+    GRRLIB_BMFX_ColorMatrixRect(texsrc, texdest, rect, dx, dy, BMFX_SepiaMatrix);
+}
+
 /**
  * Invert colors of the texture.
  * @see GRRLIB_FlushTex
@@ -117,52 +632,72 @@ void  GRRLIB_BMFX_Sepia (const GRRLIB_texImg *texsrc, GRRLIB_texImg *texdest) {
  * @param texdest The texture destination.
  */
 void  GRRLIB_BMFX_Invert (const GRRLIB_texImg *texsrc, GRRLIB_texImg *texdest) {
-    unsigned int x, y;
-    u32 color;
+    u8   lut[256];
+    int  i;
 
-    for (y = 0; y < texsrc->h; y++) {
-        for (x = 0; x < texsrc->w; x++) {
-            color = GRRLIB_GetPixelFromtexImg(x, y, texsrc);
-            GRRLIB_SetPixelTotexImg(x, y, texdest,
-                ((0xFFFFFF - (color >> 8 & 0xFFFFFF)) << 8)  | (color & 0xFF));
-        }
-    }
+    for (i = 0; i < 256; i++)  lut[i] = 255 - i;
+    GRRLIB_BMFX_LUT(texsrc, texdest, lut, lut, lut, NULL);
 }
 
 /**
- * A texture effect (Blur).
- * @see GRRLIB_FlushTex
+ * Invert colors of a region of a texture.
+ * The destination area is flushed.
  * @param texsrc The texture source.
  * @param texdest The texture destination.
+ * @param rect The source rectangle.
+ * @param dx The x-coordinate of the destination area.
+ * @param dy The y-coordinate of the destination area.
+ */
+void  GRRLIB_BMFX_InvertRect (const GRRLIB_texImg *texsrc, GRRLIB_texImg *texdest,
+                              const GRRLIB_rect *rect, const int dx, const int dy) {
+    u8   lut[256];
+    int  i;
+
+    for (i = 0; i < 256; i++)  lut[i] = 255 - i;
+    GRRLIB_BMFX_LUTRect(texsrc, texdest, rect, dx, dy, lut, lut, lut, NULL);
+}
+
+/**
+ * Blur a region of a texture.
+ * @param texsrc The texture source.
+ * @param texdest The texture destination.
+ * @param rect The source rectangle.
+ * @param dx The x-coordinate of the destination area.
+ * @param dy The y-coordinate of the destination area.
  * @param factor The blur factor.
  */
-void  GRRLIB_BMFX_Blur (const GRRLIB_texImg *texsrc,
-                              GRRLIB_texImg *texdest, const u32 factor) {
+static
+void  BMFX_Blur (const GRRLIB_texImg *texsrc, GRRLIB_texImg *texdest,
+                 const GRRLIB_rect *rect, const int dx, const int dy,
+                 const u32 factor) {
+    const int  w = rect->w, h = rect->h, f = factor;
     int numba = (1+(factor<<1))*(1+(factor<<1));
-    u32 x, y;
-    s32 k, l;
+    int x, y;
+    int k, l;
     int tmp;
     int newr, newg, newb, newa;
     u32 colours[numba];
     u32 thiscol;
 
-    for (x = 0; x < texsrc->w; x++) {
-        for (y = 0; y < texsrc->h; y++) {
+    if (!BMFX_Editable(texsrc, texdest))  return;
+
+    for (x = 0; x < w; x++) {
+        for (y = 0; y < h; y++) {
             newr = 0;
             newg = 0;
             newb = 0;
             newa = 0;
 
             tmp = 0;
-            thiscol = GRRLIB_GetPixelFromtexImg(x, y, texsrc);
+            thiscol = GRRLIB_GetPixelFromtexImg(rect->x + x, rect->y + y, texsrc);
 
-            for (k = x - factor; k <= x + factor; k++) {
-                for (l = y - factor; l <= y + factor; l++) {
-                    if (k < 0 || k >= texsrc->w || l < 0 || l >= texsrc->h) {
+            for (k = x - f; k <= x + f; k++) {
+                for (l = y - f; l <= y + f; l++) {
+                    if (k < 0 || k >= w || l < 0 || l >= h) {
                         colours[tmp] = thiscol;
                     }
                     else {
-                        colours[tmp] = GRRLIB_GetPixelFromtexImg(k, l, texsrc);
+                        colours[tmp] = GRRLIB_GetPixelFromtexImg(rect->x + k, rect->y + l, texsrc);
                     }
                     tmp++;
                 }
@@ -180,37 +715,149 @@ void  GRRLIB_BMFX_Blur (const GRRLIB_texImg *texsrc,
             newb /= numba;
             newa /= numba;
 
-            GRRLIB_SetPixelTotexImg(x, y, texdest, (newr<<24) | (newg<<16) | (newb<<8) | newa);
+            GRRLIB_SetPixelTotexImg(dx + x, dy + y, texdest, (newr<<24) | (newg<<16) | (newb<<8) | newa);
         }
     }
 }
 
 /**
- * A texture effect (Scatter).
+ * A texture effect (Blur).
  * @see GRRLIB_FlushTex
  * @param texsrc The texture source.
  * @param texdest The texture destination.
+ * @param factor The blur factor.
+ */
+void  GRRLIB_BMFX_Blur (const GRRLIB_texImg *texsrc,
+                              GRRLIB_texImg *texdest, const u32 factor) {
+    const GRRLIB_rect  rect = { 0, 0, texsrc->w, texsrc->h };
+    BMFX_Blur(texsrc, texdest, &rect, 0, 0, factor);
+}
+
+/**
+ * Blur a region of a texture.
+ * Pixels outside of the rectangle are never sampled.
+ * The destination area is flushed.
+ * @param texsrc The texture source.
+ * @param texdest The texture destination.
+ * @param rect The source rectangle.
+ * @param dx The x-coordinate of the destination area.
+ * @param dy The y-coordinate of the destination area.
+ * @param factor The blur factor.
+ */
+void  GRRLIB_BMFX_BlurRect (const GRRLIB_texImg *texsrc, GRRLIB_texImg *texdest,
+                            const GRRLIB_rect *rect, const int dx, const int dy,
+                            const u32 factor) {
+    GRRLIB_rect    r = *rect;
+    GRRLIB_texImg  copy;
+
+    if (!BMFX_Begin(&texsrc, texdest, &r, dx, dy, r.w, r.h, &copy))  return;
+    BMFX_Blur(texsrc, texdest, &r, dx, dy, factor);
+    BMFX_End(texdest, dx, dy, r.w, r.h, &copy);
+}
+
+/**
+ * Scatter the pixels of a region of a texture.
+ * @param texsrc The texture source.
+ * @param texdest The texture destination.
+ * @param rect The source rectangle.
+ * @param dx The x-coordinate of the destination area.
+ * @param dy The y-coordinate of the destination area.
  * @param factor The factor level of the effect.
  */
-void  GRRLIB_BMFX_Scatter (const GRRLIB_texImg *texsrc,
-                                 GRRLIB_texImg *texdest, const u32 factor) {
+static
+void  BMFX_Scatter (const GRRLIB_texImg *texsrc, GRRLIB_texImg *texdest,
+                    const GRRLIB_rect *rect, const int dx, const int dy,
+                    const u32 factor) {
     unsigned int x, y;
     u32 val1, val2;
     u32 val3, val4;
     int factorx2 = factor*2;
 
-    for (y = 0; y < texsrc->h; y++) {
-        for (x = 0; x < texsrc->w; x++) {
+    if (!BMFX_Editable(texsrc, texdest))  return;
+
+    for (y = 0; y < rect->h; y++) {
+        for (x = 0; x < rect->w; x++) {
             val1 = x + (int) (factorx2 * (rand() / (RAND_MAX + 1.0))) - factor;
             val2 = y + (int) (factorx2 * (rand() / (RAND_MAX + 1.0))) - factor;
 
-            if ((val1 >= texsrc->w) || (val2 >= texsrc->h)) {
+            if ((val1 >= rect->w) || (val2 >= rect->h)) {
             }
             else {
-                val3 = GRRLIB_GetPixelFromtexImg(x, y, texsrc);
-                val4 = GRRLIB_GetPixelFromtexImg(val1, val2, texsrc);
-                GRRLIB_SetPixelTotexImg(x, y, texdest, val4);
-                GRRLIB_SetPixelTotexImg(val1, val2, texdest, val3);
+                val3 = GRRLIB_GetPixelFromtexImg(rect->x + x, rect->y + y, texsrc);
+                val4 = GRRLIB_GetPixelFromtexImg(rect->x + val1, rect->y + val2, texsrc);
+                GRRLIB_SetPixelTotexImg(dx + x, dy + y, texdest, val4);
+                GRRLIB_SetPixelTotexImg(dx + val1, dy + val2, texdest, val3);
+            }
+        }
+    }
+}
+
+/**
+ * A texture effect (Scatter).
+ * @see GRRLIB_FlushTex
+ * @param texsrc The texture source.
+ * @param texdest The texture destination.
+ * @param factor The factor level of the effect.
+ */
+void  GRRLIB_BMFX_Scatter (const GRRLIB_texImg *texsrc,
+                                 GRRLIB_texImg *texdest, const u32 factor) {
+    const GRRLIB_rect  rect = { 0, 0, texsrc->w, texsrc->h };
+    BMFX_Scatter(texsrc, texdest, &rect, 0, 0, factor);
+}
+
+/**
+ * Scatter the pixels of a region of a texture.
+ * Pixels never move out of the rectangle.
+ * The destination area is flushed.
+ * @param texsrc The texture source.
+ * @param texdest The texture destination.
+ * @param rect The source rectangle.
+ * @param dx The x-coordinate of the destination area.
+ * @param dy The y-coordinate of the destination area.
+ * @param factor The factor level of the effect.
+ */
+void  GRRLIB_BMFX_ScatterRect (const GRRLIB_texImg *texsrc, GRRLIB_texImg *texdest,
+                               const GRRLIB_rect *rect, const int dx, const int dy,
+                               const u32 factor) {
+    GRRLIB_rect    r = *rect;
+    GRRLIB_texImg  copy;
+
+    if (!BMFX_Begin(&texsrc, texdest, &r, dx, dy, r.w, r.h, &copy))  return;
+    BMFX_Scatter(texsrc, texdest, &r, dx, dy, factor);
+    BMFX_End(texdest, dx, dy, r.w, r.h, &copy);
+}
+
+/**
+ * Pixelate a region of a texture.
+ * @param texsrc The texture source.
+ * @param texdest The texture destination.
+ * @param rect The source rectangle.
+ * @param dx The x-coordinate of the destination area.
+ * @param dy The y-coordinate of the destination area.
+ * @param factor The factor level of the effect.
+ */
+static
+void  BMFX_Pixelate (const GRRLIB_texImg *texsrc, GRRLIB_texImg *texdest,
+                     const GRRLIB_rect *rect, const int dx, const int dy,
+                     const u32 factor) {
+    const u32  n = (rect->w > rect->h) ? rect->w : rect->h;
+    const int  f = (factor < n) ? factor : n;
+    int        x, y;
+    int        xx, yy;
+    int        xe, ye;
+    u32        rgb;
+
+    if (!BMFX_Editable(texsrc, texdest) || factor == 0)  return;
+
+    for (x = 0; x < (int)rect->w; x += f) {
+        xe = (x + f < (int)rect->w) ? x + f : (int)rect->w;
+        for (y = 0; y < (int)rect->h; y += f) {
+            ye = (y + f < (int)rect->h) ? y + f : (int)rect->h;
+            rgb = GRRLIB_GetPixelFromtexImg(rect->x + x, rect->y + y, texsrc);
+            for (xx = x; xx < xe; xx++) {
+                for (yy = y; yy < ye; yy++) {
+                    GRRLIB_SetPixelTotexImg(dx + xx, dy + yy, texdest, rgb);
+                }
             }
         }
     }
@@ -225,18 +872,749 @@ void  GRRLIB_BMFX_Scatter (const GRRLIB_texImg *texsrc,
  */
 void  GRRLIB_BMFX_Pixelate (const GRRLIB_texImg *texsrc,
                                   GRRLIB_texImg *texdest, const u32 factor) {
-    unsigned int x, y;
-    unsigned int xx, yy;
-    u32 rgb;
-
-    for (x = 0; x < texsrc->w - 1 - factor; x += factor) {
-        for (y = 0; y < texsrc->h - 1 - factor; y +=factor) {
-            rgb = GRRLIB_GetPixelFromtexImg(x, y, texsrc);
-            for (xx = x; xx < x + factor; xx++) {
-                for (yy = y; yy < y + factor; yy++) {
-                    GRRLIB_SetPixelTotexImg(xx, yy, texdest, rgb);
+    const GRRLIB_rect  rect = { 0, 0, texsrc->w, texsrc->h };
+    BMFX_Pixelate(texsrc, texdest, &rect, 0, 0, factor);
+}
+
+/**
+ * Pixelate a region of a texture.
+ * The destination area is flushed.
+ * @param texsrc The texture source.
+ * @param texdest The texture destination.
+ * @param rect The source rectangle.
+ * @param dx The x-coordinate of the destination area.
+ * @param dy The y-coordinate of the destination area.
+ * @param factor The factor level of the effect.
+ */
+void  GRRLIB_BMFX_PixelateRect (const GRRLIB_texImg *texsrc, GRRLIB_texImg *texdest,
+                                const GRRLIB_rect *rect, const int dx, const int dy,
+                                const u32 factor) {
+    GRRLIB_rect    r = *rect;
+    GRRLIB_texImg  copy;
+
+    if (!BMFX_Begin(&texsrc, texdest, &r, dx, dy, r.w, r.h, &copy))  return;
+    BMFX_Pixelate(texsrc, texdest, &r, dx, dy, factor);
+    BMFX_End(texdest, dx, dy, r.w, r.h, &copy);
+}
+
+/**
+ * Map a row or column index onto the texture according to an edge mode.
+ * @param i The index to map.
+ * @param n The size of the texture along this axis.
+ * @param edgeMode How to handle an index outside of the texture.
+ * @return The mapped index, or -1 if the sample is transparent black.
+ */
+static inline
+int  BMFX_EdgeIndex (int i, const int n, const GRRLIB_edgeMode edgeMode) {
+    if (i >= 0 && i < n)  return i;
+    switch (edgeMode) {
+        case GRRLIB_EDGE_WRAP:
+            i %= n;
+            return (i < 0) ? i + n : i;
+        case GRRLIB_EDGE_ZERO:
+            return -1;
+        default:
+            return (i < 0) ? 0 : n - 1;
+    }
+}
+
+/**
+ * Fetch one row of a region into a padded line buffer.
+ * The r pixels on each side are filled according to the edge mode so the
+ * convolution loops never need to test for the region borders.
+ * @param tex The texture to read from.
+ * @param rect The region of the texture being filtered.
+ * @param y The row to read, relative to the region (may be outside of it).
+ * @param r Kernel radius, i.e. the padding on each side.
+ * @param edgeMode How to handle pixels outside of the region.
+ * @param line Destination buffer of rect->w + 2*r colours.
+ */
+static
+void  BMFX_FetchLine (const GRRLIB_texImg *tex, const GRRLIB_rect *rect,
+                      const int y, const int r,
+                      const GRRLIB_edgeMode edgeMode, u32 *line) {
+    int  w  = rect->w;
+    int  sy = BMFX_EdgeIndex(y, rect->h, edgeMode);
+    int  i;
+
+    if (sy < 0) {
+        memset(line, 0, (w + 2*r) * sizeof(u32));
+        return;
+    }
+    GRRLIB_ReadTexRow(tex, rect->x, rect->y + sy, w, line + r);
+    for (i = 1; i <= r; i++) {
+        switch (edgeMode) {
+            case GRRLIB_EDGE_WRAP:
+                line[r - i]     = line[r + BMFX_EdgeIndex(-i, w, edgeMode)];
+                line[r + w-1+i] = line[r + BMFX_EdgeIndex(w-1+i, w, edgeMode)];
+                break;
+            case GRRLIB_EDGE_ZERO:
+                line[r - i]     = 0;
+                line[r + w-1+i] = 0;
+                break;
+            default:
+                line[r - i]     = line[r];
+                line[r + w-1+i] = line[r + w-1];
+                break;
+        }
+    }
+}
+
+/**
+ * Split a square kernel in a column and a row vector if it has rank one.
+ * @param kernel The size x size kernel.
+ * @param size The kernel size.
+ * @param kv Receives the vertical (column) vector.
+ * @param kh Receives the horizontal (row) vector.
+ * @return true if kernel[j][i] == kv[j] * kh[i] for every element.
+ */
+static
+bool  BMFX_SplitKernel (const s32 *kernel, const int size, s32 *kv, s32 *kh) {
+    int  i, j, pr = -1, pc = -1;
+    s32  g = 0, a, b, t;
+
+    // Find a pivot row and column
+    for (j = 0; j < size && pr < 0; j++) {
+        for (i = 0; i < size; i++) {
+            if (kernel[j*size + i] != 0) {
+                pr = j;
+                pc = i;
+                break;
+            }
+        }
+    }
+    if (pr < 0)  return false;
+
+    // Every row must be a multiple of the pivot row
+    for (j = 0; j < size; j++) {
+        for (i = 0; i < size; i++) {
+            if ((s64)kernel[j*size + i] * kernel[pr*size + pc] !=
+                (s64)kernel[j*size + pc] * kernel[pr*size + i]) {
+                return false;
+            }
+        }
+    }
+
+    // Reduce the pivot row by its GCD so the column factors are integers
+    for (i = 0; i < size; i++) {
+        a = abs(kernel[pr*size + i]);
+        b = g;
+        while (b) {  t = a % b;  a = b;  b = t;  }
+        g = a;
+    }
+    for (i = 0; i < size; i++)  kh[i] = kernel[pr*size + i] / g;
+    for (j = 0; j < size; j++)  kv[j] = kernel[j*size + pc] / kh[pc];
+    return true;
+}
+
+/**
+ * Largest sum of the absolute kernel coefficients, so that a weighted sum
+ * of 8-bit channels always fits in the s32 accumulators.
+ */
+#define BMFX_KERNEL_SUM  (0x7FFFFFFF / 255)
+
+/**
+ * Scale a channel sum by the divisor, add the bias and clamp to 0..255.
+ */
+#define BMFX_SCALE(acc, recip, bias) \
+    (((((s64)(acc) * (recip)) + 0x8000) >> 16) + (bias))
+#define BMFX_CLAMP(v)  ((v) < 0 ? 0 : ((v) > 255 ? 255 : (v)))
+
+/**
+ * Apply a convolution kernel to a region of a texture.
+ * @param texsrc The texture source.
+ * @param texdest The texture destination (may be the same as texsrc).
+ * @param rect The source rectangle.
+ * @param dx The x-coordinate of the destination area.
+ * @param dy The y-coordinate of the destination area.
+ * @param kernel The size x size kernel coefficients, stored row by row.
+ * @param size The kernel size, an odd number up to GRRLIB_KERNEL_MAX.
+ * @param divisor Divide the weighted sum by this value (0 is treated as 1).
+ * @param bias Value added to each channel after the division.
+ * @param edgeMode How pixels outside of the region are sampled.
+ */
+static
+void  BMFX_Convolve (const GRRLIB_texImg *texsrc, GRRLIB_texImg *texdest,
+                     const GRRLIB_rect *rect, const int dx, const int dy,
+                     const s32 *kernel, const u32 size,
+                     const s32 divisor, const s32 bias,
+                     const GRRLIB_edgeMode edgeMode) {
+    const int  r  = size >> 1;
+    const int  w  = rect->w;
+    const int  h  = rect->h;
+    const int  pw = w + 2*r;
+    s32   kv[GRRLIB_KERNEL_MAX], kh[GRRLIB_KERNEL_MAX];
+    u32   *lines[GRRLIB_KERNEL_MAX];
+    s32   *hlines[GRRLIB_KERNEL_MAX];
+    s32   recip;
+    s64   sum;
+    u32   *buf, *wrap = NULL, *out;
+    s32   *hbuf = NULL;
+    bool  separable;
+    int   x, y, i, j, v;
+
+    if (!BMFX_Editable(texsrc, texdest))  return;
+
+    if (kernel == NULL || (size & 1) == 0 || size > GRRLIB_KERNEL_MAX)  return;
+
+    // Larger weights would overflow the channel sums
+    for (i = 0, sum = 0; i < (int)(size * size); i++)
+        sum += (kernel[i] < 0) ? -(s64)kernel[i] : kernel[i];
+    if (sum > BMFX_KERNEL_SUM)  return;
+
+    if      (divisor > 0)  recip =  ((0x10000 + (divisor >> 1)) /  divisor);
+    else if (divisor < 0)  recip = -((0x10000 - (divisor >> 1)) / -divisor);
+    else                   recip =   0x10000;
+
+    separable = (size > 1) && BMFX_SplitKernel(kernel, size, kv, kh);
+
+    // Ring of size padded source lines plus one output line
+    buf = malloc((size * pw + w) * sizeof(u32));
+    if (buf == NULL)  return;
+    out = buf + size * pw;
+    if (separable) {
+        hbuf = malloc(size * w * 3 * sizeof(s32));
+        if (hbuf == NULL) {
+            free(buf);
+            return;
+        }
+    }
+    // In place wrapping needs the top rows once they have been overwritten
+    if (edgeMode == GRRLIB_EDGE_WRAP && texsrc->data == texdest->data && r) {
+        wrap = malloc(r * pw * sizeof(u32));
+        if (wrap == NULL) {
+            free(hbuf);
+            free(buf);
+            return;
+        }
+        for (j = 0; j < r; j++)
+            BMFX_FetchLine(texsrc, rect, j, r, edgeMode, wrap + j*pw);
+    }
+
+    // Prime the ring with source rows -r .. r-1
+    for (v = -r; v < r; v++) {
+        j = (v + r) % size;
+        BMFX_FetchLine(texsrc, rect, v, r, edgeMode, buf + j*pw);
+        if (separable) {
+            u32  *src = buf + j*pw;
+            s32  *dst = hbuf + j*w*3;
+            for (x = 0; x < w; x++, src++, dst += 3) {
+                s32  sr = 0, sg = 0, sb = 0;
+                for (i = 0; i < (int)size; i++) {
+                    sr += kh[i] * (s32)R(src[i]);
+                    sg += kh[i] * (s32)G(src[i]);
+                    sb += kh[i] * (s32)B(src[i]);
+                }
+                dst[0] = sr;  dst[1] = sg;  dst[2] = sb;
+            }
+        }
+    }
+
+    for (y = 0; y < h; y++) {
+        // Bring in source row y + r, replacing the one that is no longer needed
+        v = y + r;
+        j = (v + r) % size;
+        if (wrap != NULL && v >= h)
+            memcpy(buf + j*pw, wrap + (v - h)*pw, pw * sizeof(u32));
+        else
+            BMFX_FetchLine(texsrc, rect, v, r, edgeMode, buf + j*pw);
+
+        for (i = 0; i < (int)size; i++) {
+            lines[i] = buf + ((y + i) % size)*pw;
+            if (separable)  hlines[i] = hbuf + ((y + i) % size)*w*3;
+        }
+
+        if (separable) {
+            u32  *src = lines[size-1];
+            s32  *dst = hlines[size-1];
+            for (x = 0; x < w; x++, src++, dst += 3) {
+                s32  sr = 0, sg = 0, sb = 0;
+                for (i = 0; i < (int)size; i++) {
+                    sr += kh[i] * (s32)R(src[i]);
+                    sg += kh[i] * (s32)G(src[i]);
+                    sb += kh[i] * (s32)B(src[i]);
                 }
+                dst[0] = sr;  dst[1] = sg;  dst[2] = sb;
+            }
+            for (x = 0; x < w; x++) {
+                s32  sr = 0, sg = 0, sb = 0;
+                for (j = 0; j < (int)size; j++) {
+                    s32  *p = hlines[j] + x*3;
+                    sr += kv[j] * p[0];
+                    sg += kv[j] * p[1];
+                    sb += kv[j] * p[2];
+                }
+                const s64  vr = BMFX_SCALE(sr, recip, bias);
+                const s64  vg = BMFX_SCALE(sg, recip, bias);
+                const s64  vb = BMFX_SCALE(sb, recip, bias);
+                out[x] = RGBA((u8)BMFX_CLAMP(vr), (u8)BMFX_CLAMP(vg),
+                              (u8)BMFX_CLAMP(vb), A(lines[r][x + r]));
             }
         }
+        else {
+            for (x = 0; x < w; x++) {
+                const s32  *k = kernel;
+                s32        sr = 0, sg = 0, sb = 0;
+                for (j = 0; j < (int)size; j++) {
+                    const u32  *p = lines[j] + x;
+                    for (i = 0; i < (int)size; i++, k++) {
+                        sr += *k * (s32)R(p[i]);
+                        sg += *k * (s32)G(p[i]);
+                        sb += *k * (s32)B(p[i]);
+                    }
+                }
+                const s64  vr = BMFX_SCALE(sr, recip, bias);
+                const s64  vg = BMFX_SCALE(sg, recip, bias);
+                const s64  vb = BMFX_SCALE(sb, recip, bias);
+                out[x] = RGBA((u8)BMFX_CLAMP(vr), (u8)BMFX_CLAMP(vg),
+                              (u8)BMFX_CLAMP(vb), A(lines[r][x + r]));
+            }
+        }
+
+        GRRLIB_WriteTexRow(texdest, dx, dy + y, w, out);
     }
+
+    free(wrap);
+    free(hbuf);
+    free(buf);
+}
+
+
+/**
+ * Apply a convolution kernel to a texture (sharpen, emboss, edge detect...).
+ * The red, green and blue channels are filtered, the alpha channel is kept.
+ * Each output channel is sum(kernel * pixel) / divisor + bias, computed with
+ * integer arithmetic. Kernels of rank one (box, gaussian, sobel...) are
+ * detected and applied as two cheaper one dimensional passes.
+ * Kernels whose absolute coefficients add up to more than 8421504 are
+ * rejected, the texture is left untouched.
+ * @see GRRLIB_FlushTex
+ * @param texsrc The texture source.
+ * @param texdest The texture destination (may be the same as texsrc).
+ * @param kernel The size x size kernel coefficients, stored row by row.
+ * @param size The kernel size, an odd number up to GRRLIB_KERNEL_MAX.
+ * @param divisor Divide the weighted sum by this value (0 is treated as 1).
+ * @param bias Value added to each channel after the division.
+ * @param edgeMode How pixels outside of the texture are sampled.
+ */
+void  GRRLIB_BMFX_Convolve (const GRRLIB_texImg *texsrc,
+                            GRRLIB_texImg *texdest,
+                            const s32 *kernel, const u32 size,
+                            const s32 divisor, const s32 bias,
+                            const GRRLIB_edgeMode edgeMode) {
+    const GRRLIB_rect  rect = { 0, 0, texsrc->w, texsrc->h };
+    BMFX_Convolve(texsrc, texdest, &rect, 0, 0,
+                  kernel, size, divisor, bias, edgeMode);
+}
+
+/**
+ * Apply a convolution kernel to a region of a texture.
+ * The edge mode applies to the borders of the rectangle, so neighbouring
+ * sprites of an atlas never bleed into the result.
+ * The destination area is flushed.
+ * @see GRRLIB_BMFX_Convolve
+ * @param texsrc The texture source.
+ * @param texdest The texture destination (may be the same as texsrc).
+ * @param rect The source rectangle.
+ * @param dx The x-coordinate of the destination area.
+ * @param dy The y-coordinate of the destination area.
+ * @param kernel The size x size kernel coefficients, stored row by row.
+ * @param size The kernel size, an odd number up to GRRLIB_KERNEL_MAX.
+ * @param divisor Divide the weighted sum by this value (0 is treated as 1).
+ * @param bias Value added to each channel after the division.
+ * @param edgeMode How pixels outside of the rectangle are sampled.
+ */
+void  GRRLIB_BMFX_ConvolveRect (const GRRLIB_texImg *texsrc,
+                                GRRLIB_texImg *texdest,
+                                const GRRLIB_rect *rect,
+                                const int dx, const int dy,
+                                const s32 *kernel, const u32 size,
+                                const s32 divisor, const s32 bias,
+                                const GRRLIB_edgeMode edgeMode) {
+    GRRLIB_rect    r = *rect;
+    GRRLIB_texImg  copy;
+
+    if (!BMFX_Begin(&texsrc, texdest, &r, dx, dy, r.w, r.h, &copy))  return;
+    BMFX_Convolve(texsrc, texdest, &r, dx, dy,
+                  kernel, size, divisor, bias, edgeMode);
+    BMFX_End(texdest, dx, dy, r.w, r.h, &copy);
+}
+
+/**
+ * Colour matrix block operation, ctx holds the tables built by
+ * BMFX_ColorMatrix followed by the four offsets.
+ */
+static
+void  BMFX_MatrixBlocks (const u8 *sp, u8 *dp, const uint nblocks,
+                         const void *ctx) {
+    const s32  *tab = (const s32*)ctx;
+    const s32  *ofs = tab + 4*4*256;
+    const s32  *t;
+    uint       b, p;
+    int        o, v;
+
+    for (b = 0; b < nblocks; b++, sp += 64, dp += 64) {
+        for (p = 0; p < 32; p += 2) {
+            const u32  sa = sp[p], sr = sp[p+1], sg = sp[p+32], sb = sp[p+33];
+            s32        c[4];
+            for (o = 0, t = tab; o < 4; o++, t += 4*256) {
+                v = (t[sr] + t[256 + sg] + t[512 + sb] + t[768 + sa] + ofs[o]) >> 8;
+                c[o] = BMFX_CLAMP(v);
+            }
+            dp[p   ] = c[3];
+            dp[p+ 1] = c[0];
+            dp[p+32] = c[1];
+            dp[p+33] = c[2];
+        }
+    }
+}
+
+/**
+ * Transform the colours of a region of a texture with a 4x5 colour matrix.
+ * @param texsrc The texture source.
+ * @param texdest The texture destination (may be the same as texsrc).
+ * @param rect The source rectangle.
+ * @param dx The x-coordinate of the destination area.
+ * @param dy The y-coordinate of the destination area.
+ * @param matrix The 4x5 colour matrix, stored row by row.
+ */
+static
+void  BMFX_ColorMatrix (const GRRLIB_texImg *texsrc, GRRLIB_texImg *texdest,
+                        const GRRLIB_rect *rect, const int dx, const int dy,
+                        const f32 matrix[20]) {
+    s32  *tab, *t;
+    int  o, i, v;
+
+    if (!BMFX_Editable(texsrc, texdest))  return;
+
+    // tab[(o*4 + i)*256 + v] = matrix[o][i] * v in 24.8 fixed point
+    tab = malloc((4*4*256 + 4) * sizeof(s32));
+    if (tab == NULL)  return;
+    for (o = 0, t = tab; o < 4; o++) {
+        for (i = 0; i < 4; i++) {
+            f32  m = matrix[o*5 + i] * 256.0f;
+            for (v = 0; v < 256; v++)  *t++ = (s32)floorf(m * v + 0.5f);
+        }
+        tab[4*4*256 + o] = (s32)floorf(matrix[o*5 + 4] * 256.0f + 0.5f) + 128;
+    }
+
+    BMFX_PointOp(texsrc, texdest, rect, dx, dy, BMFX_MatrixBlocks, tab);
+    free(tab);
+}
+
+/**
+ * Transform the colours of a texture with a 4x5 colour matrix.
+ * Each output channel is computed from the source channels as
+ * out = m[0]*R + m[1]*G + m[2]*B + m[3]*A + m[4], one row per channel
+ * (red, green, blue then alpha). The offset m[4] is in the 0-255 range.
+ * The matrix is turned into integer tables once, the texture is then
+ * processed with table lookups and additions only.
+ * @see GRRLIB_FlushTex
+ * @param texsrc The texture source.
+ * @param texdest The texture destination (may be the same as texsrc).
+ * @param matrix The 4x5 colour matrix, stored row by row.
+ */
+void  GRRLIB_BMFX_ColorMatrix (const GRRLIB_texImg *texsrc,
+                               GRRLIB_texImg *texdest, const f32 matrix[20]) {
+    const GRRLIB_rect  rect = { 0, 0, texsrc->w, texsrc->h };
+    BMFX_ColorMatrix(texsrc, texdest, &rect, 0, 0, matrix);
+}
+
+/**
+ * Transform the colours of a region of a texture with a 4x5 colour matrix.
+ * The destination area is flushed.
+ * @see GRRLIB_BMFX_ColorMatrix
+ * @param texsrc The texture source.
+ * @param texdest The texture destination (may be the same as texsrc).
+ * @param rect The source rectangle.
+ * @param dx The x-coordinate of the destination area.
+ * @param dy The y-coordinate of the destination area.
+ * @param matrix The 4x5 colour matrix, stored row by row.
+ */
+void  GRRLIB_BMFX_ColorMatrixRect (const GRRLIB_texImg *texsrc,
+                                   GRRLIB_texImg *texdest,
+                                   const GRRLIB_rect *rect,
+                                   const int dx, const int dy,
+                                   const f32 matrix[20]) {
+    GRRLIB_rect    r = *rect;
+    GRRLIB_texImg  copy;
+
+    if (!BMFX_Begin(&texsrc, texdest, &r, dx, dy, r.w, r.h, &copy))  return;
+    BMFX_ColorMatrix(texsrc, texdest, &r, dx, dy, matrix);
+    BMFX_End(texdest, dx, dy, r.w, r.h, &copy);
+}
+
+/**
+ * Lookup table block operation, ctx holds the A, R, G and B tables.
+ */
+static
+void  BMFX_LUTBlocks (const u8 *sp, u8 *dp, const uint nblocks,
+                      const void *ctx) {
+    const u8 * const  *lut = (const u8 * const *)ctx;
+    uint              b, p;
+
+    for (b = 0; b < nblocks; b++, sp += 64, dp += 64) {
+        for (p = 0; p < 32; p += 2) {
+            dp[p   ] = lut[0][sp[p   ]];
+            dp[p+ 1] = lut[1][sp[p+ 1]];
+            dp[p+32] = lut[2][sp[p+32]];
+            dp[p+33] = lut[3][sp[p+33]];
+        }
+    }
+}
+
+/**
+ * Remap every channel of a region of a texture through lookup tables.
+ * @param texsrc The texture source.
+ * @param texdest The texture destination (may be the same as texsrc).
+ * @param rect The source rectangle.
+ * @param dx The x-coordinate of the destination area.
+ * @param dy The y-coordinate of the destination area.
+ * @param lutR Table for the red channel, NULL to keep the channel.
+ * @param lutG Table for the green channel, NULL to keep the channel.
+ * @param lutB Table for the blue channel, NULL to keep the channel.
+ * @param lutA Table for the alpha channel, NULL to keep the channel.
+ */
+static
+void  BMFX_LUT (const GRRLIB_texImg *texsrc, GRRLIB_texImg *texdest,
+                const GRRLIB_rect *rect, const int dx, const int dy,
+                const u8 *lutR, const u8 *lutG,
+                const u8 *lutB, const u8 *lutA) {
+    u8        ident[256];
+    const u8  *lut[4];
+    int       i;
+
+    if (!BMFX_Editable(texsrc, texdest))  return;
+
+    for (i = 0; i < 256; i++)  ident[i] = i;
+    lut[0] = (lutA != NULL) ? lutA : ident;
+    lut[1] = (lutR != NULL) ? lutR : ident;
+    lut[2] = (lutG != NULL) ? lutG : ident;
+    lut[3] = (lutB != NULL) ? lutB : ident;
+
+    BMFX_PointOp(texsrc, texdest, rect, dx, dy, BMFX_LUTBlocks, lut);
+}
+
+/**
+ * Remap every channel of a texture through a 256 entry lookup table.
+ * Use the GRRLIB_BMFX_LUT* helpers to build gamma, levels or posterize tables.
+ * @see GRRLIB_FlushTex
+ * @param texsrc The texture source.
+ * @param texdest The texture destination (may be the same as texsrc).
+ * @param lutR Table for the red channel, NULL to keep the channel.
+ * @param lutG Table for the green channel, NULL to keep the channel.
+ * @param lutB Table for the blue channel, NULL to keep the channel.
+ * @param lutA Table for the alpha channel, NULL to keep the channel.
+ */
+void  GRRLIB_BMFX_LUT (const GRRLIB_texImg *texsrc, GRRLIB_texImg *texdest,
+                       const u8 *lutR, const u8 *lutG,
+                       const u8 *lutB, const u8 *lutA) {
+    const GRRLIB_rect  rect = { 0, 0, texsrc->w, texsrc->h };
+    BMFX_LUT(texsrc, texdest, &rect, 0, 0, lutR, lutG, lutB, lutA);
+}
+
+/**
+ * Remap every channel of a region of a texture through lookup tables.
+ * The destination area is flushed.
+ * @see GRRLIB_BMFX_LUT
+ * @param texsrc The texture source.
+ * @param texdest The texture destination (may be the same as texsrc).
+ * @param rect The source rectangle.
+ * @param dx The x-coordinate of the destination area.
+ * @param dy The y-coordinate of the destination area.
+ * @param lutR Table for the red channel, NULL to keep the channel.
+ * @param lutG Table for the green channel, NULL to keep the channel.
+ * @param lutB Table for the blue channel, NULL to keep the channel.
+ * @param lutA Table for the alpha channel, NULL to keep the channel.
+ */
+void  GRRLIB_BMFX_LUTRect (const GRRLIB_texImg *texsrc, GRRLIB_texImg *texdest,
+                           const GRRLIB_rect *rect, const int dx, const int dy,
+                           const u8 *lutR, const u8 *lutG,
+                           const u8 *lutB, const u8 *lutA) {
+    GRRLIB_rect    r = *rect;
+    GRRLIB_texImg  copy;
+
+    if (!BMFX_Begin(&texsrc, texdest, &r, dx, dy, r.w, r.h, &copy))  return;
+    BMFX_LUT(texsrc, texdest, &r, dx, dy, lutR, lutG, lutB, lutA);
+    BMFX_End(texdest, dx, dy, r.w, r.h, &copy);
+}
+
+/**
+ * Hash table used by the palette swap block operation.
+ */
+typedef struct {
+    const u32  *keys;   /**< Colours to replace, with bit 0 set (0 = free slot). */
+    const u32  *vals;   /**< Replacement colours.                                */
+    u32        mask;    /**< Table size minus one.                               */
+} BMFX_Palette;
+
+/**
+ * Palette swap block operation, ctx is a BMFX_Palette.
+ */
+static
+void  BMFX_PaletteBlocks (const u8 *sp, u8 *dp, const uint nblocks,
+                          const void *ctx) {
+    const BMFX_Palette  *pal = (const BMFX_Palette*)ctx;
+    u32                 k, h;
+    uint                b, p;
+
+    for (b = 0; b < nblocks; b++, sp += 64, dp += 64) {
+        for (p = 0; p < 32; p += 2) {
+            u8  sa = sp[p], sr = sp[p+1], sg = sp[p+32], sb = sp[p+33];
+            k = RGBA(sr, sg, sb, 1);
+            for (h = (k * 0x9E3779B1) >> 16;
+                 pal->keys[h & pal->mask] && pal->keys[h & pal->mask] != k; h++) ;
+            if (pal->keys[h & pal->mask]) {
+                u32  c = pal->vals[h & pal->mask];
+                sr = R(c);
+                sg = G(c);
+                sb = B(c);
+            }
+            dp[p   ] = sa;
+            dp[p+ 1] = sr;
+            dp[p+32] = sg;
+            dp[p+33] = sb;
+        }
+    }
+}
+
+/**
+ * Replace some exact colours of a region of a texture by other ones.
+ * @param texsrc The texture source.
+ * @param texdest The texture destination (may be the same as texsrc).
+ * @param rect The source rectangle.
+ * @param dx The x-coordinate of the destination area.
+ * @param dy The y-coordinate of the destination area.
+ * @param from Array of n colours to replace in RGBA format.
+ * @param to Array of n replacement colours in RGBA format.
+ * @param n Number of colours in both arrays.
+ */
+static
+void  BMFX_PaletteSwap (const GRRLIB_texImg *texsrc, GRRLIB_texImg *texdest,
+                        const GRRLIB_rect *rect, const int dx, const int dy,
+                        const u32 *from, const u32 *to, const uint n) {
+    BMFX_Palette  pal;
+    u32           *keys, *vals;
+    u32           mask, k, h;
+    uint          i;
+
+    if (!BMFX_Editable(texsrc, texdest))  return;
+
+    // Open addressing hash table, at most half full; keys have bit 0 set
+    for (mask = 16; mask < 2*n; mask <<= 1) ;
+    keys = calloc(mask, 2 * sizeof(u32));
+    if (keys == NULL)  return;
+    vals = keys + mask;
+    mask--;
+    for (i = 0; i < n; i++) {
+        k = (from[i] & 0xFFFFFF00) | 1;
+        for (h = (k * 0x9E3779B1) >> 16; keys[h & mask] && keys[h & mask] != k; h++) ;
+        keys[h & mask] = k;
+        vals[h & mask] = to[i];
+    }
+
+    pal.keys = keys;
+    pal.vals = vals;
+    pal.mask = mask;
+    BMFX_PointOp(texsrc, texdest, rect, dx, dy, BMFX_PaletteBlocks, &pal);
+    free(keys);
+}
+
+/**
+ * Replace some exact colours of a texture by other ones (e.g. team colours).
+ * Colours are matched on their red, green and blue components, the alpha of
+ * the source pixel is kept. Pixels of any other colour are copied as is.
+ * @see GRRLIB_FlushTex
+ * @param texsrc The texture source.
+ * @param texdest The texture destination (may be the same as texsrc).
+ * @param from Array of n colours to replace in RGBA format.
+ * @param to Array of n replacement colours in RGBA format.
+ * @param n Number of colours in both arrays.
+ */
+void  GRRLIB_BMFX_PaletteSwap (const GRRLIB_texImg *texsrc,
+                               GRRLIB_texImg *texdest,
+                               const u32 *from, const u32 *to, const uint n) {
+    const GRRLIB_rect  rect = { 0, 0, texsrc->w, texsrc->h };
+    BMFX_PaletteSwap(texsrc, texdest, &rect, 0, 0, from, to, n);
+}
+
+/**
+ * Replace some exact colours of a region of a texture by other ones.
+ * The destination area is flushed.
+ * @see GRRLIB_BMFX_PaletteSwap
+ * @param texsrc The texture source.
+ * @param texdest The texture destination (may be the same as texsrc).
+ * @param rect The source rectangle.
+ * @param dx The x-coordinate of the destination area.
+ * @param dy The y-coordinate of the destination area.
+ * @param from Array of n colours to replace in RGBA format.
+ * @param to Array of n replacement colours in RGBA format.
+ * @param n Number of colours in both arrays.
+ */
+void  GRRLIB_BMFX_PaletteSwapRect (const GRRLIB_texImg *texsrc,
+                                   GRRLIB_texImg *texdest,
+                                   const GRRLIB_rect *rect,
+                                   const int dx, const int dy,
+                                   const u32 *from, const u32 *to,
+                                   const uint n) {
+    GRRLIB_rect    r = *rect;
+    GRRLIB_texImg  copy;
+
+    if (!BMFX_Begin(&texsrc, texdest, &r, dx, dy, r.w, r.h, &copy))  return;
+    BMFX_PaletteSwap(texsrc, texdest, &r, dx, dy, from, to, n);
+    BMFX_End(texdest, dx, dy, r.w, r.h, &copy);
+}
+
+/**
+ * Fill a lookup table with a gamma curve.
+ * @see GRRLIB_BMFX_LUT
+ * @param lut The table to fill.
+ * @param gamma Gamma value, values above 1.0 brighten the image.
+ */
+void  GRRLIB_BMFX_LUTGamma (u8 lut[256], const f32 gamma) {
+    GRRLIB_BMFX_LUTLevels(lut, 0, 255, gamma, 0, 255);
+}
+
+/**
+ * Fill a lookup table with a levels adjustment.
+ * Input values are first mapped from inBlack..inWhite to 0..1, then raised
+ * to the power 1/gamma and finally mapped to outBlack..outWhite.
+ * @see GRRLIB_BMFX_LUT
+ * @param lut The table to fill.
+ * @param inBlack Input value mapped to black.
+ * @param inWhite Input value mapped to white.
+ * @param gamma Gamma value applied in between (1.0 for none).
+ * @param outBlack Output value for black.
+ * @param outWhite Output value for white.
+ */
+void  GRRLIB_BMFX_LUTLevels (u8 lut[256], const u8 inBlack, const u8 inWhite,
+                             const f32 gamma,
+                             const u8 outBlack, const u8 outWhite) {
+    f32  range = (inWhite > inBlack) ? (inWhite - inBlack) : 1.0f;
+    f32  expo  = (gamma > 0.0f) ? 1.0f / gamma : 1.0f;
+    f32  f;
+    int  i, v;
+
+    for (i = 0; i < 256; i++) {
+        f = (i - inBlack) / range;
+        if (f < 0.0f)  f = 0.0f;
+        if (f > 1.0f)  f = 1.0f;
+        if (expo != 1.0f)  f = powf(f, expo);
+        v = (int)floorf(outBlack + f * (outWhite - outBlack) + 0.5f);
+        lut[i] = BMFX_CLAMP(v);
+    }
+}
+
+/**
+ * Fill a lookup table that reduces a channel to a number of levels.
+ * @see GRRLIB_BMFX_LUT
+ * @param lut The table to fill.
+ * @param levels Number of distinct output values (2 to 255).
+ */
+void  GRRLIB_BMFX_LUTPosterize (u8 lut[256], const u8 levels) {
+    int  n = (levels < 2) ? 2 : levels;
+    int  i;
+
+    for (i = 0; i < 256; i++)
+        lut[i] = ((i * n) >> 8) * 255 / (n - 1);
 }
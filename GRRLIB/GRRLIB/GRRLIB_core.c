@@ -30,14 +30,167 @@ THE SOFTWARE.
 #include "grrlib/GRRLIB_private.h"
 
 #define DEFAULT_FIFO_SIZE (256 * 1024) /**< GX fifo buffer size. */
+#define FIFO_MAXQUADS     16383        /**< Quads that fit in one GX_Begin. */
+#define FIFO_SLACK        1024         /**< Bytes kept for the commands between runs. */
 
 GRRLIB_drawSettings  GRRLIB_Settings;
 Mtx                  GXmodelView2D;
 
-static void  *gp_fifo = NULL;
+static void       *gp_fifo = NULL;
+static GXFifoObj  fifoObj[2];           // Double FIFO mode: one for the CPU, one for the GP
+static u32        fifoSize   = 0;       // Size of each FIFO
+static u8         fifoCount  = 1;
+static u8         fifoCPU    = 0;       // FIFO the CPU writes to
+static u16        syncToken  = 0;       // Last draw sync token sent
+static u16        fifoToken  = 0;       // Token ending the FIFO given to the GP
+static u32        fifoPeak   = 0;       // Most bytes seen waiting this frame
+static u32        fifoStalls = 0;       // Waits for the GP this frame
+static bool       fifoListed = false;   // Commands go to a display list
 
 static bool  is_setup = false;  // To control entry and exit
 
+/**
+ * Send a draw sync token to the GP.
+ * @return The token, to be checked with GRRLIB_SyncReached.
+ */
+u16  GRRLIB_PutSync (void) {
+    GX_SetDrawSync(++syncToken);
+    return syncToken;
+}
+
+/**
+ * Tell whether the GP went past a draw sync token.
+ * Tokens are sent in increasing order, so any later token also counts.
+ * @param token A token from GRRLIB_PutSync.
+ * @return true if every command sent before the token is done.
+ */
+bool  GRRLIB_SyncReached (const u16 token) {
+    return (s16)(GX_GetDrawSync() - token) >= 0;
+}
+
+/**
+ * In double FIFO mode, give the commands recorded so far to the GP and
+ * switch the CPU to the other FIFO, once the GP is done with it.
+ */
+static
+void  FifoSwap (void) {
+    GXFifoObj  *cur = &fifoObj[fifoCPU];
+    GXFifoObj  *nxt = &fifoObj[fifoCPU ^ 1];
+    const u16  done = fifoToken;
+
+    fifoToken = GRRLIB_PutSync();   // Marks the end of this FIFO
+    GX_Flush();
+
+    if (!GRRLIB_SyncReached(done)) {
+        fifoStalls++;
+        while (!GRRLIB_SyncReached(done)) ;
+    }
+
+    GX_SaveCPUFifo(cur);
+    GX_SetGPFifo(cur);
+    GX_InitFifoPtrs(nxt, GX_GetFifoBase(nxt), GX_GetFifoBase(nxt));
+    GX_SetCPUFifo(nxt);
+    fifoCPU ^= 1;
+}
+
+/**
+ * Make sure the GP runs the commands recorded so far.
+ */
+void  GRRLIB_FifoSubmit (void) {
+    if (fifoCount == 2)  FifoSwap();
+}
+
+/**
+ * Wait for the GP to finish every command recorded so far.
+ * Use this instead of GX_DrawDone, which would wait forever in double
+ * FIFO mode, and would be taken for the end of a frame in pipelined mode.
+ */
+void  GRRLIB_DrawDone (void) {
+    u16  token;
+
+    if (GRRLIB_GetPipelined()) {
+        // The draw-done interrupt belongs to GRRLIB_Render, wait on a token
+        token = GRRLIB_PutSync();
+        GRRLIB_FifoSubmit();
+        GX_Flush();
+        while (!GRRLIB_SyncReached(token)) ;
+    }
+    else if (fifoCount == 2) {
+        GX_SetDrawDone();
+        FifoSwap();
+        GX_WaitDrawDone();
+    }
+    else {
+        GX_DrawDone();
+    }
+}
+
+/**
+ * Measure how full the command FIFO is. In double FIFO mode, the FIFO is
+ * handed to the GP once half full, so it never wraps over itself.
+ * Call this after each GX_End when drawing with GX directly.
+ */
+void  GRRLIB_FifoSample (void) {
+    GXFifoObj  obj;
+    void       *rd, *wt;
+    u32        used;
+
+    if (fifoListed)  return;
+
+    if (fifoCount == 2) {
+        GX_GetCPUFifo(&obj);
+        GX_GetFifoPtrs(&obj, &rd, &wt);
+        used = (u8*)wt - (u8*)GX_GetFifoBase(&fifoObj[fifoCPU]);
+    }
+    else {
+        GX_GetGPFifo(&obj);
+        used = GX_GetFifoCount(&obj);
+    }
+
+    if (used > fifoPeak)  fifoPeak = used;
+    if (fifoCount == 2 && used > fifoSize / 2)  FifoSwap();
+}
+
+/**
+ * Get the most quads a single GX_Begin may send. In double FIFO mode a run
+ * must fit in the half of the FIFO that GRRLIB_FifoSample keeps free, so
+ * long batches are split and sampled between runs.
+ * @param quadSize Bytes sent for one quad.
+ * @return The number of quads, at most FIFO_MAXQUADS.
+ */
+uint  GRRLIB_FifoQuads (const uint quadSize) {
+    uint  n;
+
+    if (fifoCount == 1 || fifoListed)  return FIFO_MAXQUADS;
+
+    n = (fifoSize / 2 > FIFO_SLACK) ? (fifoSize / 2 - FIFO_SLACK) / quadSize : 0;
+    if (n == 0)  n = 1;
+    return (n < FIFO_MAXQUADS) ? n : FIFO_MAXQUADS;
+}
+
+/**
+ * Tell the FIFO code whether commands are recorded in a display list.
+ * The FIFO is left alone while they are.
+ * @param listed true from GX_BeginDispList to GX_EndDispList.
+ */
+void  GRRLIB_FifoListed (const bool listed) {
+    fifoListed = listed;
+}
+
+/**
+ * Take the FIFO counters of the frame and start new ones.
+ * @param stats Receives the counters.
+ */
+void  GRRLIB_FifoStats (GRRLIB_drawStats *stats) {
+    GRRLIB_FifoSample();
+
+    stats->fifoPeak   = fifoPeak;
+    stats->fifoStalls = fifoStalls;
+    if (fifoCount == 1)  stats->fifoStalls += GX_ResetOverflowCount();
+    fifoPeak   = 0;
+    fifoStalls = 0;
+}
+
 /**
  * Initialize GRRLIB. Call this once at the beginning your code.
  * @return A integer representing a code:
@@ -48,6 +201,17 @@ static bool  is_setup = false;  // To control entry and exit
  * @see GRRLIB_Exit
  */
 int  GRRLIB_Init (void) {
+    return GRRLIB_InitEx(NULL);
+}
+
+/**
+ * Initialize GRRLIB with options. Call this once at the beginning your
+ * code, instead of GRRLIB_Init.
+ * @param opt The options, NULL or fields left to 0 for the defaults.
+ * @return A integer representing a code, like GRRLIB_Init.
+ * @see GRRLIB_Exit
+ */
+int  GRRLIB_InitEx (const GRRLIB_initOptions *opt) {
     f32 yscale;
     u32 xfbHeight;
     Mtx44 perspective;
@@ -92,9 +256,26 @@ int  GRRLIB_Init (void) {
     if (rmode->viTVMode & VI_NON_INTERLACE)  VIDEO_WaitVSync();
 
     // The FIFO is the buffer the CPU uses to send commands to the GPU
-    if ( !(gp_fifo = memalign(32, DEFAULT_FIFO_SIZE)) )  return -1;
-    memset(gp_fifo, 0, DEFAULT_FIFO_SIZE);
-    GX_Init(gp_fifo, DEFAULT_FIFO_SIZE);
+    fifoSize  = (opt != NULL && opt->fifoSize != 0) ? opt->fifoSize : DEFAULT_FIFO_SIZE;
+    fifoSize  = (fifoSize + 31) & ~31;
+    fifoCount = (opt != NULL && opt->fifoCount == 2) ? 2 : 1;
+    if ( !(gp_fifo = memalign(32, fifoSize * fifoCount)) )  return -1;
+    memset(gp_fifo, 0, fifoSize * fifoCount);
+    GX_Init(gp_fifo, fifoSize);
+
+    // Draw sync tokens count up from 0 in both modes
+    GX_SetDrawSync(0);
+    GX_DrawDone();
+    fifoToken = syncToken = 0;
+
+    // Double FIFO: the CPU fills one while the GP runs the other
+    if (fifoCount == 2) {
+        GX_InitFifoBase(&fifoObj[0], gp_fifo, fifoSize);
+        GX_InitFifoBase(&fifoObj[1], (u8*)gp_fifo + fifoSize, fifoSize);
+        GX_SetGPFifo (&fifoObj[1]);
+        GX_SetCPUFifo(&fifoObj[0]);
+        fifoCPU   = 0;
+    }
 
     // Clear the background to opaque black and clears the z-buffer
     GX_SetCopyClear((GXColor){ 0, 0, 0, 0 }, GX_MAX_Z24);
@@ -128,6 +309,11 @@ int  GRRLIB_Init (void) {
     GX_SetVtxAttrFmt(GX_VTXFMT0, GX_VA_TEX0, GX_TEX_ST,   GX_F32, 0);
     // Colour 0 is 8bit RGBA format
     GX_SetVtxAttrFmt(GX_VTXFMT0, GX_VA_CLR0, GX_CLR_RGBA, GX_RGBA8, 0);
+
+    // Compact 2D format: positions in 1/16 pixel, texture coordinates in 1/32768
+    GX_SetVtxAttrFmt(GRRLIB_VTXFMT_S16, GX_VA_POS,  GX_POS_XY,   GX_S16, GRRLIB_POS_FRAC);
+    GX_SetVtxAttrFmt(GRRLIB_VTXFMT_S16, GX_VA_TEX0, GX_TEX_ST,   GX_U16, GRRLIB_TEX_FRAC);
+    GX_SetVtxAttrFmt(GRRLIB_VTXFMT_S16, GX_VA_CLR0, GX_CLR_RGBA, GX_RGBA8, 0);
     GX_SetZMode(GX_FALSE, GX_LEQUAL, GX_TRUE);
 
     GX_SetNumChans(1);    // colour is the same as vertex colour
@@ -142,6 +328,7 @@ int  GRRLIB_Init (void) {
 
     guOrtho(perspective, 0.0f, rmode->efbHeight, 0.0f, rmode->fbWidth, 0.0f, 1000.0f);
     GX_LoadProjectionMtx(perspective, GX_ORTHOGRAPHIC);
+    GRRLIB_BatchMode2D(true);
 
     GX_SetViewport(0.0f, 0.0f, rmode->fbWidth, rmode->efbHeight, 0.0f, 1.0f);
     GX_SetBlendMode(GX_BM_BLEND, GX_BL_SRCALPHA, GX_BL_INVSRCALPHA, GX_LO_CLEAR);
@@ -152,9 +339,12 @@ int  GRRLIB_Init (void) {
     GRRLIB_ClipReset();
 
     // Default settings
-    GRRLIB_Settings.antialias = true;
-    GRRLIB_Settings.blend     = GRRLIB_BLEND_ALPHA;
-    GRRLIB_Settings.lights    = 0;
+    GRRLIB_Settings.antialias    = true;
+    GRRLIB_Settings.blend        = GRRLIB_BLEND_ALPHA;
+    GRRLIB_Settings.lights       = 0;
+    GRRLIB_Settings.premultiply  = false;
+    GRRLIB_Settings.premultColor = false;
+    GRRLIB_Settings.dirtyMode    = false;
 
     // Schedule cleanup for when program exits
     is_setup = true;
@@ -166,6 +356,8 @@ int  GRRLIB_Init (void) {
     // Initialise TTF
     if (GRRLIB_InitTTF())  error_code = -3;
 
+    if (opt != NULL && opt->pipelined && !GRRLIB_SetPipelined(true))  error_code = -1;
+
     VIDEO_SetBlack(false);  // Enable video output
     return error_code;
 }
@@ -180,7 +372,11 @@ void  GRRLIB_Exit (void) {
     if (done || !is_setup)  return;
     else                    done = true;
 
+    // Back to plain double buffering, without interrupt handlers
+    GRRLIB_SetPipelined(false);
+
     // Allow write access to the full screen
+    GRRLIB_Settings.dirtyMode = false;
     GX_SetClipMode( GX_CLIP_DISABLE );
     GX_SetScissor( 0, 0, rmode->fbWidth, rmode->efbHeight );
 
@@ -190,14 +386,27 @@ void  GRRLIB_Exit (void) {
     GRRLIB_FillScreen( 0x000000FF );  GRRLIB_Render();
 
     // Shut down the GX engine
-    GX_DrawDone();
+    GRRLIB_DrawDone();
     GX_AbortFrame();
 
     // Free up memory allocated for frame buffers & FIFOs
     if (xfb[0]  != NULL) {  free(MEM_K1_TO_K0(xfb[0]));  xfb[0]  = NULL;  }
     if (xfb[1]  != NULL) {  free(MEM_K1_TO_K0(xfb[1]));  xfb[1]  = NULL;  }
+    if (xfb[2]  != NULL) {  free(MEM_K1_TO_K0(xfb[2]));  xfb[2]  = NULL;  }
     if (gp_fifo != NULL) {  free(gp_fifo);               gp_fifo = NULL;  }
 
     // Done with TTF
     GRRLIB_ExitTTF();
+
+    // Release the sprite queue
+    GRRLIB_ExitQueue();
+
+    // Release the sprite batch work area
+    GRRLIB_ExitImgBatch();
+
+    // Release the cached shapes
+    GRRLIB_ExitShapes();
+
+    // Release the render target pool
+    GRRLIB_ExitRenderTargets();
 }
@@ -0,0 +1,169 @@
+/*------------------------------------------------------------------------------
+Copyright (c) 2012 The GRRLIB Team
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+------------------------------------------------------------------------------*/
+
+#include <malloc.h>
+#include <stdlib.h>
+
+#include <grrlib.h>
+#include "grrlib/GRRLIB_private.h"
+
+#define DL_MINSIZE  1024    /**< Smallest command buffer, in bytes. */
+
+/**
+ * Round a size up to the 32-byte granularity GX works with.
+ * @param size Size in bytes.
+ * @return The rounded size.
+ */
+static inline
+u32  DLAlign (const u32 size) {
+    return (size + 31) & ~31;
+}
+
+/**
+ * Wait until the GP is done with the last call of a display list, so its
+ * command buffer can be written or freed.
+ * @param dl A GRRLIB_dispList structure.
+ */
+static
+void  DLWait (GRRLIB_dispList *dl) {
+    if (!dl->called)  return;
+
+    // An old token may look pending once the counter wrapped, draining is always safe
+    if (!GRRLIB_SyncReached(dl->token))  GRRLIB_DrawDone();
+    dl->called = false;
+}
+
+/**
+ * Create an empty display list.
+ * The command buffer grows by itself when a recording does not fit.
+ * @param size Initial size of the command buffer in bytes, 0 for a default.
+ * @return A GRRLIB_dispList structure, or NULL on allocation failure.
+ */
+GRRLIB_dispList*  GRRLIB_DisplayListCreate (const u32 size) {
+    GRRLIB_dispList  *dl = calloc(1, sizeof(GRRLIB_dispList));
+
+    if (dl == NULL)  return NULL;
+
+    dl->capacity = DLAlign(size < DL_MINSIZE ? DL_MINSIZE : size);
+    dl->data     = memalign(32, dl->capacity);
+    if (dl->data == NULL) {
+        free(dl);
+        return NULL;
+    }
+    return dl;
+}
+
+/**
+ * Free memory allocated for a display list.
+ * @param dl A GRRLIB_dispList structure.
+ */
+void  GRRLIB_DisplayListFree (GRRLIB_dispList *dl) {
+    if (dl == NULL)  return;
+
+    DLWait(dl);                 // The GP may still be reading it
+    free(dl->data);
+    free(dl);
+}
+
+/**
+ * Start recording a display list, if it needs to be.
+ * A list needs recording when it is empty, was invalidated, or was
+ * recorded for a different key. The key is any value that changes when the
+ * content changes (a map revision, a score, a hash of the inputs...).
+ * When this returns true, draw the content with the usual GRRLIB functions
+ * then call GRRLIB_DisplayListEnd. Either way, GRRLIB_DisplayListCall
+ * draws the list afterwards.
+ * Textures used while recording are referenced, not copied: they must stay
+ * valid, and unchanged in memory, for as long as the list is replayed.
+ * @param dl A GRRLIB_dispList structure.
+ * @param key Value identifying the content of the list.
+ * @return true if the content must be drawn now to be recorded.
+ */
+bool  GRRLIB_DisplayListBegin (GRRLIB_dispList *dl, const u32 key) {
+    if (dl == NULL || dl->recording)  return false;
+    if (dl->size != 0 && dl->key == key)  return false;
+
+    GRRLIB_FlushPrimitives();   // Not part of the list
+    DLWait(dl);                 // The GP may still be reading the old list
+    dl->size      = 0;
+    dl->key       = key;
+    dl->recording = true;
+
+    // The write-gather pipe fills the list bypassing the cache, do not let dirty lines overwrite it
+    DCInvalidateRange(dl->data, dl->capacity);
+    GX_BeginDispList(dl->data, dl->capacity);
+    GRRLIB_FifoListed(true);
+    return true;
+}
+
+/**
+ * Stop recording a display list.
+ * If the commands did not fit, the buffer is enlarged and the list is left
+ * empty, so the next GRRLIB_DisplayListBegin records it again.
+ * @param dl A GRRLIB_dispList structure.
+ * @return The size of the recorded list in bytes, 0 on overflow.
+ */
+u32  GRRLIB_DisplayListEnd (GRRLIB_dispList *dl) {
+    void  *data;
+
+    if (dl == NULL || !dl->recording)  return 0;
+
+    GRRLIB_FlushPrimitives();   // Part of the list
+    dl->recording = false;
+    dl->size      = GX_EndDispList();
+    GRRLIB_FifoListed(false);
+
+    if (dl->size == 0) {
+        data = memalign(32, dl->capacity * 2);
+        if (data != NULL) {
+            free(dl->data);
+            dl->data      = data;
+            dl->capacity *= 2;
+        }
+    }
+    return dl->size;
+}
+
+/**
+ * Draw a recorded display list.
+ * Nothing is drawn if the list is empty.
+ * @param dl A GRRLIB_dispList structure.
+ */
+void  GRRLIB_DisplayListCall (GRRLIB_dispList *dl) {
+    if (dl == NULL || dl->recording || dl->size == 0)  return;
+
+    GRRLIB_FlushPrimitives();
+    GX_CallDispList(dl->data, dl->size);
+    dl->token  = GRRLIB_PutSync();
+    dl->called = true;
+}
+
+/**
+ * Force a display list to be recorded again on the next
+ * GRRLIB_DisplayListBegin, whatever the key.
+ * @param dl A GRRLIB_dispList structure.
+ */
+void  GRRLIB_DisplayListInvalidate (GRRLIB_dispList *dl) {
+    if (dl == NULL || dl->recording)  return;
+
+    dl->size = 0;
+}
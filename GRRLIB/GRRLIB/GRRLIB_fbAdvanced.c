@@ -20,12 +20,293 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 THE SOFTWARE.
 ------------------------------------------------------------------------------*/
 
+
 #include <math.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <grrlib.h>
+#include "grrlib/GRRLIB_private.h"
+
+#define SHAPE_TABLE   256       /**< Points of the finest circle, a power of 2. */
+#define SHAPE_MINSEG  8         /**< Segments of the coarsest circle. */
+#define SHAPE_LODS    6         /**< Circle sizes, from SHAPE_MINSEG to SHAPE_TABLE segments. */
+#define SHAPE_ERROR   0.25f     /**< Largest gap between a circle and its segments, in pixels. */
+#define SHAPE_MAXVTX  (SHAPE_TABLE + 8) /**< Vertices of the largest arc or rounded rectangle. */
+#define SHAPE_SLOTS   128       /**< Cached tessellations, a multiple of SHAPE_WAYS. */
+#define SHAPE_WAYS    4         /**< Slots one tessellation can be cached in. */
+#define SHAPE_CHUNK   96        /**< Triangle vertices handed to GX at a time. */
+#define SHAPE_STACK   64        /**< Polygon corners hashed without allocating. */
+
+/**
+ * Kinds of cached shapes, the first parameter of each cache entry.
+ */
+enum { SHAPE_ARC = 1, SHAPE_ROUNDRECT, SHAPE_POLYGON };
+
+/**
+ * A cached tessellation.
+ */
+typedef struct {
+    u32   hash;     /**< Hash of the parameters, 0 for a free slot. */
+    u32   stamp;    /**< Time of the last use.                      */
+    uint  nparam;   /**< Number of parameters.                      */
+    uint  nvtx;     /**< Number of vertices.                        */
+    uint  nidx;     /**< Number of triangle indices.                */
+    f32   *param;   /**< Parameters, then x and y of each vertex.   */
+    u16   *idx;     /**< Triangle indices.                          */
+} ShapeEntry;
+
+/**
+ * Builds the vertices of a shape from its parameters.
+ */
+typedef uint (*ShapeBuild)(const f32 *param, f32 *xy);
+
+static  f32         unitCos[SHAPE_TABLE];       // Unit circle, clockwise from the right
+static  f32         unitSin[SHAPE_TABLE];
+static  f32         lodRadius[SHAPE_LODS];      // Largest radius of each circle size
+static  bool        tableReady = false;
+static  ShapeEntry  cache[SHAPE_SLOTS];
+static  u32         shapeClock = 0;
+
+/**
+ * Fill the unit circle table and the radius limits of each circle size.
+ */
+static
+void  ShapeTable (void) {
+    uint  i, n;
+
+    for (i = 0; i < SHAPE_TABLE; i++) {
+        unitCos[i] = cosf(i * (2.0f * M_PI / SHAPE_TABLE));
+        unitSin[i] = sinf(i * (2.0f * M_PI / SHAPE_TABLE));
+    }
+    for (i = 0, n = SHAPE_MINSEG; i < SHAPE_LODS; i++, n *= 2)
+        lodRadius[i] = SHAPE_ERROR / (1.0f - cosf(M_PI / n));
+    tableReady = true;
+}
+
+/**
+ * Choose how finely to cut a circle: the fewest segments that stay within
+ * SHAPE_ERROR of the real circle.
+ * @param radius The radius of the circle.
+ * @return The step between two points in the unit circle table.
+ */
+static
+uint  ShapeStride (const f32 radius) {
+    uint  i, stride = SHAPE_TABLE / SHAPE_MINSEG;
+
+    if (!tableReady)  ShapeTable();
+    for (i = 0; i < SHAPE_LODS - 1 && fabsf(radius) > lodRadius[i]; i++)
+        stride /= 2;
+    return stride;
+}
+
+/**
+ * Hash the parameters of a shape (FNV-1a over their bits).
+ * @param param The parameters.
+ * @param n Number of parameters.
+ * @return A non-zero hash.
+ */
+static
+u32  ShapeHash (const f32 *param, const uint n) {
+    u32   h = 2166136261u, bits;
+    uint  i;
+
+    for (i = 0; i < n; i++) {
+        memcpy(&bits, &param[i], sizeof(bits));
+        h = (h ^ bits) * 16777619u;
+    }
+    return h ? h : 1;
+}
+
+/**
+ * Look for a tessellation in the cache.
+ * @param param The parameters of the shape.
+ * @param nparam Number of parameters.
+ * @param hash Hash of the parameters.
+ * @return The cache entry, or NULL if the shape is not cached.
+ */
+static
+ShapeEntry*  ShapeFind (const f32 *param, const uint nparam, const u32 hash) {
+    ShapeEntry  *e = &cache[hash % (SHAPE_SLOTS / SHAPE_WAYS) * SHAPE_WAYS];
+    uint        i;
+
+    for (i = 0; i < SHAPE_WAYS; i++, e++) {
+        if (e->hash == hash && e->nparam == nparam &&
+            memcmp(e->param, param, nparam * sizeof(f32)) == 0) {
+            e->stamp = ++shapeClock;
+            return e;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Make room for a tessellation in the cache, replacing the least recently
+ * used one of its slots.
+ * @param param The parameters of the shape, copied into the entry.
+ * @param nparam Number of parameters.
+ * @param hash Hash of the parameters.
+ * @param nvtx Number of vertices to hold.
+ * @param nidx Number of triangle indices to hold.
+ * @return The entry to fill, or NULL if memory is exhausted.
+ */
+static
+ShapeEntry*  ShapeStore (const f32 *param, const uint nparam, const u32 hash,
+                         const uint nvtx, const uint nidx) {
+    ShapeEntry  *e = &cache[hash % (SHAPE_SLOTS / SHAPE_WAYS) * SHAPE_WAYS];
+    ShapeEntry  *old = e;
+    f32         *mem;
+    uint        i;
+
+    for (i = 1; i < SHAPE_WAYS; i++)
+        if (e[i].stamp < old->stamp)  old = &e[i];
+
+    mem = malloc((nparam + nvtx * 2) * sizeof(f32) + nidx * sizeof(u16));
+    if (mem == NULL)  return NULL;
+    free(old->param);
+
+    memcpy(mem, param, nparam * sizeof(f32));
+    old->hash   = hash;
+    old->stamp  = ++shapeClock;
+    old->nparam = nparam;
+    old->nvtx   = nvtx;
+    old->nidx   = nidx;
+    old->param  = mem;
+    old->idx    = (u16*)(mem + nparam + nvtx * 2);
+    return old;
+}
+
+/**
+ * Draw vertices given relative to a position.
+ * @param xy The x and y coordinates of each vertex.
+ * @param n Number of vertices, at most SHAPE_MAXVTX.
+ * @param x The x-coordinate the vertices are relative to.
+ * @param y The y-coordinate the vertices are relative to.
+ * @param color The color of the shape in RGBA format.
+ * @param fmt Type of primitive.
+ */
+static
+void  ShapeDraw (const f32 *xy, const uint n, const f32 x, const f32 y,
+                 const u32 color, const u8 fmt) {
+    guVector  v[SHAPE_MAXVTX];
+    u32       c[SHAPE_MAXVTX];
+    uint      i;
+
+    for (i = 0; i < n; i++) {
+        v[i].x = xy[i * 2]     + x;
+        v[i].y = xy[i * 2 + 1] + y;
+        v[i].z = 0.0f;
+        c[i]   = color;
+    }
+    GRRLIB_GXEngine(v, c, n, fmt);
+}
+
+/**
+ * Draw a shape, building its vertices only if it is not cached yet.
+ * The first parameter is the kind of shape, the last one is the filled
+ * flag.
+ * @param param The parameters of the shape.
+ * @param nparam Number of parameters.
+ * @param build The function building the vertices.
+ * @param x The x-coordinate of the shape.
+ * @param y The y-coordinate of the shape.
+ * @param color The color of the shape in RGBA format.
+ */
+static
+void  ShapeCached (const f32 *param, const uint nparam, const ShapeBuild build,
+                   const f32 x, const f32 y, const u32 color) {
+    const u8    fmt  = param[nparam - 1] != 0.0f ? GX_TRIANGLEFAN : GX_LINESTRIP;
+    const u32   hash = ShapeHash(param, nparam);
+    ShapeEntry  *e   = ShapeFind(param, nparam, hash);
+    f32         xy[SHAPE_MAXVTX * 2];
+    uint        n;
+
+    if (e == NULL) {
+        n = build(param, xy);
+        e = ShapeStore(param, nparam, hash, n, 0);
+        if (e == NULL) {
+            ShapeDraw(xy, n, x, y, color, fmt);
+            return;
+        }
+        memcpy(e->param + nparam, xy, n * 2 * sizeof(f32));
+    }
+    ShapeDraw(e->param + nparam, e->nvtx, x, y, color, fmt);
+}
+
+/**
+ * Build the vertices of an arc: {SHAPE_ARC, radius, start, end, filled}.
+ * @param param The parameters of the arc.
+ * @param xy Receives the x and y coordinates of each vertex.
+ * @return Number of vertices.
+ */
+static
+uint  ShapeArc (const f32 *param, f32 *xy) {
+    const f32   r      = param[1];
+    const uint  stride = ShapeStride(r);
+    const f32   step   = 360.0f / SHAPE_TABLE * stride;
+    f32         a0 = param[2], a1 = param[3], turn, s, c;
+    f32         *p = xy;
+    int         k, k1;
+
+    if (a1 < a0) {  turn = a0;  a0 = a1;  a1 = turn;  }
+    if (a1 - a0 > 360.0f)  a1 = a0 + 360.0f;
+    turn = floorf(a0 / 360.0f) * 360.0f;
+    a0  -= turn;
+    a1  -= turn;
+
+    if (param[4] != 0.0f) {  *p++ = 0.0f;  *p++ = 0.0f;  }
+
+    // Exact end points, table points in between
+    GRRLIB_SinCos(a0, &s, &c);
+    *p++ = c * r;  *p++ = s * r;
+    k1 = (int)ceilf(a1 / step) - 1;
+    for (k = (int)floorf(a0 / step) + 1; k <= k1; k++) {
+        *p++ = unitCos[(k * (int)stride) & (SHAPE_TABLE - 1)] * r;
+        *p++ = unitSin[(k * (int)stride) & (SHAPE_TABLE - 1)] * r;
+    }
+    GRRLIB_SinCos(a1, &s, &c);
+    *p++ = c * r;  *p++ = s * r;
+
+    return (p - xy) / 2;
+}
+
+/**
+ * Build the vertices of a rounded rectangle:
+ * {SHAPE_ROUNDRECT, width, height, radius, filled}.
+ * @param param The parameters of the rectangle.
+ * @param xy Receives the x and y coordinates of each vertex.
+ * @return Number of vertices.
+ */
+static
+uint  ShapeRoundRect (const f32 *param, f32 *xy) {
+    const f32   w = param[1], h = param[2];
+    const f32   r = fmaxf(0.0f, fminf(param[3], fminf(w, h) * 0.5f));
+    const f32   cx[4] = {w - r, r, r, w - r};   // Corner centres, clockwise
+    const f32   cy[4] = {h - r, h - r, r, r};   // from the bottom right
+    const uint  quarter = SHAPE_TABLE / 4;
+    const uint  stride  = (r > 0.0f) ? ShapeStride(r) : quarter;
+    f32         *p = xy;
+    uint        q, i;
+
+    if (param[4] != 0.0f) {  *p++ = w * 0.5f;  *p++ = h * 0.5f;  }
+
+    for (q = 0; q < 4; q++) {
+        for (i = q * quarter; i <= (q + 1) * quarter; i += stride) {
+            *p++ = cx[q] + unitCos[i & (SHAPE_TABLE - 1)] * r;
+            *p++ = cy[q] + unitSin[i & (SHAPE_TABLE - 1)] * r;
+        }
+    }
+    // Close the outline
+    *p++ = cx[0] + r;
+    *p++ = cy[0];
+
+    return (p - xy) / 2;
+}
 
 /**
  * Draw a circle.
+ * The number of segments grows with the radius, and the points come from
+ * a precomputed unit circle.
  * @author Dark_Link
  * @param x Specifies the x-coordinate of the circle.
  * @param y Specifies the y-coordinate of the circle.
@@ -35,21 +316,264 @@ THE SOFTWARE.
  */
 void  GRRLIB_Circle (const f32 x,  const f32 y,  const f32 radius,
                      const u32 color, const u8 filled) {
-    guVector v[36];
-    u32 ncolor[36];
-    u32 a;
-    f32 ra;
-    f32 G_DTOR = M_DTOR * 10;
+    const uint  stride = ShapeStride(radius);
+    f32         xy[(SHAPE_TABLE + 2) * 2];
+    f32         *p = xy;
+    uint        i;
+
+    if (filled) {  *p++ = 0.0f;  *p++ = 0.0f;  }
+    for (i = 0; i <= SHAPE_TABLE; i += stride) {
+        *p++ = unitCos[i & (SHAPE_TABLE - 1)] * radius;
+        *p++ = unitSin[i & (SHAPE_TABLE - 1)] * radius;
+    }
+
+    ShapeDraw(xy, (p - xy) / 2, x, y, color,
+              filled ? GX_TRIANGLEFAN : GX_LINESTRIP);
+}
+
+/**
+ * Draw an arc of a circle.
+ * Angles are in degrees, clockwise from the right like the rotation of
+ * GRRLIB_DrawImg.
+ * @param x Specifies the x-coordinate of the centre.
+ * @param y Specifies the y-coordinate of the centre.
+ * @param radius The radius of the arc.
+ * @param start The angle the arc starts at.
+ * @param end The angle the arc ends at, at most a full turn after start.
+ * @param color The color of the arc in RGBA format.
+ * @param filled Set to true to draw a pie slice instead of the arc line.
+ */
+void  GRRLIB_Arc (const f32 x, const f32 y, const f32 radius,
+                  const f32 start, const f32 end,
+                  const u32 color, const u8 filled) {
+    const f32  param[5] = {SHAPE_ARC, radius, start, end, filled ? 1.0f : 0.0f};
+
+    ShapeCached(param, 5, ShapeArc, x, y, color);
+}
+
+/**
+ * Draw a rectangle with rounded corners.
+ * @param x Specifies the x-coordinate of the upper-left corner.
+ * @param y Specifies the y-coordinate of the upper-left corner.
+ * @param width The width of the rectangle.
+ * @param height The height of the rectangle.
+ * @param radius The radius of the corners, at most half the smaller side.
+ * @param color The color of the rectangle in RGBA format.
+ * @param filled Set to true to fill the rectangle.
+ */
+void  GRRLIB_RoundedRectangle (const f32 x, const f32 y,
+                               const f32 width, const f32 height,
+                               const f32 radius,
+                               const u32 color, const u8 filled) {
+    const f32  param[5] = {SHAPE_ROUNDRECT, width, height, radius,
+                           filled ? 1.0f : 0.0f};
+
+    ShapeCached(param, 5, ShapeRoundRect, x, y, color);
+}
+
+/**
+ * Draw a line of any width.
+ * @param x1 Starting point for line for the x coordinate.
+ * @param y1 Starting point for line for the y coordinate.
+ * @param x2 Ending point for line for the x coordinate.
+ * @param y2 Ending point for line for the x coordinate.
+ * @param width The width of the line in pixels.
+ * @param color Line color in RGBA format.
+ */
+void  GRRLIB_ThickLine (const f32 x1, const f32 y1,
+                        const f32 x2, const f32 y2,
+                        const f32 width, const u32 color) {
+    const f32  dx  = x2 - x1, dy = y2 - y1;
+    const f32  len = sqrtf(dx * dx + dy * dy);
+    const u32  c[4] = {color, color, color, color};
+    guVector   v[4];
+    f32        nx, ny;
+
+    if (len == 0.0f)  return;
+
+    // Half the width, across the line
+    nx = -dy * (width * 0.5f / len);
+    ny =  dx * (width * 0.5f / len);
+
+    v[0].x = x1 + nx;  v[0].y = y1 + ny;  v[0].z = 0.0f;
+    v[1].x = x2 + nx;  v[1].y = y2 + ny;  v[1].z = 0.0f;
+    v[2].x = x2 - nx;  v[2].y = y2 - ny;  v[2].z = 0.0f;
+    v[3].x = x1 - nx;  v[3].y = y1 - ny;  v[3].z = 0.0f;
+
+    GRRLIB_GXEngine(v, c, 4, GX_QUADS);
+}
+
+/**
+ * Tell whether a polygon is convex.
+ * @param v The corners of the polygon.
+ * @param n Number of corners.
+ * @return true if every corner turns the same way.
+ */
+static
+bool  ShapeConvex (const guVector v[], const uint n) {
+    uint  i, j, k;
+    bool  left = false, right = false;
+    f32   cross;
+
+    for (i = 0; i < n; i++) {
+        j = (i + 1) % n;
+        k = (i + 2) % n;
+        cross = (v[j].x - v[i].x) * (v[k].y - v[j].y)
+              - (v[j].y - v[i].y) * (v[k].x - v[j].x);
+        if      (cross > 0.0f)  left  = true;
+        else if (cross < 0.0f)  right = true;
+    }
+    return !(left && right);
+}
 
-    for (a = 0; a < 36; a++) {
-        ra = a * G_DTOR;
+/**
+ * Tell whether a corner of a polygon is an ear: convex, and with no other
+ * corner inside the triangle it forms with its neighbours.
+ * @param v The corners of the polygon.
+ * @param next The corner following each corner still in the polygon.
+ * @param a The corner before the tested one.
+ * @param b The tested corner.
+ * @param c The corner after the tested one.
+ * @param sign 1 or -1, the winding of the polygon.
+ * @return true if the triangle can be cut off.
+ */
+static
+bool  ShapeEar (const guVector v[], const u16 *next,
+                const uint a, const uint b, const uint c, const f32 sign) {
+    const f32  ax = v[a].x, ay = v[a].y, bx = v[b].x, by = v[b].y;
+    const f32  cx = v[c].x, cy = v[c].y;
+    f32        px, py;
+    uint       j;
 
-        v[a].x = cos(ra) * radius + x;
-        v[a].y = sin(ra) * radius + y;
-        v[a].z = 0.0f;
-        ncolor[a] = color;
+    if (((bx - ax) * (cy - by) - (by - ay) * (cx - bx)) * sign <= 0.0f)
+        return false;
+
+    for (j = next[c]; j != a; j = next[j]) {
+        px = v[j].x;
+        py = v[j].y;
+        if (((bx - ax) * (py - ay) - (by - ay) * (px - ax)) * sign >= 0.0f &&
+            ((cx - bx) * (py - by) - (cy - by) * (px - bx)) * sign >= 0.0f &&
+            ((ax - cx) * (py - cy) - (ay - cy) * (px - cx)) * sign >= 0.0f)
+            return false;
     }
+    return true;
+}
+
+/**
+ * Split a simple polygon into triangles by ear clipping.
+ * If the outline crosses itself and no ear is left, the rest is split as
+ * a fan.
+ * @param v The corners of the polygon.
+ * @param n Number of corners, at least 3.
+ * @param tri Receives 3 * (n - 2) corner indices.
+ * @return false if memory is exhausted.
+ */
+static
+bool  ShapeEarClip (const guVector v[], const uint n, u16 *tri) {
+    u16   *next, *prev;
+    f32   area = 0.0f;
+    uint  i, j, a, c, m = n, guard = n;
+
+    if ((next = malloc(n * 2 * sizeof(u16))) == NULL)  return false;
+    prev = next + n;
+
+    for (i = 0; i < n; i++) {
+        j       = (i + 1) % n;
+        next[i] = j;
+        prev[j] = i;
+        area   += v[i].x * v[j].y - v[j].x * v[i].y;
+    }
+
+    for (i = 0; m > 3; ) {
+        a = prev[i];
+        c = next[i];
+        if (ShapeEar(v, next, a, i, c, area < 0.0f ? -1.0f : 1.0f)) {
+            *tri++  = a;
+            *tri++  = i;
+            *tri++  = c;
+            next[a] = c;
+            prev[c] = a;
+            guard   = --m;
+            i       = a;
+        }
+        else {
+            if (--guard == 0)  break;   // No ear left
+            i = c;
+        }
+    }
+
+    // What is left, as a fan
+    for (j = next[i]; next[j] != i; j = next[j]) {
+        *tri++ = i;
+        *tri++ = j;
+        *tri++ = next[j];
+    }
+
+    free(next);
+    return true;
+}
+
+/**
+ * Draw a filled polygon.
+ * Concave polygons are split into triangles by ear clipping. The split is
+ * cached, so the same outline drawn again, even somewhere else, is not
+ * split again. The outline must not cross itself.
+ * @param v The vector containing the coordinates of the polygon.
+ * @param color The color of each corner in RGBA format.
+ * @param n Number of points in the vector.
+ */
+void  GRRLIB_NGoneFilled (const guVector v[], const u32 color[], const long n) {
+    f32         stack[1 + SHAPE_STACK * 2], *param = stack;
+    guVector    tv[SHAPE_CHUNK];
+    u32         tc[SHAPE_CHUNK];
+    const uint  nparam = 1 + n * 2;
+    ShapeEntry  *e;
+    u32         hash;
+    uint        i, m;
+
+    if (n < 3)  return;
+    if (n > 0xFFFF || ShapeConvex(v, n)) {
+        GRRLIB_GXEngine(v, color, n, GX_TRIANGLEFAN);
+        return;
+    }
+
+    // The outline relative to its first corner
+    if (n > SHAPE_STACK && (param = malloc(nparam * sizeof(f32))) == NULL)  return;
+    param[0] = SHAPE_POLYGON;
+    for (i = 0; i < n; i++) {
+        param[1 + i * 2] = v[i].x - v[0].x;
+        param[2 + i * 2] = v[i].y - v[0].y;
+    }
+
+    hash = ShapeHash(param, nparam);
+    e    = ShapeFind(param, nparam, hash);
+    if (e == NULL) {
+        e = ShapeStore(param, nparam, hash, 0, (n - 2) * 3);
+        if (e != NULL && !ShapeEarClip(v, n, e->idx))  e->hash = 0;
+    }
+    if (param != stack)  free(param);
+    if (e == NULL || e->hash == 0) {
+        GRRLIB_GXEngine(v, color, n, GX_TRIANGLEFAN);
+        return;
+    }
+
+    for (i = 0, m = 0; i < e->nidx; i++) {
+        tv[m]   = v[e->idx[i]];
+        tc[m++] = color[e->idx[i]];
+        if (m == SHAPE_CHUNK) {
+            GRRLIB_GXEngine(tv, tc, m, GX_TRIANGLES);
+            m = 0;
+        }
+    }
+    if (m != 0)  GRRLIB_GXEngine(tv, tc, m, GX_TRIANGLES);
+}
+
+/**
+ * Release the memory used by the shape cache.
+ */
+void  GRRLIB_ExitShapes (void) {
+    uint  i;
 
-    if (!filled)  GRRLIB_GXEngine(v, ncolor, 36, GX_LINESTRIP  );
-    else          GRRLIB_GXEngine(v, ncolor, 36, GX_TRIANGLEFAN);
+    for (i = 0; i < SHAPE_SLOTS; i++)  free(cache[i].param);
+    memset(cache, 0, sizeof(cache));
 }
@@ -0,0 +1,217 @@
+/*------------------------------------------------------------------------------
+Copyright (c) 2012 The GRRLIB Team
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+------------------------------------------------------------------------------*/
+
+#include <grrlib.h>
+#include "grrlib/GRRLIB_private.h"
+
+extern  Mtx  GXmodelView2D;
+
+#define PRIM_MAX     3072   /**< Vertices held before a flush, a multiple of 2 and 3. */
+#define PRIM_SIZE    16     /**< Bytes of one vertex sent to GX.                  */
+#define PRIM_SIZE16  8      /**< Same, with the compact vertex format.            */
+
+/**
+ * A pending vertex.
+ */
+typedef struct {
+    f32  x, y, z;       /**< Position.                    */
+    u32  color;         /**< Color in RGBA format.        */
+} PrimVertex;
+
+static  PrimVertex  primBuf[PRIM_MAX];      // Vertices waiting to be drawn
+static  uint        primCount   = 0;        // Number of pending vertices
+static  u8          primType    = GX_POINTS;// GX_POINTS, GX_LINES or GX_TRIANGLES
+static  bool        primCompact = true;     // Pending vertices fit the compact format
+static  bool        primMode2D  = true;     // The 2D projection and matrix are loaded
+
+/**
+ * Draw the pending points, lines and triangles.
+ * GRRLIB calls this by itself before anything that could change how they
+ * look (textures, blending, clipping, matrices, end of frame...). Call it
+ * before changing the GX state directly, like the line width.
+ */
+void  GRRLIB_FlushPrimitives (void) {
+    bool  compact;
+    uint  i, first, n, max;
+
+    if (primCount == 0)  return;
+
+    compact = primCompact && GRRLIB_CompactOK();
+
+    // Runs of whole points, lines and triangles that fit in the FIFO
+    max = GRRLIB_FifoQuads(6 * (compact ? PRIM_SIZE16 : PRIM_SIZE)) * 6;
+
+    for (first = 0; first < primCount; first += n) {
+        n = (primCount - first < max) ? primCount - first : max;
+        if (compact) {
+            GX_Begin(primType, GRRLIB_VTXFMT_S16, n);
+            for (i = first; i < first + n; i++) {
+                GX_Position2s16(GRRLIB_PosS16(primBuf[i].x), GRRLIB_PosS16(primBuf[i].y));
+                GX_Color1u32   (primBuf[i].color);
+            }
+        }
+        else {
+            GX_Begin(primType, GX_VTXFMT0, n);
+            for (i = first; i < first + n; i++) {
+                GX_Position3f32(primBuf[i].x, primBuf[i].y, primBuf[i].z);
+                GX_Color1u32   (primBuf[i].color);
+            }
+        }
+        GX_End();
+        GRRLIB_FifoSample();
+    }
+
+    primCount   = 0;
+    primCompact = true;
+}
+
+/**
+ * Check the current matrices let 2D drawing use the compact vertex format.
+ * Positions are only exact to 1/16 pixel, which is not enough once scaled
+ * or rotated, so the 2D model view must at most translate.
+ * @return true in 2D mode with such a model view.
+ */
+bool  GRRLIB_CompactOK (void) {
+    return primMode2D &&
+           GXmodelView2D[0][0] == 1.0f && GXmodelView2D[0][1] == 0.0f &&
+           GXmodelView2D[1][0] == 0.0f && GXmodelView2D[1][1] == 1.0f;
+}
+
+/**
+ * Tell the batch whether the 2D projection and model view are loaded.
+ * The compact vertex format is only used in 2D mode, the pending
+ * primitives are drawn first.
+ * @param mode2d true after GRRLIB_2dMode, false after GRRLIB_3dMode or
+ *               when a 3D object matrix is loaded.
+ */
+void  GRRLIB_BatchMode2D (const bool mode2d) {
+    GRRLIB_FlushPrimitives();
+    primMode2D = mode2d;
+}
+
+/**
+ * Make room for a number of vertices of a primitive type.
+ * @param type GX_POINTS, GX_LINES or GX_TRIANGLES.
+ * @param n Number of vertices to add, at most PRIM_MAX.
+ */
+static inline
+void  PrimReserve (const u8 type, const uint n) {
+    if (primType != type || primCount + n > PRIM_MAX) {
+        GRRLIB_FlushPrimitives();
+        primType = type;
+    }
+}
+
+/**
+ * Append one vertex to the pending primitives.
+ * @param v The position.
+ * @param color The color in RGBA format.
+ */
+static inline
+void  PrimAdd (const guVector *v, const u32 color) {
+    PrimVertex  *p = &primBuf[primCount++];
+
+    p->x     = v->x;
+    p->y     = v->y;
+    p->z     = v->z;
+    p->color = color;
+    if (v->z != 0.0f || v->x < GRRLIB_POS_MIN || v->x > GRRLIB_POS_MAX
+                     || v->y < GRRLIB_POS_MIN || v->y > GRRLIB_POS_MAX)
+        primCompact = false;
+}
+
+/**
+ * Add a primitive to the batch of pending points, lines and triangles.
+ * Consecutive primitives of the same kind are drawn with a single
+ * GX_Begin. Line strips become separate lines, and quads and triangle fans
+ * become separate triangles.
+ * @param fmt Type of primitive: GX_POINTS, GX_LINES, GX_LINESTRIP,
+ *            GX_TRIANGLES, GX_TRIANGLEFAN or GX_QUADS.
+ * @param v The vertices.
+ * @param color The color of each vertex in RGBA format.
+ * @param n Number of vertices.
+ * @return false, with the batch flushed, if the type of primitive cannot
+ *         be batched and must be drawn by the caller.
+ */
+bool  GRRLIB_BatchPrim (const u8 fmt, const guVector v[], const u32 color[],
+                        const long n) {
+    long  i;
+
+    switch (fmt) {
+        case GX_POINTS:
+            for (i = 0; i < n; i++) {
+                PrimReserve(GX_POINTS, 1);
+                PrimAdd(&v[i], color[i]);
+            }
+            return true;
+
+        case GX_LINES:
+            for (i = 0; i + 1 < n; i += 2) {
+                PrimReserve(GX_LINES, 2);
+                PrimAdd(&v[i],     color[i]);
+                PrimAdd(&v[i + 1], color[i + 1]);
+            }
+            return true;
+
+        case GX_LINESTRIP:
+            for (i = 0; i + 1 < n; i++) {
+                PrimReserve(GX_LINES, 2);
+                PrimAdd(&v[i],     color[i]);
+                PrimAdd(&v[i + 1], color[i + 1]);
+            }
+            return true;
+
+        case GX_TRIANGLES:
+            for (i = 0; i + 2 < n; i += 3) {
+                PrimReserve(GX_TRIANGLES, 3);
+                PrimAdd(&v[i],     color[i]);
+                PrimAdd(&v[i + 1], color[i + 1]);
+                PrimAdd(&v[i + 2], color[i + 2]);
+            }
+            return true;
+
+        case GX_TRIANGLEFAN:
+            for (i = 1; i + 1 < n; i++) {
+                PrimReserve(GX_TRIANGLES, 3);
+                PrimAdd(&v[0],     color[0]);
+                PrimAdd(&v[i],     color[i]);
+                PrimAdd(&v[i + 1], color[i + 1]);
+            }
+            return true;
+
+        case GX_QUADS:
+            for (i = 0; i + 3 < n; i += 4) {
+                PrimReserve(GX_TRIANGLES, 6);
+                PrimAdd(&v[i],     color[i]);
+                PrimAdd(&v[i + 1], color[i + 1]);
+                PrimAdd(&v[i + 2], color[i + 2]);
+                PrimAdd(&v[i],     color[i]);
+                PrimAdd(&v[i + 2], color[i + 2]);
+                PrimAdd(&v[i + 3], color[i + 3]);
+            }
+            return true;
+
+        default:
+            GRRLIB_FlushPrimitives();
+            return false;
+    }
+}
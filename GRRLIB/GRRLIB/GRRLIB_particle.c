@@ -0,0 +1,404 @@
+/*------------------------------------------------------------------------------
+Copyright (c) 2012 The GRRLIB Team
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+------------------------------------------------------------------------------*/
+
+#include <malloc.h>
+#include <stdlib.h>
+
+#include <grrlib.h>
+#include "grrlib/GRRLIB_private.h"
+
+extern  Mtx  GXmodelView2D;
+
+#define EMITTER_FIELDS    13        /**< Number of f32 arrays in an emitter. */
+#define EMITTER_COLORS    2         /**< Number of u32 arrays in an emitter. */
+#define EMITTER_QUADSIZE  96        /**< Bytes of one quad sent to GX.       */
+#define EMITTER_MINALPHA  (1.0f / 255.0f)   /**< Particles fainter than this are dead. */
+
+/**
+ * Create an empty particle emitter.
+ * All the particles live in one block of memory allocated here; nothing is
+ * allocated when particles are emitted.
+ * @param tex The texture to draw the particles with.
+ * @param capacity Maximum number of live particles.
+ * @return A GRRLIB_emitter structure, or NULL on failure.
+ */
+GRRLIB_emitter*  GRRLIB_CreateEmitter (GRRLIB_texImg *tex, const uint capacity) {
+    GRRLIB_emitter  *em;
+    f32             *pool;
+
+    if (tex == NULL || capacity == 0)  return NULL;
+
+    em = calloc(1, sizeof(GRRLIB_emitter));
+    if (em == NULL)  return NULL;
+
+    // Round each array to 8 floats so they all start on a cache line
+    em->capacity = (capacity + 7) & ~7;
+    pool = memalign(32, em->capacity * (EMITTER_FIELDS * sizeof(f32) +
+                                        EMITTER_COLORS * sizeof(u32)));
+    if (pool == NULL) {
+        free(em);
+        return NULL;
+    }
+
+    em->tex       = tex;
+    em->drag      = 1.0f;
+    em->x         = pool;
+    em->y         = em->x      + em->capacity;
+    em->vx        = em->y      + em->capacity;
+    em->vy        = em->vx     + em->capacity;
+    em->rot       = em->vy     + em->capacity;
+    em->vrot      = em->rot    + em->capacity;
+    em->scale     = em->vrot   + em->capacity;
+    em->growth    = em->scale  + em->capacity;
+    em->alpha     = em->growth + em->capacity;
+    em->fade      = em->alpha  + em->capacity;
+    em->life      = em->fade   + em->capacity;
+    em->blend     = em->life   + em->capacity;
+    em->blendRate = em->blend  + em->capacity;
+    em->color     = (u32 *)(em->blendRate + em->capacity);
+    em->colorEnd  = em->color  + em->capacity;
+    return em;
+}
+
+/**
+ * Free memory allocated for a particle emitter.
+ * The texture is not freed.
+ * @param em A GRRLIB_emitter structure.
+ */
+void  GRRLIB_FreeEmitter (GRRLIB_emitter *em) {
+    if (em == NULL)  return;
+
+    free(em->x);
+    free(em);
+}
+
+/**
+ * Add a particle to an emitter.
+ * @param em A GRRLIB_emitter structure.
+ * @param p Description of the particle.
+ * @return The index of the particle, or -1 if the emitter is full.
+ */
+int  GRRLIB_EmitParticle (GRRLIB_emitter *em, const GRRLIB_particle *p) {
+    uint  i;
+
+    if (em->count >= em->capacity)  return -1;
+
+    i = em->count++;
+    em->x[i]         = p->x;
+    em->y[i]         = p->y;
+    em->vx[i]        = p->vx;
+    em->vy[i]        = p->vy;
+    em->rot[i]       = p->rot;
+    em->vrot[i]      = p->vrot;
+    em->scale[i]     = p->scale;
+    em->growth[i]    = p->growth;
+    em->alpha[i]     = p->alpha;
+    em->fade[i]      = p->fade;
+    em->life[i]      = p->life;
+    em->blend[i]     = 0.0f;
+    em->blendRate[i] = p->colorRate;
+    em->color[i]     = p->color;
+    em->colorEnd[i]  = p->colorEnd;
+    return i;
+}
+
+/**
+ * Apply drag and acceleration to the speeds.
+ * @param vx Horizontal speeds.
+ * @param vy Vertical speeds.
+ * @param n Number of particles.
+ * @param drag Speed multiplier.
+ * @param ax Horizontal acceleration.
+ * @param ay Vertical acceleration.
+ */
+static
+void  KernelVelocity (f32 *restrict vx, f32 *restrict vy, const uint n,
+                      const f32 drag, const f32 ax, const f32 ay) {
+    uint  i;
+
+    for (i = 0; i < n; i++)  vx[i] = vx[i] * drag + ax;
+    for (i = 0; i < n; i++)  vy[i] = vy[i] * drag + ay;
+}
+
+/**
+ * Add a rate of change to a property, like speeds to positions.
+ * @param v The values to change.
+ * @param dv The rates of change.
+ * @param n Number of particles.
+ */
+static
+void  KernelAdd (f32 *restrict v, const f32 *restrict dv, const uint n) {
+    uint  i;
+
+    for (i = 0; i < n; i++)  v[i] += dv[i];
+}
+
+/**
+ * Multiply a property by a factor, like scales by growths.
+ * @param v The values to change.
+ * @param k The factors.
+ * @param n Number of particles.
+ */
+static
+void  KernelMul (f32 *restrict v, const f32 *restrict k, const uint n) {
+    uint  i;
+
+    for (i = 0; i < n; i++)  v[i] *= k[i];
+}
+
+/**
+ * Count down the life of the particles.
+ * @param life Updates left.
+ * @param n Number of particles.
+ */
+static
+void  KernelLife (f32 *restrict life, const uint n) {
+    uint  i;
+
+    for (i = 0; i < n; i++)  life[i] -= 1.0f;
+}
+
+/**
+ * Move the colours towards their end colour.
+ * @param blend Progress from the start to the end colour.
+ * @param rate Progress made each update.
+ * @param n Number of particles.
+ */
+static
+void  KernelColor (f32 *restrict blend, const f32 *restrict rate, const uint n) {
+    uint  i;
+
+    for (i = 0; i < n; i++)  blend[i] += rate[i];
+    for (i = 0; i < n; i++) {
+        if      (blend[i] > 1.0f)  blend[i] = 1.0f;
+        else if (blend[i] < 0.0f)  blend[i] = 0.0f;
+    }
+}
+
+/**
+ * Mix the start and end colours of a particle.
+ * @param from Start colour in RGBA format.
+ * @param to End colour in RGBA format.
+ * @param blend Progress from 0 (start colour) to 1 (end colour).
+ * @return The colour in RGBA format.
+ */
+static inline
+u32  EmitterColor (const u32 from, const u32 to, const f32 blend) {
+    const u32  k = blend * 256.0f;
+    u32        c = 0;
+    int        sh;
+
+    if (k == 0)  return from;
+    for (sh = 0; sh < 32; sh += 8) {
+        const u32  a = (from >> sh) & 0xFF;
+        const u32  b = (to   >> sh) & 0xFF;
+        c |= ((a * (256 - k) + b * k) >> 8) << sh;
+    }
+    return c;
+}
+
+/**
+ * Fade a premultiplied particle colour, scaling all of its components.
+ * @param color The colour in RGBA format.
+ * @param fade The particle alpha, from 0 to 255.
+ * @return The faded colour in RGBA format.
+ */
+static inline
+u32  EmitterFade (const u32 color, const u32 fade) {
+    u32  c = 0, v;
+    int  sh;
+
+    if (fade == 255)  return color;
+    for (sh = 0; sh < 32; sh += 8) {
+        v = ((color >> sh) & 0xFF) * fade + 128;
+        c |= ((v + (v >> 8)) >> 8) << sh;
+    }
+    return c;
+}
+
+/**
+ * Move the last particle of an emitter into a slot.
+ * @param em A GRRLIB_emitter structure.
+ * @param i The slot to fill.
+ */
+static inline
+void  EmitterMoveLast (GRRLIB_emitter *em, const uint i) {
+    const uint  j = em->count - 1;
+
+    em->x[i]         = em->x[j];
+    em->y[i]         = em->y[j];
+    em->vx[i]        = em->vx[j];
+    em->vy[i]        = em->vy[j];
+    em->rot[i]       = em->rot[j];
+    em->vrot[i]      = em->vrot[j];
+    em->scale[i]     = em->scale[j];
+    em->growth[i]    = em->growth[j];
+    em->alpha[i]     = em->alpha[j];
+    em->fade[i]      = em->fade[j];
+    em->life[i]      = em->life[j];
+    em->blend[i]     = em->blend[j];
+    em->blendRate[i] = em->blendRate[j];
+    em->color[i]     = em->color[j];
+    em->colorEnd[i]  = em->colorEnd[j];
+}
+
+/**
+ * Move every particle of an emitter one step forward.
+ * Each property is updated in its own pass over the arrays, then the dead
+ * particles (out of life, invisible or scaled to nothing) are removed by
+ * moving the last particle into their slot. This changes the order of the
+ * particles.
+ * @param em A GRRLIB_emitter structure.
+ */
+void  GRRLIB_UpdateEmitter (GRRLIB_emitter *em) {
+    const uint  n = em->count;
+    uint        i;
+
+    KernelVelocity(em->vx, em->vy, n, em->drag, em->ax, em->ay);
+    KernelAdd     (em->x,     em->vx,     n);
+    KernelAdd     (em->y,     em->vy,     n);
+    KernelAdd     (em->rot,   em->vrot,   n);
+    KernelMul     (em->scale, em->growth, n);
+    KernelMul     (em->alpha, em->fade,   n);
+    KernelLife    (em->life,  n);
+    KernelColor   (em->blend, em->blendRate, n);
+
+    for (i = 0; i < em->count; ) {
+        if (em->life[i] <= 0.0f || em->alpha[i] < EMITTER_MINALPHA
+                                || em->scale[i] <= 0.0f) {
+            EmitterMoveLast(em, i);
+            em->count--;
+        }
+        else {
+            i++;
+        }
+    }
+}
+
+/**
+ * Check a batch of particles can use the compact vertex format.
+ * @param em A GRRLIB_emitter structure.
+ * @param first First particle of the batch.
+ * @param n Number of particles.
+ * @param radius Distance from the centre to the farthest corner, at scale 1.
+ * @return true if every corner fits.
+ */
+static
+bool  EmitterCompact (const GRRLIB_emitter *em, const uint first,
+                      const uint n, const f32 radius) {
+    f32   r;
+    uint  i;
+
+    if (!GRRLIB_CompactOK())  return false;
+    for (i = first; i < first + n; i++) {
+        r = radius * (em->scale[i] < 0.0f ? -em->scale[i] : em->scale[i]);
+        if (em->x[i] - r < GRRLIB_POS_MIN || em->x[i] + r > GRRLIB_POS_MAX ||
+            em->y[i] - r < GRRLIB_POS_MIN || em->y[i] + r > GRRLIB_POS_MAX)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Draw all the particles of an emitter.
+ * The texture is loaded once and every particle goes in the same stream of
+ * quads, centred on its position.
+ * @param em A GRRLIB_emitter structure.
+ */
+void  GRRLIB_DrawEmitter (GRRLIB_emitter *em) {
+    const GRRLIB_texImg  *tex = em->tex;
+    const f32            hw   = tex->w * 0.5f;
+    const f32            hh   = tex->h * 0.5f;
+    f32                  s1 = 0.0f, s2 = 1.0f, t1 = 0.0f, t2 = 1.0f;
+    f32                  c, s, ax, ay, bx, by, x, y, a, tmp;
+    f32                  pos[8];
+    u16                  us1, us2, ut1, ut2;
+    uint                 i, k, batch = 0, max;
+    bool                 compact = false;
+    u32                  col;
+
+    if (em->count == 0 || tex->data == NULL)  return;
+
+    if (tex->flip & GRRLIB_FLIP_H) {  tmp = s1;  s1 = s2;  s2 = tmp;  }
+    if (tex->flip & GRRLIB_FLIP_V) {  tmp = t1;  t1 = t2;  t2 = tmp;  }
+    us1 = GRRLIB_TexU16(s1);  us2 = GRRLIB_TexU16(s2);
+    ut1 = GRRLIB_TexU16(t1);  ut2 = GRRLIB_TexU16(t2);
+
+    GRRLIB_BindTex(tex, tex->w, tex->h);
+    GX_LoadPosMtxImm(GXmodelView2D, GX_PNMTX0);
+    max = GRRLIB_FifoQuads(EMITTER_QUADSIZE);
+
+    for (i = 0; i < em->count; i++) {
+        if (batch == 0) {
+            batch = em->count - i;
+            if (batch > max)  batch = max;
+            compact = EmitterCompact(em, i, batch, hw + hh);
+            GX_Begin(GX_QUADS, compact ? GRRLIB_VTXFMT_S16 : GX_VTXFMT0,
+                     batch * 4);
+        }
+
+        if (em->rot[i] == 0.0f) {  c = 1.0f;  s = 0.0f;  }
+        else                       GRRLIB_SinCos(em->rot[i], &s, &c);
+
+        ax =  c * hw * em->scale[i];  ay = s * hw * em->scale[i];
+        bx = -s * hh * em->scale[i];  by = c * hh * em->scale[i];
+        x  = em->x[i];
+        y  = em->y[i];
+        pos[0] = x - ax - bx;  pos[1] = y - ay - by;
+        pos[2] = x + ax - bx;  pos[3] = y + ay - by;
+        pos[4] = x + ax + bx;  pos[5] = y + ay + by;
+        pos[6] = x - ax + bx;  pos[7] = y - ay + by;
+
+        a   = em->alpha[i] > 1.0f ? 255.0f
+            : em->alpha[i] > 0.0f ? em->alpha[i] * 255.0f : 0.0f;
+        col = EmitterColor(em->color[i], em->colorEnd[i], em->blend[i]);
+        if (tex->premult && GRRLIB_Settings.premultColor)
+            col = EmitterFade(col, (u8)a);
+        else
+            col = GRRLIB_TexColor(tex, (col & 0xFFFFFF00) | (u8)a);
+
+        if (compact) {
+            for (k = 0; k < 8; k += 2) {
+                GX_Position2s16(GRRLIB_PosS16(pos[k]), GRRLIB_PosS16(pos[k+1]));
+                GX_Color1u32   (col);
+                GX_TexCoord2u16((k == 0 || k == 6) ? us1 : us2,
+                                (k < 4) ? ut1 : ut2);
+            }
+        }
+        else {
+            for (k = 0; k < 8; k += 2) {
+                GX_Position3f32(pos[k], pos[k+1], 0);
+                GX_Color1u32   (col);
+                GX_TexCoord2f32((k == 0 || k == 6) ? s1 : s2,
+                                (k < 4) ? t1 : t2);
+            }
+        }
+
+        if (--batch == 0) {
+            GX_End();
+            GRRLIB_FifoSample();
+        }
+    }
+
+    GX_SetTevOp  (GX_TEVSTAGE0, GX_PASSCLR);
+    GX_SetVtxDesc(GX_VA_TEX0,   GX_NONE);
+}
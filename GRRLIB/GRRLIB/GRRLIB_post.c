@@ -0,0 +1,422 @@
+/*------------------------------------------------------------------------------
+Copyright (c) 2012 The GRRLIB Team
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+------------------------------------------------------------------------------*/
+
+
+#include <malloc.h>
+#include <string.h>
+
+#include <grrlib.h>
+#include "grrlib/GRRLIB_private.h"
+
+extern  GXRModeObj  *rmode;
+extern  Mtx         GXmodelView2D;
+
+/**
+ * Make a GXColor from a colour in RGBA format.
+ * @param color Color in RGBA format.
+ * @return The GXColor.
+ */
+static inline
+GXColor  PostColor (const u32 color) {
+    return (GXColor){ R(color), G(color), B(color), A(color) };
+}
+
+/**
+ * Load a render target in a texture map, with bilinear filtering.
+ * @param rt The render target.
+ * @param map The texture map to load it in.
+ */
+static
+void  PostBind (const GRRLIB_renderTarget *rt, const u8 map) {
+    GXTexObj  texObj;
+
+    GX_InitTexObj(&texObj, rt->tex.data, rt->tex.w, rt->tex.h,
+                  GRRLIB_TexFmtGX(rt->tex.format), GX_CLAMP, GX_CLAMP, GX_FALSE);
+    GX_InitTexObjLOD(&texObj, GX_LINEAR, GX_LINEAR,
+                     0.0f, 0.0f, 0.0f, 0, 0, GX_ANISO_1);
+    GX_LoadTexObj(&texObj, map);
+}
+
+/**
+ * Set up a TEV stage reading a texture, with an opaque output.
+ * The colour inputs are left to the caller.
+ * @param stage The TEV stage.
+ * @param coord The texture coordinates it uses.
+ * @param map The texture map it reads.
+ */
+static
+void  PostStage (const u8 stage, const u8 coord, const u8 map) {
+    GX_SetTevOrder     (stage, coord, map, GX_COLOR0A0);
+    GX_SetTevKAlphaSel (stage, GX_TEV_KASEL_1);
+    GX_SetTevAlphaIn   (stage, GX_CA_ZERO, GX_CA_ZERO, GX_CA_ZERO, GX_CA_KONST);
+    GX_SetTevAlphaOp   (stage, GX_TEV_ADD, GX_TB_ZERO, GX_CS_SCALE_1, GX_TRUE, GX_TEVPREV);
+}
+
+/**
+ * Draw a quad over the top left area of the EFB.
+ * @param w Width of the area.
+ * @param h Height of the area.
+ * @param color Vertex colour in RGBA format.
+ */
+static
+void  PostQuad (const f32 w, const f32 h, const u32 color) {
+    GX_Begin(GX_QUADS, GX_VTXFMT0, 4);
+        GX_Position3f32(0, 0, 0);
+        GX_Color1u32   (color);
+        GX_TexCoord2f32(0, 0);
+
+        GX_Position3f32(w, 0, 0);
+        GX_Color1u32   (color);
+        GX_TexCoord2f32(1, 0);
+
+        GX_Position3f32(w, h, 0);
+        GX_Color1u32   (color);
+        GX_TexCoord2f32(1, 1);
+
+        GX_Position3f32(0, h, 0);
+        GX_Color1u32   (color);
+        GX_TexCoord2f32(0, 1);
+    GX_End();
+}
+
+/**
+ * Set up the TEV for a blur pass: 4 taps, each one filtered by the
+ * texture unit, are averaged by 4 stages. Each tap has its own texture
+ * coordinates, offset by a texture matrix.
+ * @param rt The render target read.
+ * @param dist Distance of the taps from the centre, in texels.
+ */
+static
+void  PostBlur (const GRRLIB_renderTarget *rt, const f32 dist) {
+    static const s8  dir[4][2] = { {-1, -1}, {1, -1}, {1, 1}, {-1, 1} };
+    Mtx  m;
+    u8   i;
+
+    GX_SetNumTexGens  (4);
+    GX_SetNumTevStages(4);
+    for (i = 0; i < 4; i++) {
+        guMtxIdentity(m);
+        guMtxTransApply(m, m, dir[i][0] * dist / rt->tex.w,
+                              dir[i][1] * dist / rt->tex.h, 0);
+        GX_LoadTexMtxImm (m, GX_TEXMTX0 + i*3, GX_MTX2x4);
+        GX_SetTexCoordGen(GX_TEXCOORD0 + i, GX_TG_MTX2x4, GX_TG_TEX0, GX_TEXMTX0 + i*3);
+
+        // prev + tap / 4
+        PostStage(GX_TEVSTAGE0 + i, GX_TEXCOORD0 + i, GX_TEXMAP0);
+        GX_SetTevKColorSel(GX_TEVSTAGE0 + i, GX_TEV_KCSEL_1_4);
+        GX_SetTevColorIn  (GX_TEVSTAGE0 + i, GX_CC_ZERO, GX_CC_TEXC, GX_CC_KONST,
+                           (i == 0) ? GX_CC_ZERO : GX_CC_CPREV);
+        GX_SetTevColorOp  (GX_TEVSTAGE0 + i, GX_TEV_ADD, GX_TB_ZERO, GX_CS_SCALE_1,
+                           GX_TRUE, GX_TEVPREV);
+    }
+}
+
+/**
+ * Set up the TEV for a colour grade pass:
+ * ((grey + (colour - grey) * saturation) * gain + lift) * 2.
+ * @param pass The pass.
+ * @param grey I8 copy of the target, NULL to keep the saturation.
+ */
+static
+void  PostGrade (const GRRLIB_postPass *pass, const GRRLIB_renderTarget *grey) {
+    const f32  sat = (pass->param < 0.0f) ? 0.0f : (pass->param > 1.0f) ? 1.0f : pass->param;
+    u8         stage = GX_TEVSTAGE0;
+
+    // Colour of the target
+    PostStage(stage, GX_TEXCOORD0, GX_TEXMAP0);
+    GX_SetTevColorIn(stage, GX_CC_ZERO, GX_CC_ZERO, GX_CC_ZERO, GX_CC_TEXC);
+    GX_SetTevColorOp(stage, GX_TEV_ADD, GX_TB_ZERO, GX_CS_SCALE_1, GX_TRUE, GX_TEVPREV);
+    stage++;
+
+    // Saturation: from the grey copy to the colour
+    if (grey != NULL) {
+        PostBind(grey, GX_TEXMAP1);
+        GX_SetTevKColor   (GX_KCOLOR0, PostColor(0x01010101 * (u8)(sat * 255.0f)));
+        PostStage(stage, GX_TEXCOORD0, GX_TEXMAP1);
+        GX_SetTevKColorSel(stage, GX_TEV_KCSEL_K0);
+        GX_SetTevColorIn  (stage, GX_CC_TEXC, GX_CC_CPREV, GX_CC_KONST, GX_CC_ZERO);
+        GX_SetTevColorOp  (stage, GX_TEV_ADD, GX_TB_ZERO, GX_CS_SCALE_1, GX_TRUE, GX_TEVPREV);
+        stage++;
+    }
+
+    // Gain and lift, doubled so a gain of 0x80 keeps the colour
+    GX_SetTevKColor   (GX_KCOLOR1, PostColor(pass->color));
+    GX_SetTevColor    (GX_TEVREG1, PostColor(pass->color2));
+    PostStage(stage, GX_TEXCOORDNULL, GX_TEXMAP_NULL);
+    GX_SetTevKColorSel(stage, GX_TEV_KCSEL_K1);
+    GX_SetTevColorIn  (stage, GX_CC_ZERO, GX_CC_CPREV, GX_CC_KONST, GX_CC_C1);
+    GX_SetTevColorOp  (stage, GX_TEV_ADD, GX_TB_ZERO, GX_CS_SCALE_2, GX_TRUE, GX_TEVPREV);
+    stage++;
+
+    GX_SetNumTevStages(stage);
+}
+
+/**
+ * Put back the TEV and texture coordinate setup the other draw functions expect.
+ */
+static
+void  PostRestore (void) {
+    GX_SetNumTexGens  (1);
+    GX_SetTexCoordGen (GX_TEXCOORD0, GX_TG_MTX2x4, GX_TG_TEX0, GX_IDENTITY);
+    GX_SetNumTevStages(1);
+    GX_SetTevOrder    (GX_TEVSTAGE0, GX_TEXCOORD0, GX_TEXMAP0, GX_COLOR0A0);
+    GX_SetTevOp       (GX_TEVSTAGE0, GX_PASSCLR);
+    GX_SetVtxDesc     (GX_VA_TEX0,   GX_NONE);
+}
+
+/**
+ * Create a post-processing chain.
+ * The passes are checked and their targets created: every target must be
+ * written by a COPY pass before it is read, and always with the same size
+ * and format. Their memory comes from the render target pool.
+ * @param pass The passes, copied into the chain.
+ * @param count Number of passes.
+ * @return A post-processing chain, or NULL if a pass is wrong or there is not enough memory.
+ * @see GRRLIB_ApplyPostChain, GRRLIB_FreePostChain
+ */
+GRRLIB_postChain*  GRRLIB_CreatePostChain (const GRRLIB_postPass *pass, const uint count) {
+    GRRLIB_postChain     *chain;
+    GRRLIB_renderTarget  *rt;
+    uint                 i, w, h;
+
+    if (pass == NULL || count == 0)  return NULL;
+    if ( !(chain = calloc(1, sizeof(GRRLIB_postChain))) )  return NULL;
+    if ( !(chain->pass = malloc(count * sizeof(GRRLIB_postPass))) ) {
+        free(chain);
+        return NULL;
+    }
+    memcpy(chain->pass, pass, count * sizeof(GRRLIB_postPass));
+    chain->count = count;
+
+    for (i = 0; i < count; i++) {
+        const GRRLIB_postPass  *p = &pass[i];
+
+        if (p->target >= GRRLIB_POST_TARGETS || p->scale == 0)  break;
+
+        if (p->op == GRRLIB_POST_COPY) {
+            w  = rmode->fbWidth   / p->scale;
+            h  = rmode->efbHeight / p->scale;
+            rt = chain->target[p->target];
+            if (rt == NULL) {
+                rt = GRRLIB_CreateRenderTarget(w, h, p->format, p->half);
+                if ( !(chain->target[p->target] = rt) )  break;
+            }
+            else if (rt->half != p->half || rt->tex.format != p->format ||
+                     rt->srcw < w || rt->srch < h)  break;
+        }
+        else {
+            if (chain->target[p->target] == NULL)  break;
+            if (p->op == GRRLIB_POST_GRADE && p->param < 1.0f &&
+                (p->target2 >= GRRLIB_POST_TARGETS ||
+                 chain->target[p->target2] == NULL))  break;
+        }
+    }
+
+    if (i != count) {
+        GRRLIB_FreePostChain(chain);
+        return NULL;
+    }
+    return chain;
+}
+
+/**
+ * Create a bloom chain: the parts of the screen brighter than a threshold
+ * are blurred at half and quarter size, then added over the screen.
+ * The screen itself is kept in RGBA8 so it is drawn back without banding.
+ * @param threshold Brightness under which nothing glows, in RGBA format.
+ * @param tint Colour and strength of the glow, in RGBA format.
+ * @return A post-processing chain, or NULL if there is not enough memory.
+ */
+GRRLIB_postChain*  GRRLIB_CreatePostBloom (const u32 threshold, const u32 tint) {
+    const GRRLIB_postPass  pass[] = {
+        { .op = GRRLIB_POST_COPY,   .target = 0, .scale = 1, .format = GRRLIB_TEXFMT_RGBA8 },
+        { .op = GRRLIB_POST_BRIGHT, .target = 0, .scale = 1, .color = threshold },
+        { .op = GRRLIB_POST_COPY,   .target = 1, .scale = 1, .half = true, .format = GRRLIB_TEXFMT_RGB565 },
+        { .op = GRRLIB_POST_BLUR,   .target = 1, .scale = 2, .param = 0.5f },
+        { .op = GRRLIB_POST_COPY,   .target = 2, .scale = 2, .half = true, .format = GRRLIB_TEXFMT_RGB565 },
+        { .op = GRRLIB_POST_BLUR,   .target = 2, .scale = 4, .param = 0.5f },
+        { .op = GRRLIB_POST_COPY,   .target = 3, .scale = 4, .format = GRRLIB_TEXFMT_RGB565 },
+        { .op = GRRLIB_POST_DRAW,   .target = 0, .scale = 1, .blend = GRRLIB_BLEND_ALPHA, .color = 0xFFFFFFFF },
+        { .op = GRRLIB_POST_DRAW,   .target = 3, .scale = 1, .blend = GRRLIB_BLEND_ADD,   .color = tint },
+    };
+
+    return GRRLIB_CreatePostChain(pass, sizeof(pass) / sizeof(pass[0]));
+}
+
+/**
+ * Create a blur chain: the screen is scaled down and blurred, then
+ * stretched back over the screen with bilinear filtering.
+ * @param levels Number of times the screen is halved, from 1 to 3.
+ * @return A post-processing chain, or NULL if there is not enough memory.
+ */
+GRRLIB_postChain*  GRRLIB_CreatePostBlur (const uint levels) {
+    GRRLIB_postPass  pass[8];
+    uint             i, n = 0, scale = 1;
+    const uint       count = (levels < 1) ? 1 : (levels > 3) ? 3 : levels;
+
+    memset(pass, 0, sizeof(pass));
+    for (i = 0; i < count; i++) {
+        pass[n].op     = GRRLIB_POST_COPY;
+        pass[n].target = i;
+        pass[n].scale  = scale;
+        pass[n].half   = true;
+        pass[n].format = GRRLIB_TEXFMT_RGB565;
+        n++;
+        scale *= 2;
+        pass[n].op     = GRRLIB_POST_BLUR;
+        pass[n].target = i;
+        pass[n].scale  = scale;
+        pass[n].param  = 0.5f;  // Bilinear taps between two texels
+        n++;
+    }
+    pass[n].op     = GRRLIB_POST_COPY;
+    pass[n].target = count;
+    pass[n].scale  = scale;
+    pass[n].format = GRRLIB_TEXFMT_RGB565;
+    n++;
+    pass[n].op     = GRRLIB_POST_DRAW;
+    pass[n].target = count;
+    pass[n].scale  = 1;
+    pass[n].blend  = GRRLIB_BLEND_ALPHA;
+    pass[n].color  = 0xFFFFFFFF;
+    n++;
+
+    return GRRLIB_CreatePostChain(pass, n);
+}
+
+/**
+ * Create a colour grade chain:
+ * ((grey + (colour - grey) * saturation) * gain + lift) * 2.
+ * @param gain Factor of each component, in RGBA format. 0x808080FF keeps the colours.
+ * @param lift Added to each component before doubling, in RGBA format.
+ * @param saturation 1.0 keeps the colours, 0.0 makes them grey.
+ * @return A post-processing chain, or NULL if there is not enough memory.
+ */
+GRRLIB_postChain*  GRRLIB_CreatePostGrade (const u32 gain, const u32 lift,
+                                           const f32 saturation) {
+    GRRLIB_postPass  pass[3];
+    uint             n = 0;
+
+    memset(pass, 0, sizeof(pass));
+    pass[n].op      = GRRLIB_POST_COPY;
+    pass[n].target  = 0;
+    pass[n].scale   = 1;
+    pass[n].format  = GRRLIB_TEXFMT_RGB565;
+    n++;
+    // The copy unit converts to grey: no grey copy needed when the saturation is kept
+    if (saturation < 1.0f) {
+        pass[n].op      = GRRLIB_POST_COPY;
+        pass[n].target  = 1;
+        pass[n].scale   = 1;
+        pass[n].format  = GRRLIB_TEXFMT_I8;
+        n++;
+    }
+    pass[n].op      = GRRLIB_POST_GRADE;
+    pass[n].target  = 0;
+    pass[n].target2 = 1;
+    pass[n].scale   = 1;
+    pass[n].color   = gain;
+    pass[n].color2  = lift;
+    pass[n].param   = saturation;
+    n++;
+
+    return GRRLIB_CreatePostChain(pass, n);
+}
+
+/**
+ * Run a post-processing chain over the EFB. Call it in 2D mode, after
+ * drawing the scene and before drawing what it should not touch, like
+ * the user interface.
+ * @param chain The post-processing chain.
+ */
+void  GRRLIB_ApplyPostChain (const GRRLIB_postChain *chain) {
+    const GRRLIB_blendMode  blend = GRRLIB_Settings.blend;
+    const GRRLIB_postPass   *p;
+    GRRLIB_renderTarget     *rt;
+    uint                    i;
+    f32                     w, h;
+
+    if (chain == NULL)  return;
+
+    GRRLIB_QueueFlush();
+    GRRLIB_FlushPrimitives();
+    GX_LoadPosMtxImm(GXmodelView2D, GX_PNMTX0);
+    GX_SetVtxDesc(GX_VA_TEX0, GX_DIRECT);
+
+    for (i = 0, p = chain->pass; i < chain->count; i++, p++) {
+        rt = chain->target[p->target];
+        w  = rmode->fbWidth   / p->scale;
+        h  = rmode->efbHeight / p->scale;
+
+        if (p->op == GRRLIB_POST_COPY) {
+            GRRLIB_RenderTargetCopy(rt, 0, 0, false);
+            continue;
+        }
+
+        PostBind(rt, GX_TEXMAP0);
+        switch (p->op) {
+            case GRRLIB_POST_BRIGHT:
+                // (texture - threshold) * 2
+                GX_SetTevKColor   (GX_KCOLOR0, PostColor(p->color));
+                PostStage(GX_TEVSTAGE0, GX_TEXCOORD0, GX_TEXMAP0);
+                GX_SetTevKColorSel(GX_TEVSTAGE0, GX_TEV_KCSEL_K0);
+                GX_SetTevColorIn  (GX_TEVSTAGE0, GX_CC_KONST, GX_CC_ZERO, GX_CC_ZERO, GX_CC_TEXC);
+                GX_SetTevColorOp  (GX_TEVSTAGE0, GX_TEV_SUB, GX_TB_ZERO, GX_CS_SCALE_2,
+                                   GX_TRUE, GX_TEVPREV);
+                break;
+            case GRRLIB_POST_BLUR:
+                PostBlur(rt, p->param);
+                break;
+            case GRRLIB_POST_GRADE:
+                PostGrade(p, (p->param < 1.0f) ? chain->target[p->target2] : NULL);
+                break;
+            default:
+                GX_SetTevOp(GX_TEVSTAGE0, GX_MODULATE);
+                break;
+        }
+
+        if (p->op == GRRLIB_POST_DRAW)  GRRLIB_SetBlend(p->blend);
+        else                            GRRLIB_SetBlend(GRRLIB_BLEND_ALPHA);
+        PostQuad(w, h, (p->op == GRRLIB_POST_DRAW) ? p->color : 0xFFFFFFFF);
+        PostRestore();
+        GX_SetVtxDesc(GX_VA_TEX0, GX_DIRECT);
+        GRRLIB_FifoSample();
+    }
+
+    GX_SetVtxDesc(GX_VA_TEX0, GX_NONE);
+    GRRLIB_SetBlend(blend);
+}
+
+/**
+ * Free a post-processing chain and give its targets back to the pool.
+ * @param chain The post-processing chain.
+ */
+void  GRRLIB_FreePostChain (GRRLIB_postChain *chain) {
+    uint  i;
+
+    if (chain == NULL)  return;
+
+    for (i = 0; i < GRRLIB_POST_TARGETS; i++)
+        GRRLIB_FreeRenderTarget(chain->target[i]);
+    free(chain->pass);
+    free(chain);
+}
@@ -0,0 +1,372 @@
+/*------------------------------------------------------------------------------
+Copyright (c) 2012 The GRRLIB Team
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+------------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <grrlib.h>
+#include "grrlib/GRRLIB_private.h"
+
+extern  GRRLIB_drawSettings  GRRLIB_Settings;
+extern  Mtx                  GXmodelView2D;
+
+#define QUEUE_TEXHASH   (4096)      /**< Size of the texture id table, a power of two. */
+#define QUEUE_QUADSIZE  (96)        /**< Bytes of one quad in the full vertex format. */
+
+/**
+ * Sort key layout, from the most to the least significant bits:
+ * layer (8), blending mode (3), texture id (21), submission index (32).
+ */
+#define QUEUE_KEY(layer, blend, texid, index) \
+    (((u64)(layer) << 56) | ((u64)((blend) & 7) << 53) | \
+     ((u64)((texid) & 0x1FFFFF) << 32) | (u64)(index))
+
+/**
+ * A sprite waiting in the queue.
+ */
+typedef struct {
+    const GRRLIB_texImg  *tex;      /**< The texture to draw.                    */
+    f32                  pos[8];    /**< Screen corners, clockwise from top-left. */
+    f32                  s1, s2;    /**< Horizontal texture coordinates.         */
+    f32                  t1, t2;    /**< Vertical texture coordinates.           */
+    u32                  color;     /**< Vertex colour, as sent to GX.           */
+    bool                 compact;   /**< Corners fit the compact vertex format.  */
+} QueueSprite;
+
+static  QueueSprite          *sprites = NULL;   // Queued sprites, in submission order
+static  u64                  *keys    = NULL;   // Sort keys
+static  u64                  *swap    = NULL;   // Radix sort buffer
+static  uint                 count    = 0;
+static  uint                 capacity = 0;
+
+static  const GRRLIB_texImg  *texKeys[QUEUE_TEXHASH];   // Texture -> id table
+static  u32                  texIds[QUEUE_TEXHASH];
+static  u32                  texCount = 0;
+
+/**
+ * Get the small id of a texture, ids are given in order of first use.
+ * @param tex The texture.
+ * @return The texture id.
+ */
+static
+u32  QueueTexId (const GRRLIB_texImg *tex) {
+    u32  h = (((u32)(size_t)tex) >> 5) * 0x9E3779B1;
+    u32  i;
+
+    for (i = 0; i < QUEUE_TEXHASH; i++, h++) {
+        h &= QUEUE_TEXHASH - 1;
+        if (texKeys[h] == tex)  return texIds[h];
+        if (texKeys[h] == NULL) {
+            texKeys[h] = tex;
+            return texIds[h] = texCount++;
+        }
+    }
+    return 0x1FFFFF;  // Table full: still correct, only less batching
+}
+
+/**
+ * Reserve a sprite at the end of the queue.
+ * @param layer The layer of the sprite.
+ * @param tex The texture of the sprite.
+ * @return The sprite to fill, or NULL if memory is exhausted.
+ */
+static
+QueueSprite*  QueueAdd (const u8 layer, const GRRLIB_texImg *tex) {
+    if (count == capacity) {
+        uint         newcap = capacity ? capacity * 2 : 256;
+        QueueSprite  *s = realloc(sprites, newcap * sizeof(QueueSprite));
+        u64          *k;
+
+        if (s == NULL)  return NULL;
+        sprites = s;
+        k = realloc(keys, newcap * 2 * sizeof(u64));
+        if (k == NULL)  return NULL;
+        keys     = k;
+        swap     = k + newcap;
+        capacity = newcap;
+    }
+    keys[count] = QUEUE_KEY(layer, GRRLIB_Settings.blend, QueueTexId(tex), count);
+    return &sprites[count++];
+}
+
+/**
+ * Sort the keys of the queue.
+ * The keys are submitted in index order, so only the layer, blending and
+ * texture bytes need radix passes; LSD radix sort is stable and keeps the
+ * submission order for equal keys. Passes on bytes that are the same for
+ * every key are skipped.
+ */
+static
+void  QueueSort (void) {
+    u32   hist[256];
+    u64   *src = keys, *dst = swap, *t;
+    uint  shift, i, sum, c;
+
+    for (shift = 32; shift < 64; shift += 8) {
+        memset(hist, 0, sizeof(hist));
+        for (i = 0; i < count; i++)  hist[(src[i] >> shift) & 0xFF]++;
+        if (hist[(src[0] >> shift) & 0xFF] == count)  continue;
+
+        for (i = 0, sum = 0; i < 256; i++) {
+            c       = hist[i];
+            hist[i] = sum;
+            sum    += c;
+        }
+        for (i = 0; i < count; i++)  dst[hist[(src[i] >> shift) & 0xFF]++] = src[i];
+        t = src;  src = dst;  dst = t;
+    }
+
+    // Keep the sorted keys in the keys array
+    if (src != keys)  memcpy(keys, src, count * sizeof(u64));
+}
+
+/**
+ * Queue a texture, to be drawn at the next GRRLIB_QueueFlush.
+ * The sprite is drawn like GRRLIB_DrawImg, with the blending mode that is
+ * current when this function is called. The texture must stay valid until
+ * the queue is flushed. Sprites entirely off screen are dropped at once.
+ * @param layer The layer of the sprite, higher layers are drawn on top.
+ * @param xpos Specifies the x-coordinate of the upper-left corner.
+ * @param ypos Specifies the y-coordinate of the upper-left corner.
+ * @param tex The texture to draw.
+ * @param degrees Angle of rotation.
+ * @param scaleX Specifies the x-coordinate scale. -1 could be used for flipping the texture horizontally.
+ * @param scaleY Specifies the y-coordinate scale. -1 could be used for flipping the texture vertically.
+ * @param color Color in RGBA format.
+ */
+void  GRRLIB_QueueImg (const u8 layer, const f32 xpos, const f32 ypos,
+                       const GRRLIB_texImg *tex, const f32 degrees,
+                       const f32 scaleX, const f32 scaleY, const u32 color) {
+    if (tex == NULL)  return;
+    GRRLIB_QueuePart(layer, xpos, ypos, 0.0f, 0.0f, tex->w, tex->h,
+                     tex, degrees, scaleX, scaleY, color);
+}
+
+/**
+ * Queue a tile, to be drawn at the next GRRLIB_QueueFlush.
+ * @see GRRLIB_QueueImg
+ * @param layer The layer of the sprite, higher layers are drawn on top.
+ * @param xpos Specifies the x-coordinate of the upper-left corner.
+ * @param ypos Specifies the y-coordinate of the upper-left corner.
+ * @param tex The texture containing the tile to draw.
+ * @param degrees Angle of rotation.
+ * @param scaleX Specifies the x-coordinate scale. -1 could be used for flipping the texture horizontally.
+ * @param scaleY Specifies the y-coordinate scale. -1 could be used for flipping the texture vertically.
+ * @param color Color in RGBA format.
+ * @param frame Specifies the frame to draw.
+ */
+void  GRRLIB_QueueTile (const u8 layer, const f32 xpos, const f32 ypos,
+                        const GRRLIB_texImg *tex, const f32 degrees,
+                        const f32 scaleX, const f32 scaleY, const u32 color,
+                        const int frame) {
+    if (tex == NULL || tex->nbtilew == 0)  return;
+    GRRLIB_QueuePart(layer, xpos, ypos,
+                     (frame % tex->nbtilew) * tex->tilew,
+                     (int)(frame / tex->nbtilew) * tex->tileh,
+                     tex->tilew, tex->tileh,
+                     tex, degrees, scaleX, scaleY, color);
+}
+
+/**
+ * Queue a part of a texture, to be drawn at the next GRRLIB_QueueFlush.
+ * @see GRRLIB_QueueImg
+ * @param layer The layer of the sprite, higher layers are drawn on top.
+ * @param xpos Specifies the x-coordinate of the upper-left corner.
+ * @param ypos Specifies the y-coordinate of the upper-left corner.
+ * @param partx Specifies the x-coordinate of the upper-left corner in the texture.
+ * @param party Specifies the y-coordinate of the upper-left corner in the texture.
+ * @param partw Specifies the width in the texture.
+ * @param parth Specifies the height in the texture.
+ * @param tex The texture containing the part to draw.
+ * @param degrees Angle of rotation.
+ * @param scaleX Specifies the x-coordinate scale. -1 could be used for flipping the texture horizontally.
+ * @param scaleY Specifies the y-coordinate scale. -1 could be used for flipping the texture vertically.
+ * @param color Color in RGBA format.
+ */
+void  GRRLIB_QueuePart (const u8 layer, const f32 xpos, const f32 ypos,
+                        const f32 partx, const f32 party,
+                        const f32 partw, const f32 parth,
+                        const GRRLIB_texImg *tex, const f32 degrees,
+                        const f32 scaleX, const f32 scaleY, const u32 color) {
+    QueueSprite  *sp;
+    f32          tmp, pos[8];
+    GRRLIB_rect  screen = {0, 0, rmode->fbWidth, rmode->efbHeight};
+
+    if (tex == NULL || tex->data == NULL)  return;
+
+    // The clipping area may change before the flush, only the screen is known
+    GRRLIB_SpriteCorners(tex, xpos, ypos, partw * 0.5f, parth * 0.5f,
+                         degrees, scaleX, scaleY, pos);
+    if (!GRRLIB_QuadVisible(pos, &screen))  return;
+    if ((sp = QueueAdd(layer, tex)) == NULL)  return;
+
+    sp->tex   = tex;
+    sp->color = GRRLIB_TexColor(tex, color);
+    sp->s1    = partx / tex->w;
+    sp->s2    = (partx + partw) / tex->w;
+    sp->t1    = party / tex->h;
+    sp->t2    = (party + parth) / tex->h;
+    if (tex->flip & GRRLIB_FLIP_H) {  tmp = sp->s1;  sp->s1 = sp->s2;  sp->s2 = tmp;  }
+    if (tex->flip & GRRLIB_FLIP_V) {  tmp = sp->t1;  sp->t1 = sp->t2;  sp->t2 = tmp;  }
+
+    memcpy(sp->pos, pos, sizeof(pos));
+    sp->compact = GRRLIB_FitsS16(sp->pos, 8);
+}
+
+/**
+ * Send a batch of sorted sprites with the compact vertex format.
+ * @param first Index of the first sprite in the sorted keys.
+ * @param n Number of sprites.
+ */
+static
+void  QueueCompact (const uint first, const uint n) {
+    const QueueSprite  *sp;
+    uint               k;
+    u16                s1, s2, t1, t2;
+
+    GX_Begin(GX_QUADS, GRRLIB_VTXFMT_S16, n * 4);
+    for (k = first; k < first + n; k++) {
+        sp = &sprites[(u32)keys[k]];
+        s1 = GRRLIB_TexU16(sp->s1);  s2 = GRRLIB_TexU16(sp->s2);
+        t1 = GRRLIB_TexU16(sp->t1);  t2 = GRRLIB_TexU16(sp->t2);
+
+        GX_Position2s16(GRRLIB_PosS16(sp->pos[0]), GRRLIB_PosS16(sp->pos[1]));
+        GX_Color1u32   (sp->color);
+        GX_TexCoord2u16(s1, t1);
+
+        GX_Position2s16(GRRLIB_PosS16(sp->pos[2]), GRRLIB_PosS16(sp->pos[3]));
+        GX_Color1u32   (sp->color);
+        GX_TexCoord2u16(s2, t1);
+
+        GX_Position2s16(GRRLIB_PosS16(sp->pos[4]), GRRLIB_PosS16(sp->pos[5]));
+        GX_Color1u32   (sp->color);
+        GX_TexCoord2u16(s2, t2);
+
+        GX_Position2s16(GRRLIB_PosS16(sp->pos[6]), GRRLIB_PosS16(sp->pos[7]));
+        GX_Color1u32   (sp->color);
+        GX_TexCoord2u16(s1, t2);
+    }
+    GX_End();
+}
+
+/**
+ * Send a batch of sorted sprites with the floating point vertex format.
+ * @param first Index of the first sprite in the sorted keys.
+ * @param n Number of sprites.
+ */
+static
+void  QueueFull (const uint first, const uint n) {
+    const QueueSprite  *sp;
+    uint               k;
+
+    GX_Begin(GX_QUADS, GX_VTXFMT0, n * 4);
+    for (k = first; k < first + n; k++) {
+        sp = &sprites[(u32)keys[k]];
+        GX_Position3f32(sp->pos[0], sp->pos[1], 0);
+        GX_Color1u32   (sp->color);
+        GX_TexCoord2f32(sp->s1, sp->t1);
+
+        GX_Position3f32(sp->pos[2], sp->pos[3], 0);
+        GX_Color1u32   (sp->color);
+        GX_TexCoord2f32(sp->s2, sp->t1);
+
+        GX_Position3f32(sp->pos[4], sp->pos[5], 0);
+        GX_Color1u32   (sp->color);
+        GX_TexCoord2f32(sp->s2, sp->t2);
+
+        GX_Position3f32(sp->pos[6], sp->pos[7], 0);
+        GX_Color1u32   (sp->color);
+        GX_TexCoord2f32(sp->s1, sp->t2);
+    }
+    GX_End();
+}
+
+/**
+ * Draw all the queued sprites and empty the queue.
+ * Sprites are drawn layer by layer. Within a layer they are grouped by
+ * blending mode and texture, so each texture is loaded once and its
+ * sprites are sent in a single batch; sprites sharing a texture keep
+ * their submission order. Overlapping sprites of one layer should thus
+ * use different layers when their order matters.
+ * Called automatically by GRRLIB_Render.
+ */
+void  GRRLIB_QueueFlush (void) {
+    const GRRLIB_blendMode  blend = GRRLIB_Settings.blend;
+    const GRRLIB_texImg     *tex;
+    bool                    compact;
+    uint                    i, j, k, n, max;
+    u64                     group;
+
+    if (count == 0)  return;
+
+    QueueSort();
+
+    // The corners are already transformed
+    GX_LoadPosMtxImm(GXmodelView2D, GX_PNMTX0);
+    compact = GRRLIB_CompactOK();
+    max = GRRLIB_FifoQuads(QUEUE_QUADSIZE);
+
+    for (i = 0; i < count; ) {
+        // Extent of the run sharing the blending mode and the texture
+        group = keys[i] & 0x00FFFFFF00000000ULL;
+        tex   = sprites[(u32)keys[i]].tex;
+        for (j = i + 1; j < count; j++) {
+            if ((keys[j] & 0x00FFFFFF00000000ULL) != group ||
+                sprites[(u32)keys[j]].tex != tex)  break;
+        }
+
+        if (GRRLIB_Settings.blend != ((keys[i] >> 53) & 7))
+            GRRLIB_SetBlend((keys[i] >> 53) & 7);
+        GRRLIB_BindTex(tex, tex->w, tex->h);
+
+        for (; i < j; i += n) {
+            n = (j - i < max) ? j - i : max;
+            for (k = i; k < i + n; k++)
+                if (!sprites[(u32)keys[k]].compact)  break;
+            if (k == i + n && compact)  QueueCompact(i, n);
+            else             QueueFull   (i, n);
+            GRRLIB_FifoSample();
+        }
+    }
+
+    GX_SetTevOp  (GX_TEVSTAGE0, GX_PASSCLR);
+    GX_SetVtxDesc(GX_VA_TEX0,   GX_NONE);
+    if (GRRLIB_Settings.blend != blend)  GRRLIB_SetBlend(blend);
+
+    // Start again with an empty queue
+    count    = 0;
+    texCount = 0;
+    memset(texKeys, 0, sizeof(texKeys));
+}
+
+/**
+ * Release the memory used by the sprite queue.
+ */
+void  GRRLIB_ExitQueue (void) {
+    free(keys);
+    free(sprites);
+    keys     = NULL;
+    swap     = NULL;
+    sprites  = NULL;
+    count    = 0;
+    capacity = 0;
+}
@@ -21,33 +21,128 @@ THE SOFTWARE.
 ------------------------------------------------------------------------------*/
 
 #include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ogc/lwp_watchdog.h>
 
 #include <grrlib.h>
+#include "grrlib/GRRLIB_private.h"
 
 extern  GRRLIB_drawSettings  GRRLIB_Settings;
 extern  Mtx                  GXmodelView2D;
 
-static  guVector  axis = (guVector){0, 0, 1};
+#define COLOR_SLOTS  256    /**< Colours GRRLIB_SetColorIndex can hand out per frame. */
+#define BATCH_QUADSIZE    96   /**< Bytes of one quad sent to GX. */
+#define BATCH_QUADSIZE16  48   /**< Same, with the compact vertex format. */
+#define XFB_COUNT    3      /**< Frame buffers in pipelined mode. */
 
 /**
- * Draw a texture.
- * @param xpos Specifies the x-coordinate of the upper-left corner.
- * @param ypos Specifies the y-coordinate of the upper-left corner.
+ * State of a frame buffer in pipelined mode.
+ */
+enum {
+    XFB_FREE = 0,   /**< Can receive the next frame.             */
+    XFB_DRAWING,    /**< Submitted, the GPU has not finished it. */
+    XFB_READY,      /**< Finished, waiting for a retrace.        */
+    XFB_SHOWN,      /**< On screen.                              */
+};
+
+/**
+ * A sprite of a batch, ready to be sent to GX.
+ */
+typedef struct {
+    f32  pos[8];            /**< Screen corners, clockwise from top-left. */
+    f32  s1, s2, t1, t2;    /**< Texture coordinates.                     */
+    u32  color;             /**< Vertex colour, as sent to GX.            */
+} BatchQuad;
+
+static  u32               colorSlots[COLOR_SLOTS] ATTRIBUTE_ALIGN(32);
+static  uint              colorNext = 0;
+static  GRRLIB_drawStats  frameStats;   // Counters of the frame being drawn
+static  GRRLIB_drawStats  lastStats;    // Counters of the last rendered frame
+static  u32               frameNumber = 1;  // Frame being drawn, 0 is never used
+static  volatile u32      frameDone   = 0;  // Last frame the GP has finished
+static  BatchQuad         *batchQuads = NULL;   // GRRLIB_DrawImgBatch work area
+static  uint              batchCap    = 0;
+
+static  bool          pipelined = false;
+static  volatile u8   xfbState[XFB_COUNT];  // Updated by the interrupt handlers
+static  u32           xfbOrder[XFB_COUNT];  // Submission number of each frame
+static  u64           xfbTime[XFB_COUNT];   // Submission time of each frame
+static  u32           xfbFrame[XFB_COUNT];  // Frame number of each frame
+static  u32           xfbNext    = 0;       // Next submission number
+static  volatile int  xfbRetired = -1;      // Frame buffer left at the last retrace
+static  volatile u32  latency    = 0;       // Of the last frame put on screen
+
+/**
+ * Compute the sine and cosine of an angle in single precision.
+ * The angle is reduced to the nearest quadrant and the remainder fed to
+ * short polynomials, so multiples of 90 degrees come out exact.
+ * @param degrees Angle in degrees.
+ * @param s Receives the sine of the angle.
+ * @param c Receives the cosine of the angle.
+ */
+void  GRRLIB_SinCos (const f32 degrees, f32 *s, f32 *c) {
+    const f32  q  = degrees * (1.0f / 90.0f);
+    const int  n  = (int)(q < 0.0f ? q - 0.5f : q + 0.5f);
+    const f32  x  = (q - n) * (f32)(M_PI / 2.0);   // -pi/4 .. pi/4
+    const f32  x2 = x * x;
+    const f32  sn = x * (1.0f + x2 * (-1.0f/6.0f + x2 * (1.0f/120.0f
+                                    + x2 * (-1.0f/5040.0f))));
+    const f32  cs = 1.0f + x2 * (-0.5f + x2 * (1.0f/24.0f
+                                    + x2 * (-1.0f/720.0f + x2 * (1.0f/40320.0f))));
+
+    switch (n & 3) {
+        case 0:  *s =  sn;  *c =  cs;  break;
+        case 1:  *s =  cs;  *c = -sn;  break;
+        case 2:  *s = -sn;  *c = -cs;  break;
+        default: *s = -cs;  *c =  sn;  break;
+    }
+}
+
+/**
+ * Apply the mirroring of a texture to a set of texture coordinates.
+ * @param tex The texture being drawn.
+ * @param s1 Left texture coordinate.
+ * @param s2 Right texture coordinate.
+ * @param t1 Top texture coordinate.
+ * @param t2 Bottom texture coordinate.
+ */
+static inline
+void  FlipTexCoords (const GRRLIB_texImg *tex, f32 *s1, f32 *s2, f32 *t1, f32 *t2) {
+    f32  tmp;
+
+    if (tex->flip & GRRLIB_FLIP_H) {  tmp = *s1;  *s1 = *s2;  *s2 = tmp;  }
+    if (tex->flip & GRRLIB_FLIP_V) {  tmp = *t1;  *t1 = *t2;  *t2 = tmp;  }
+}
+
+/**
+ * Get the GX pixel format of a texture format.
+ * @param format A texture format.
+ * @return The matching GX_TF_ format.
+ */
+u8  GRRLIB_TexFmtGX (const GRRLIB_texFormat format) {
+    switch (format) {
+        case GRRLIB_TEXFMT_RGB565:  return GX_TF_RGB565;
+        case GRRLIB_TEXFMT_RGB5A3:  return GX_TF_RGB5A3;
+        case GRRLIB_TEXFMT_I8:      return GX_TF_I8;
+        case GRRLIB_TEXFMT_IA8:     return GX_TF_IA8;
+        default:                    return GX_TF_RGBA8;
+    }
+}
+
+/**
+ * Load a texture in GX and set up the TEV and vertex format to draw it.
  * @param tex The texture to draw.
- * @param degrees Angle of rotation.
- * @param scaleX Specifies the x-coordinate scale. -1 could be used for flipping the texture horizontally.
- * @param scaleY Specifies the y-coordinate scale. -1 could be used for flipping the texture vertically.
- * @param color Color in RGBA format.
+ * @param w Width of the texture data, in pixels.
+ * @param h Height of the texture data, in pixels.
  */
-void  GRRLIB_DrawImg (const f32 xpos, const f32 ypos, const GRRLIB_texImg *tex, const f32 degrees, const f32 scaleX, const f32 scaleY, const u32 color) {
+void  GRRLIB_BindTex (const GRRLIB_texImg *tex, const uint w, const uint h) {
     GXTexObj  texObj;
-    u16       width, height;
-    Mtx       m, m1, m2, mv;
 
-    if (tex == NULL || tex->data == NULL)  return;
-
-    GX_InitTexObj(&texObj, tex->data, tex->w, tex->h,
-                  GX_TF_RGBA8, GX_CLAMP, GX_CLAMP, GX_FALSE);
+    GRRLIB_FlushPrimitives();
+    GRRLIB_FifoSample();
+    GX_InitTexObj(&texObj, tex->data, w, h,
+                  GRRLIB_TexFmtGX(tex->format), GX_CLAMP, GX_CLAMP, GX_FALSE);
 
     if (GRRLIB_Settings.antialias == false) {
         GX_InitTexObjLOD(&texObj, GX_NEAR, GX_NEAR,
@@ -61,49 +156,211 @@ void  GRRLIB_DrawImg (const f32 xpos, const f32 ypos, const GRRLIB_texImg *tex,
     GX_LoadTexObj(&texObj,      GX_TEXMAP0);
     GX_SetTevOp  (GX_TEVSTAGE0, GX_MODULATE);
     GX_SetVtxDesc(GX_VA_TEX0,   GX_DIRECT);
+}
+
+/**
+ * Make indexed vertex colours refer to a single colour.
+ * Following vertices send GX_Color1x8(0) instead of the full colour, until
+ * the caller sets GX_VA_CLR0 back to GX_DIRECT. The colour is kept in a
+ * slot of its own so the GP can still read the previous ones.
+ * @param color Color in RGBA format.
+ */
+void  GRRLIB_SetColorIndex (const u32 color) {
+    u32  *slot;
+
+    GRRLIB_FlushPrimitives();
+    // Out of slots: wait for the GP to be done with them
+    if (colorNext == COLOR_SLOTS) {
+        GRRLIB_DrawDone();
+        GX_InvVtxCache();   // The slots get new colours at the same addresses
+        colorNext = 0;
+    }
+
+    slot  = &colorSlots[colorNext++];
+    *slot = color;
+    DCFlushRange(slot, sizeof(u32));
+
+    GX_SetArray  (GX_VA_CLR0, slot, sizeof(u32));
+    GX_SetVtxDesc(GX_VA_CLR0, GX_INDEX8);
+}
+
+/**
+ * Compute the screen corners of a sprite, the way GRRLIB_DrawImg places it.
+ * @param tex The texture being drawn (for its handle and offset).
+ * @param xpos Specifies the x-coordinate of the upper-left corner.
+ * @param ypos Specifies the y-coordinate of the upper-left corner.
+ * @param width Half of the width of the sprite.
+ * @param height Half of the height of the sprite.
+ * @param degrees Angle of rotation.
+ * @param scaleX Specifies the x-coordinate scale.
+ * @param scaleY Specifies the y-coordinate scale.
+ * @param pos Receives the x and y coordinates of the top-left, top-right,
+ *            bottom-right and bottom-left corners.
+ */
+void  GRRLIB_SpriteCorners (const GRRLIB_texImg *tex,
+                            const f32 xpos, const f32 ypos,
+                            const f32 width, const f32 height,
+                            const f32 degrees,
+                            const f32 scaleX, const f32 scaleY, f32 pos[8]) {
+    f32  c, s, ax, ay, bx, by, tx, ty;
+
+    // Unrotated and unscaled: the handle cancels out, only translate
+    if (degrees == 0.0f && scaleX == 1.0f && scaleY == 1.0f) {
+        pos[0] = pos[6] = xpos - tex->offsetx;
+        pos[1] = pos[3] = ypos - tex->offsety;
+        pos[2] = pos[4] = pos[0] + width  * 2.0f;
+        pos[5] = pos[7] = pos[1] + height * 2.0f;
+        return;
+    }
+
+    if (degrees == 0.0f) {  c = 1.0f;  s = 0.0f;  }
+    else                    GRRLIB_SinCos(degrees, &s, &c);
+
+    ax =  c * scaleX * width;   ay = s * scaleX * width;
+    bx = -s * scaleY * height;  by = c * scaleY * height;
+    tx = xpos + width  + tex->handlex - tex->offsetx
+       + scaleX * (tex->handley * s - tex->handlex * c);
+    ty = ypos + height + tex->handley - tex->offsety
+       + scaleY * (-tex->handley * c - tex->handlex * s);
+
+    pos[0] = tx - ax - bx;  pos[1] = ty - ay - by;
+    pos[2] = tx + ax - bx;  pos[3] = ty + ay - by;
+    pos[4] = tx + ax + bx;  pos[5] = ty + ay + by;
+    pos[6] = tx - ax + bx;  pos[7] = ty - ay + by;
+}
 
-    guMtxIdentity  (m1);
-    guMtxScaleApply(m1, m1, scaleX, scaleY, 1.0);
-    guMtxRotAxisDeg(m2, &axis, degrees);
-    guMtxConcat    (m2, m1, m);
-
-    width  = tex->w * 0.5;
-    height = tex->h * 0.5;
-
-    guMtxTransApply(m, m,
-        xpos +width  +tex->handlex
-            -tex->offsetx +( scaleX *(-tex->handley *sin(-DegToRad(degrees))
-                                      -tex->handlex *cos(-DegToRad(degrees))) ),
-        ypos +height +tex->handley
-            -tex->offsety +( scaleY *(-tex->handley *cos(-DegToRad(degrees))
-                                      +tex->handlex *sin(-DegToRad(degrees))) ),
-        0);
-    guMtxConcat(GXmodelView2D, m, mv);
-
-    GX_LoadPosMtxImm(mv, GX_PNMTX0);
-    GX_Begin(GX_QUADS, GX_VTXFMT0, 4);
-        GX_Position3f32(-width, -height, 0);
-        GX_Color1u32   (color);
-        GX_TexCoord2f32(0, 0);
-
-        GX_Position3f32(width, -height, 0);
-        GX_Color1u32   (color);
-        GX_TexCoord2f32(1, 0);
-
-        GX_Position3f32(width, height, 0);
-        GX_Color1u32   (color);
-        GX_TexCoord2f32(1, 1);
-
-        GX_Position3f32(-width, height, 0);
-        GX_Color1u32   (color);
-        GX_TexCoord2f32(0, 1);
-    GX_End();
+/**
+ * Test the bounding box of a sprite against a clipping rectangle, and
+ * count the sprite as drawn or culled.
+ * @param minx Left edge of the box.
+ * @param miny Top edge of the box.
+ * @param maxx Right edge of the box.
+ * @param maxy Bottom edge of the box.
+ * @param clip The clipping rectangle.
+ * @return true if the box overlaps the rectangle.
+ */
+bool  GRRLIB_BoxVisible (const f32 minx, const f32 miny,
+                         const f32 maxx, const f32 maxy,
+                         const GRRLIB_rect *clip) {
+    if (maxx <= clip->x || minx >= clip->x + (int)clip->w ||
+        maxy <= clip->y || miny >= clip->y + (int)clip->h) {
+        frameStats.culled++;
+        return false;
+    }
+    frameStats.drawn++;
+    return true;
+}
+
+/**
+ * Test a transformed quad against a clipping rectangle.
+ * @see GRRLIB_BoxVisible
+ * @param pos The x and y coordinates of the four corners.
+ * @param clip The clipping rectangle.
+ * @return true if the quad may touch the rectangle.
+ */
+bool  GRRLIB_QuadVisible (const f32 pos[8], const GRRLIB_rect *clip) {
+    f32   minx = pos[0], maxx = pos[0], miny = pos[1], maxy = pos[1];
+    uint  k;
+
+    for (k = 2; k < 8; k += 2) {
+        if      (pos[k]   < minx)  minx = pos[k];
+        else if (pos[k]   > maxx)  maxx = pos[k];
+        if      (pos[k+1] < miny)  miny = pos[k+1];
+        else if (pos[k+1] > maxy)  maxy = pos[k+1];
+    }
+    return GRRLIB_BoxVisible(minx, miny, maxx, maxy, clip);
+}
+
+/**
+ * Send a textured quad to GX, the texture having been bound beforehand.
+ * @param pos The x and y coordinates of the top-left, top-right,
+ *            bottom-right and bottom-left corners.
+ * @param s1 Left texture coordinate.
+ * @param s2 Right texture coordinate.
+ * @param t1 Top texture coordinate.
+ * @param t2 Bottom texture coordinate.
+ * @param col Color in RGBA format.
+ */
+static
+void  DrawTexQuad (const f32 pos[8],
+                   const f32 s1, const f32 s2, const f32 t1, const f32 t2,
+                   const u32 col) {
     GX_LoadPosMtxImm(GXmodelView2D, GX_PNMTX0);
 
+    if (GRRLIB_CompactOK() && GRRLIB_FitsS16(pos, 8)) {
+        const u16  us1 = GRRLIB_TexU16(s1), us2 = GRRLIB_TexU16(s2);
+        const u16  ut1 = GRRLIB_TexU16(t1), ut2 = GRRLIB_TexU16(t2);
+
+        GX_Begin(GX_QUADS, GRRLIB_VTXFMT_S16, 4);
+            GX_Position2s16(GRRLIB_PosS16(pos[0]), GRRLIB_PosS16(pos[1]));
+            GX_Color1u32   (col);
+            GX_TexCoord2u16(us1, ut1);
+
+            GX_Position2s16(GRRLIB_PosS16(pos[2]), GRRLIB_PosS16(pos[3]));
+            GX_Color1u32   (col);
+            GX_TexCoord2u16(us2, ut1);
+
+            GX_Position2s16(GRRLIB_PosS16(pos[4]), GRRLIB_PosS16(pos[5]));
+            GX_Color1u32   (col);
+            GX_TexCoord2u16(us2, ut2);
+
+            GX_Position2s16(GRRLIB_PosS16(pos[6]), GRRLIB_PosS16(pos[7]));
+            GX_Color1u32   (col);
+            GX_TexCoord2u16(us1, ut2);
+        GX_End();
+    }
+    else {
+        GX_Begin(GX_QUADS, GX_VTXFMT0, 4);
+            GX_Position3f32(pos[0], pos[1], 0);
+            GX_Color1u32   (col);
+            GX_TexCoord2f32(s1, t1);
+
+            GX_Position3f32(pos[2], pos[3], 0);
+            GX_Color1u32   (col);
+            GX_TexCoord2f32(s2, t1);
+
+            GX_Position3f32(pos[4], pos[5], 0);
+            GX_Color1u32   (col);
+            GX_TexCoord2f32(s2, t2);
+
+            GX_Position3f32(pos[6], pos[7], 0);
+            GX_Color1u32   (col);
+            GX_TexCoord2f32(s1, t2);
+        GX_End();
+    }
+
     GX_SetTevOp  (GX_TEVSTAGE0, GX_PASSCLR);
     GX_SetVtxDesc(GX_VA_TEX0,   GX_NONE);
 }
 
+/**
+ * Draw a texture.
+ * @param xpos Specifies the x-coordinate of the upper-left corner.
+ * @param ypos Specifies the y-coordinate of the upper-left corner.
+ * @param tex The texture to draw.
+ * @param degrees Angle of rotation.
+ * @param scaleX Specifies the x-coordinate scale. -1 could be used for flipping the texture horizontally.
+ * @param scaleY Specifies the y-coordinate scale. -1 could be used for flipping the texture vertically.
+ * @param color Color in RGBA format.
+ */
+void  GRRLIB_DrawImg (const f32 xpos, const f32 ypos, const GRRLIB_texImg *tex, const f32 degrees, const f32 scaleX, const f32 scaleY, const u32 color) {
+    f32       pos[8];
+    f32       s1 = 0.0f, s2 = 1.0f, t1 = 0.0f, t2 = 1.0f;
+    u32       col;
+
+    if (tex == NULL || tex->data == NULL)  return;
+
+    FlipTexCoords(tex, &s1, &s2, &t1, &t2);
+    col = GRRLIB_TexColor(tex, color);
+
+    GRRLIB_SpriteCorners(tex, xpos, ypos, tex->w * 0.5f, tex->h * 0.5f,
+                         degrees, scaleX, scaleY, pos);
+    if (!GRRLIB_QuadVisible(pos, &GRRLIB_Settings.clip))  return;
+
+    GRRLIB_BindTex(tex, tex->w, tex->h);
+    DrawTexQuad(pos, s1, s2, t1, t2, col);
+}
+
 /**
  * Draw a textured quad.
  * @param pos Vector array of the 4 points.
@@ -111,55 +368,23 @@ void  GRRLIB_DrawImg (const f32 xpos, const f32 ypos, const GRRLIB_texImg *tex,
  * @param color Color in RGBA format.
  */
 void  GRRLIB_DrawImgQuad (const guVector pos[4], GRRLIB_texImg *tex, const u32 color) {
-    GXTexObj  texObj;
-    Mtx       m, m1, m2, mv;
+    f32       corners[8];
+    f32       s1 = 0.0f, s2 = 1.0f, t1 = 0.0f, t2 = 1.0f;
+    u32       col;
 
     if (tex == NULL || tex->data == NULL)  return;
 
-    GX_InitTexObj(&texObj, tex->data, tex->w, tex->h,
-                  GX_TF_RGBA8, GX_CLAMP, GX_CLAMP, GX_FALSE);
-
-    if (GRRLIB_Settings.antialias == false) {
-        GX_InitTexObjLOD(&texObj, GX_NEAR, GX_NEAR,
-                         0.0f, 0.0f, 0.0f, 0, 0, GX_ANISO_1);
-        GX_SetCopyFilter(GX_FALSE, rmode->sample_pattern, GX_FALSE, rmode->vfilter);
-    }
-    else {
-        GX_SetCopyFilter(rmode->aa, rmode->sample_pattern, GX_TRUE, rmode->vfilter);
-    }
-
-    GX_LoadTexObj(&texObj,      GX_TEXMAP0);
-    GX_SetTevOp  (GX_TEVSTAGE0, GX_MODULATE);
-    GX_SetVtxDesc(GX_VA_TEX0,   GX_DIRECT);
+    FlipTexCoords(tex, &s1, &s2, &t1, &t2);
+    col = GRRLIB_TexColor(tex, color);
 
-    guMtxIdentity  (m1);
-    guMtxScaleApply(m1, m1, 1, 1, 1.0);
-    guMtxRotAxisDeg(m2, &axis, 0);
-    guMtxConcat    (m2, m1, m);
-    guMtxConcat    (GXmodelView2D, m, mv);
-
-    GX_LoadPosMtxImm(mv, GX_PNMTX0);
-    GX_Begin(GX_QUADS, GX_VTXFMT0, 4);
-        GX_Position3f32(pos[0].x, pos[0].y, 0);
-        GX_Color1u32   (color);
-        GX_TexCoord2f32(0, 0);
-
-        GX_Position3f32(pos[1].x, pos[1].y, 0);
-        GX_Color1u32   (color);
-        GX_TexCoord2f32(1, 0);
-
-        GX_Position3f32(pos[2].x, pos[2].y, 0);
-        GX_Color1u32   (color);
-        GX_TexCoord2f32(1, 1);
-
-        GX_Position3f32(pos[3].x, pos[3].y, 0);
-        GX_Color1u32   (color);
-        GX_TexCoord2f32(0, 1);
-    GX_End();
-    GX_LoadPosMtxImm(GXmodelView2D, GX_PNMTX0);
+    corners[0] = pos[0].x;  corners[1] = pos[0].y;
+    corners[2] = pos[1].x;  corners[3] = pos[1].y;
+    corners[4] = pos[2].x;  corners[5] = pos[2].y;
+    corners[6] = pos[3].x;  corners[7] = pos[3].y;
+    if (!GRRLIB_QuadVisible(corners, &GRRLIB_Settings.clip))  return;
 
-    GX_SetTevOp  (GX_TEVSTAGE0, GX_PASSCLR);
-    GX_SetVtxDesc(GX_VA_TEX0,   GX_NONE);
+    GRRLIB_BindTex(tex, tex->w, tex->h);
+    DrawTexQuad(corners, s1, s2, t1, t2, col);
 }
 
 /**
@@ -174,10 +399,9 @@ void  GRRLIB_DrawImgQuad (const guVector pos[4], GRRLIB_texImg *tex, const u32 c
  * @param frame Specifies the frame to draw.
  */
 void  GRRLIB_DrawTile (const f32 xpos, const f32 ypos, const GRRLIB_texImg *tex, const f32 degrees, const f32 scaleX, const f32 scaleY, const u32 color, const int frame) {
-    GXTexObj  texObj;
-    f32       width, height;
-    Mtx       m, m1, m2, mv;
+    f32       pos[8];
     f32       s1, s2, t1, t2;
+    u32       col;
 
     if (tex == NULL || tex->data == NULL)  return;
 
@@ -186,65 +410,15 @@ void  GRRLIB_DrawTile (const f32 xpos, const f32 ypos, const GRRLIB_texImg *tex,
     s2 = s1 + tex->ofnormaltexx;
     t1 = (int)(frame/tex->nbtilew) * tex->ofnormaltexy;
     t2 = t1 + tex->ofnormaltexy;
+    FlipTexCoords(tex, &s1, &s2, &t1, &t2);
+    col = GRRLIB_TexColor(tex, color);
 
-    GX_InitTexObj(&texObj, tex->data,
-                  tex->tilew * tex->nbtilew, tex->tileh * tex->nbtileh,
-                  GX_TF_RGBA8, GX_CLAMP, GX_CLAMP, GX_FALSE);
+    GRRLIB_SpriteCorners(tex, xpos, ypos, tex->tilew * 0.5f, tex->tileh * 0.5f,
+                         degrees, scaleX, scaleY, pos);
+    if (!GRRLIB_QuadVisible(pos, &GRRLIB_Settings.clip))  return;
 
-    if (GRRLIB_Settings.antialias == false) {
-        GX_InitTexObjLOD(&texObj, GX_NEAR, GX_NEAR,
-                         0.0f, 0.0f, 0.0f, 0, 0, GX_ANISO_1);
-        GX_SetCopyFilter(GX_FALSE, rmode->sample_pattern, GX_FALSE, rmode->vfilter);
-    }
-    else {
-        GX_SetCopyFilter(rmode->aa, rmode->sample_pattern, GX_TRUE, rmode->vfilter);
-    }
-
-    GX_LoadTexObj(&texObj,      GX_TEXMAP0);
-    GX_SetTevOp  (GX_TEVSTAGE0, GX_MODULATE);
-    GX_SetVtxDesc(GX_VA_TEX0,   GX_DIRECT);
-
-    width  = tex->tilew * 0.5f;
-    height = tex->tileh * 0.5f;
-
-    guMtxIdentity  (m1);
-    guMtxScaleApply(m1, m1, scaleX, scaleY, 1.0f);
-    guMtxRotAxisDeg(m2, &axis, degrees);
-    guMtxConcat    (m2, m1, m);
-
-    guMtxTransApply(m, m,
-        xpos +width  +tex->handlex
-            -tex->offsetx +( scaleX *(-tex->handley *sin(-DegToRad(degrees))
-                                      -tex->handlex *cos(-DegToRad(degrees))) ),
-        ypos +height +tex->handley
-            -tex->offsety +( scaleY *(-tex->handley *cos(-DegToRad(degrees))
-                                      +tex->handlex *sin(-DegToRad(degrees))) ),
-        0);
-
-    guMtxConcat(GXmodelView2D, m, mv);
-
-    GX_LoadPosMtxImm(mv, GX_PNMTX0);
-    GX_Begin(GX_QUADS, GX_VTXFMT0, 4);
-        GX_Position3f32(-width, -height, 0);
-        GX_Color1u32   (color);
-        GX_TexCoord2f32(s1, t1);
-
-        GX_Position3f32(width, -height,  0);
-        GX_Color1u32   (color);
-        GX_TexCoord2f32(s2, t1);
-
-        GX_Position3f32(width, height,  0);
-        GX_Color1u32   (color);
-        GX_TexCoord2f32(s2, t2);
-
-        GX_Position3f32(-width, height,  0);
-        GX_Color1u32   (color);
-        GX_TexCoord2f32(s1, t2);
-    GX_End();
-    GX_LoadPosMtxImm(GXmodelView2D, GX_PNMTX0);
-
-    GX_SetTevOp  (GX_TEVSTAGE0, GX_PASSCLR);
-    GX_SetVtxDesc(GX_VA_TEX0,   GX_NONE);
+    GRRLIB_BindTex(tex, tex->tilew * tex->nbtilew, tex->tileh * tex->nbtileh);
+    DrawTexQuad(pos, s1, s2, t1, t2, col);
 }
 
 /**
@@ -262,10 +436,9 @@ void  GRRLIB_DrawTile (const f32 xpos, const f32 ypos, const GRRLIB_texImg *tex,
  * @param color Color in RGBA format.
  */
 void  GRRLIB_DrawPart (const f32 xpos, const f32 ypos, const f32 partx, const f32 party, const f32 partw, const f32 parth, const GRRLIB_texImg *tex, const f32 degrees, const f32 scaleX, const f32 scaleY, const u32 color) {
-    GXTexObj  texObj;
-    f32       width, height;
-    Mtx       m, m1, m2, mv;
+    f32       pos[8];
     f32       s1, s2, t1, t2;
+    u32       col;
 
     if (tex == NULL || tex->data == NULL)  return;
 
@@ -274,65 +447,15 @@ void  GRRLIB_DrawPart (const f32 xpos, const f32 ypos, const f32 partx, const f3
     s2 = ((partx + partw)/tex->w) -(0.001f /tex->w);
     t1 = (party /tex->h) +(0.001f /tex->h);
     t2 = ((party + parth)/tex->h) -(0.001f /tex->h);
+    FlipTexCoords(tex, &s1, &s2, &t1, &t2);
+    col = GRRLIB_TexColor(tex, color);
 
-    GX_InitTexObj(&texObj, tex->data,
-                  tex->w, tex->h,
-                  GX_TF_RGBA8, GX_CLAMP, GX_CLAMP, GX_FALSE);
-
-    if (GRRLIB_Settings.antialias == false) {
-        GX_InitTexObjLOD(&texObj, GX_NEAR, GX_NEAR,
-                         0.0f, 0.0f, 0.0f, 0, 0, GX_ANISO_1);
-        GX_SetCopyFilter(GX_FALSE, rmode->sample_pattern, GX_FALSE, rmode->vfilter);
-    }
-    else {
-        GX_SetCopyFilter(rmode->aa, rmode->sample_pattern, GX_TRUE, rmode->vfilter);
-    }
-
-    GX_LoadTexObj(&texObj,      GX_TEXMAP0);
-    GX_SetTevOp  (GX_TEVSTAGE0, GX_MODULATE);
-    GX_SetVtxDesc(GX_VA_TEX0,   GX_DIRECT);
+    GRRLIB_SpriteCorners(tex, xpos, ypos, partw * 0.5f, parth * 0.5f,
+                         degrees, scaleX, scaleY, pos);
+    if (!GRRLIB_QuadVisible(pos, &GRRLIB_Settings.clip))  return;
 
-    width  = partw * 0.5f;
-    height = parth * 0.5f;
-
-    guMtxIdentity  (m1);
-    guMtxScaleApply(m1, m1, scaleX, scaleY, 1.0f);
-    guMtxRotAxisDeg(m2, &axis, degrees);
-    guMtxConcat    (m2, m1, m);
-
-    guMtxTransApply(m, m,
-        xpos +width  +tex->handlex
-            -tex->offsetx +( scaleX *(-tex->handley *sin(-DegToRad(degrees))
-                                      -tex->handlex *cos(-DegToRad(degrees))) ),
-        ypos +height +tex->handley
-            -tex->offsety +( scaleY *(-tex->handley *cos(-DegToRad(degrees))
-                                      +tex->handlex *sin(-DegToRad(degrees))) ),
-        0);
-
-    guMtxConcat(GXmodelView2D, m, mv);
-
-    GX_LoadPosMtxImm(mv, GX_PNMTX0);
-    GX_Begin(GX_QUADS, GX_VTXFMT0, 4);
-        GX_Position3f32(-width, -height, 0);
-        GX_Color1u32   (color);
-        GX_TexCoord2f32(s1, t1);
-
-        GX_Position3f32(width, -height,  0);
-        GX_Color1u32   (color);
-        GX_TexCoord2f32(s2, t1);
-
-        GX_Position3f32(width, height,  0);
-        GX_Color1u32   (color);
-        GX_TexCoord2f32(s2, t2);
-
-        GX_Position3f32(-width, height,  0);
-        GX_Color1u32   (color);
-        GX_TexCoord2f32(s1, t2);
-    GX_End();
-    GX_LoadPosMtxImm(GXmodelView2D, GX_PNMTX0);
-
-    GX_SetTevOp  (GX_TEVSTAGE0, GX_PASSCLR);
-    GX_SetVtxDesc(GX_VA_TEX0,   GX_NONE);
+    GRRLIB_BindTex(tex, tex->w, tex->h);
+    DrawTexQuad(pos, s1, s2, t1, t2, col);
 }
 
 /**
@@ -343,9 +466,9 @@ void  GRRLIB_DrawPart (const f32 xpos, const f32 ypos, const f32 partx, const f3
  * @param frame Specifies the frame to draw.
  */
 void  GRRLIB_DrawTileQuad (const guVector pos[4], GRRLIB_texImg *tex, const u32 color, const int frame) {
-    GXTexObj  texObj;
-    Mtx       m, m1, m2, mv;
+    f32       corners[8];
     f32       s1, s2, t1, t2;
+    u32       col;
 
     if (tex == NULL || tex->data == NULL)  return;
 
@@ -354,70 +477,399 @@ void  GRRLIB_DrawTileQuad (const guVector pos[4], GRRLIB_texImg *tex, const u32
     s2 = ((     (frame %tex->nbtilew) +1) /(f32)tex->nbtilew) -(0.001f /tex->w);
     t1 = (((int)(frame /tex->nbtilew)   ) /(f32)tex->nbtileh) +(0.001f /tex->h);
     t2 = (((int)(frame /tex->nbtilew) +1) /(f32)tex->nbtileh) -(0.001f /tex->h);
+    FlipTexCoords(tex, &s1, &s2, &t1, &t2);
+    col = GRRLIB_TexColor(tex, color);
 
-    GX_InitTexObj(&texObj, tex->data,
-                  tex->tilew * tex->nbtilew, tex->tileh * tex->nbtileh,
-                  GX_TF_RGBA8, GX_CLAMP, GX_CLAMP, GX_FALSE);
+    corners[0] = pos[0].x;  corners[1] = pos[0].y;
+    corners[2] = pos[1].x;  corners[3] = pos[1].y;
+    corners[4] = pos[2].x;  corners[5] = pos[2].y;
+    corners[6] = pos[3].x;  corners[7] = pos[3].y;
+    if (!GRRLIB_QuadVisible(corners, &GRRLIB_Settings.clip))  return;
 
-    if (GRRLIB_Settings.antialias == false) {
-        GX_InitTexObjLOD(&texObj, GX_NEAR, GX_NEAR,
-                         0.0f, 0.0f, 0.0f, 0, 0, GX_ANISO_1);
-        GX_SetCopyFilter(GX_FALSE, rmode->sample_pattern, GX_FALSE, rmode->vfilter);
+    GRRLIB_BindTex(tex, tex->tilew * tex->nbtilew, tex->tileh * tex->nbtileh);
+    DrawTexQuad(corners, s1, s2, t1, t2, col);
+}
+
+/**
+ * Draw many sprites of the same texture at once.
+ * Sprites are placed as GRRLIB_DrawImg, GRRLIB_DrawTile or GRRLIB_DrawPart
+ * would place them. All the corners are worked out first and the sprites
+ * entirely outside the clipping area are dropped, then the others are sent
+ * in a single stream of quads, in array order, with one texture load.
+ * @param tex The texture to draw.
+ * @param sprites Array of sprites.
+ * @param n Number of sprites in the array.
+ * @return The number of sprites sent to GX.
+ */
+uint  GRRLIB_DrawImgBatch (const GRRLIB_texImg *tex,
+                           const GRRLIB_sprite *sprites, const uint n) {
+    const GRRLIB_sprite  *sp;
+    BatchQuad            *quads, *q;
+    f32                  w, h, c, s, ax, ay, bx, by, tx, ty, tmp;
+    f32                  minx, maxx, miny, maxy;
+    uint                 i, k, m = 0, batch, max;
+    bool                 compact = true;
+
+    if (tex == NULL || tex->data == NULL || sprites == NULL || n == 0)  return 0;
+
+    // The work area only grows, it is kept for the next batches
+    if (n > batchCap) {
+        quads = realloc(batchQuads, n * sizeof(BatchQuad));
+        if (quads == NULL)  return 0;
+        batchQuads = quads;
+        batchCap   = n;
     }
-    else {
-        GX_SetCopyFilter(rmode->aa, rmode->sample_pattern, GX_TRUE, rmode->vfilter);
+    quads = batchQuads;
+
+    // Transform and cull everything before touching GX
+    for (i = 0, sp = sprites; i < n; i++, sp++) {
+        q = &quads[m];
+
+        if (sp->partw != 0 && sp->parth != 0) {
+            w     = sp->partw * 0.5f;
+            h     = sp->parth * 0.5f;
+            // The 0.001f/x is the frame correction formula by spiffen
+            q->s1 = (sp->partx /(f32)tex->w) +(0.001f /tex->w);
+            q->s2 = ((sp->partx + sp->partw)/(f32)tex->w) -(0.001f /tex->w);
+            q->t1 = (sp->party /(f32)tex->h) +(0.001f /tex->h);
+            q->t2 = ((sp->party + sp->parth)/(f32)tex->h) -(0.001f /tex->h);
+        }
+        else if (tex->tiledtex && sp->frame >= 0) {
+            w     = tex->tilew * 0.5f;
+            h     = tex->tileh * 0.5f;
+            q->s1 = (sp->frame % tex->nbtilew) * (f32)tex->tilew / tex->w;
+            q->s2 = q->s1 + (f32)tex->tilew / tex->w;
+            q->t1 = (sp->frame / tex->nbtilew) * (f32)tex->tileh / tex->h;
+            q->t2 = q->t1 + (f32)tex->tileh / tex->h;
+        }
+        else {
+            w     = tex->w * 0.5f;
+            h     = tex->h * 0.5f;
+            q->s1 = 0.0f;  q->s2 = 1.0f;
+            q->t1 = 0.0f;  q->t2 = 1.0f;
+        }
+
+        if (sp->degrees == 0.0f) {  c = 1.0f;  s = 0.0f;  }
+        else                        GRRLIB_SinCos(sp->degrees, &s, &c);
+
+        ax =  c * sp->scaleX * w;  ay = s * sp->scaleX * w;
+        bx = -s * sp->scaleY * h;  by = c * sp->scaleY * h;
+        tx = sp->x + w + tex->handlex - tex->offsetx
+           + sp->scaleX * (tex->handley * s - tex->handlex * c);
+        ty = sp->y + h + tex->handley - tex->offsety
+           + sp->scaleY * (-tex->handley * c - tex->handlex * s);
+
+        q->pos[0] = tx - ax - bx;  q->pos[1] = ty - ay - by;
+        q->pos[2] = tx + ax - bx;  q->pos[3] = ty + ay - by;
+        q->pos[4] = tx + ax + bx;  q->pos[5] = ty + ay + by;
+        q->pos[6] = tx - ax + bx;  q->pos[7] = ty - ay + by;
+
+        // Bounding box of the corners against the screen
+        minx = maxx = q->pos[0];
+        miny = maxy = q->pos[1];
+        for (k = 2; k < 8; k += 2) {
+            if (q->pos[k]   < minx)  minx = q->pos[k];
+            if (q->pos[k]   > maxx)  maxx = q->pos[k];
+            if (q->pos[k+1] < miny)  miny = q->pos[k+1];
+            if (q->pos[k+1] > maxy)  maxy = q->pos[k+1];
+        }
+        if (!GRRLIB_BoxVisible(minx, miny, maxx, maxy, &GRRLIB_Settings.clip))  continue;
+
+        if (minx < GRRLIB_POS_MIN || maxx > GRRLIB_POS_MAX ||
+            miny < GRRLIB_POS_MIN || maxy > GRRLIB_POS_MAX)  compact = false;
+        q->color = GRRLIB_TexColor(tex, sp->color);
+        FlipTexCoords(tex, &q->s1, &q->s2, &q->t1, &q->t2);
+        m++;
     }
 
-    GX_LoadTexObj(&texObj,      GX_TEXMAP0);
-    GX_SetTevOp  (GX_TEVSTAGE0, GX_MODULATE);
-    GX_SetVtxDesc(GX_VA_TEX0,   GX_DIRECT);
+    if (m != 0) {
+        GRRLIB_BindTex(tex, tex->w, tex->h);
+        GX_LoadPosMtxImm(GXmodelView2D, GX_PNMTX0);
+
+        compact = compact && GRRLIB_CompactOK();
+        max = GRRLIB_FifoQuads(compact ? BATCH_QUADSIZE16 : BATCH_QUADSIZE);
+        for (i = 0; i < m; i += batch) {
+            batch = (m - i < max) ? m - i : max;
+            GX_Begin(GX_QUADS, compact ? GRRLIB_VTXFMT_S16 : GX_VTXFMT0, batch * 4);
+            for (q = &quads[i]; q < &quads[i + batch]; q++) {
+                for (k = 0; k < 8; k += 2) {
+                    tmp = (k == 0 || k == 6) ? q->s1 : q->s2;
+                    if (compact) {
+                        GX_Position2s16(GRRLIB_PosS16(q->pos[k]), GRRLIB_PosS16(q->pos[k+1]));
+                        GX_Color1u32   (q->color);
+                        GX_TexCoord2u16(GRRLIB_TexU16(tmp),
+                                        GRRLIB_TexU16((k < 4) ? q->t1 : q->t2));
+                    }
+                    else {
+                        GX_Position3f32(q->pos[k], q->pos[k+1], 0);
+                        GX_Color1u32   (q->color);
+                        GX_TexCoord2f32(tmp, (k < 4) ? q->t1 : q->t2);
+                    }
+                }
+            }
+            GX_End();
+            GRRLIB_FifoSample();
+        }
+
+        GX_SetTevOp  (GX_TEVSTAGE0, GX_PASSCLR);
+        GX_SetVtxDesc(GX_VA_TEX0,   GX_NONE);
+    }
 
-    guMtxIdentity  (m1);
-    guMtxScaleApply(m1, m1, 1, 1, 1.0f);
-    guMtxRotAxisDeg(m2, &axis, 0);
-    guMtxConcat    (m2, m1, m);
-    guMtxConcat    (GXmodelView2D, m, mv);
-
-    GX_LoadPosMtxImm(mv, GX_PNMTX0);
-    GX_Begin(GX_QUADS, GX_VTXFMT0, 4);
-        GX_Position3f32(pos[0].x, pos[0].y, 0);
-        GX_Color1u32   (color);
-        GX_TexCoord2f32(s1, t1);
-
-        GX_Position3f32(pos[1].x, pos[1].y, 0);
-        GX_Color1u32   (color);
-        GX_TexCoord2f32(s2, t1);
-
-        GX_Position3f32(pos[2].x, pos[2].y, 0);
-        GX_Color1u32   (color);
-        GX_TexCoord2f32(s2, t2);
-
-        GX_Position3f32(pos[3].x, pos[3].y, 0);
-        GX_Color1u32   (color);
-        GX_TexCoord2f32(s1, t2);
-    GX_End();
-    GX_LoadPosMtxImm(GXmodelView2D, GX_PNMTX0);
+    return m;
+}
 
-    GX_SetTevOp  (GX_TEVSTAGE0, GX_PASSCLR);
-    GX_SetVtxDesc(GX_VA_TEX0,   GX_NONE);
+/**
+ * Free the work area of GRRLIB_DrawImgBatch.
+ */
+void  GRRLIB_ExitImgBatch (void) {
+    free(batchQuads);
+    batchQuads = NULL;
+    batchCap   = 0;
+}
+
+/**
+ * Find the oldest frame buffer in a given state.
+ * @param state One of the XFB_ states.
+ * @return The index of the frame buffer, or -1 if there is none.
+ */
+static
+int  PresentOldest (const u8 state) {
+    int  i, found = -1;
+
+    for (i = 0; i < XFB_COUNT; i++) {
+        if (xfbState[i] == state &&
+            (found < 0 || (s32)(xfbOrder[i] - xfbOrder[found]) < 0))
+            found = i;
+    }
+    return found;
+}
+
+/**
+ * Draw-done interrupt: the oldest submitted frame is finished.
+ * In pipelined mode only GRRLIB_Render raises it, GRRLIB_DrawDone waits on
+ * a sync token instead, so the oldest frame is always the right one.
+ */
+static
+void  PresentDrawDone (void) {
+    const int  i = PresentOldest(XFB_DRAWING);
+
+    if (i < 0)  return;
+    xfbState[i] = XFB_READY;
+    frameDone   = xfbFrame[i];
+}
+
+/**
+ * Retrace interrupt: put the oldest finished frame on screen.
+ * The frame buffer it replaces is still scanned until the next retrace.
+ * @param count Number of retraces so far.
+ */
+static
+void  PresentRetrace (u32 count) {
+    const int  i = PresentOldest(XFB_READY);
+
+    if (xfbRetired >= 0) {
+        xfbState[xfbRetired] = XFB_FREE;
+        xfbRetired = -1;
+    }
+    if (i < 0)  return;
+
+    VIDEO_SetNextFramebuffer(xfb[i]);
+    VIDEO_Flush();
+    xfbState[i] = XFB_SHOWN;
+    if (fb != (u32)i)  xfbRetired = fb;
+    fb      = i;
+    latency = diff_usec(xfbTime[i], gettime());
+}
+
+/**
+ * Get a frame buffer that is neither on screen nor waiting to be, to copy
+ * the EFB into. In pipelined mode this waits for one to be free.
+ * @return The index of the frame buffer.
+ */
+static
+int  PresentTarget (void) {
+    int  i;
+
+    if (!pipelined)  return (fb == 0) ? 1 : 0;
+
+    for (;;) {
+        for (i = 0; i < XFB_COUNT; i++)
+            if (xfbState[i] == XFB_FREE)  return i;
+        VIDEO_WaitVSync();
+    }
+}
+
+/**
+ * Get a frame buffer that can be overwritten, like to clear the EFB with
+ * a copy.
+ * @return A frame buffer that is neither on screen nor waiting to be.
+ */
+void*  GRRLIB_SpareXfb (void) {
+    return xfb[PresentTarget()];
+}
+
+/**
+ * Wait for the GPU to finish the frames submitted to it.
+ * In pipelined mode the GPU may still be reading the data of the last
+ * frames while the next one is built: call this before changing or freeing
+ * memory they could use. Does nothing otherwise.
+ */
+void  GRRLIB_WaitFrames (void) {
+    if (!pipelined || PresentOldest(XFB_DRAWING) < 0)  return;
+
+    GRRLIB_DrawDone();
+    // The draw-done interrupts of the frames may not have run yet
+    while (PresentOldest(XFB_DRAWING) >= 0) ;
+}
+
+/**
+ * Get the number of the frame being drawn, it goes up with each
+ * GRRLIB_Render.
+ * @return The frame number, never 0.
+ */
+u32  GRRLIB_FrameNumber (void) {
+    return frameNumber;
+}
+
+/**
+ * Get the number of the last frame the GP has finished drawing. Data only
+ * used up to that frame can be changed without waiting.
+ * @return A number given by GRRLIB_FrameNumber, or 0 before the first one.
+ */
+u32  GRRLIB_FrameDone (void) {
+    return frameDone;
+}
+
+/**
+ * Turn pipelined frame presentation on/off.
+ * In pipelined mode GRRLIB_Render does not wait for the GPU nor for the
+ * retrace: the frame is copied to one of three frame buffers and put on
+ * screen by the retrace interrupt once the GPU is done, while the CPU
+ * already builds the next frame. GRRLIB_Render only waits when all three
+ * frame buffers are busy, which keeps the frame rate at the refresh rate.
+ * The GPU may still be drawing the last two frames, so call
+ * GRRLIB_WaitFrames before changing or freeing textures and other data
+ * they use.
+ * @param enable Set to true to pipeline frames (Default: Disabled).
+ * @return false if the third frame buffer could not be allocated.
+ */
+bool  GRRLIB_SetPipelined (const bool enable) {
+    int  i;
+
+    if (enable == pipelined)  return true;
+
+    GRRLIB_WaitFrames();
+    GRRLIB_DrawDone();
+
+    if (enable) {
+        if (xfb[2] == NULL) {
+            xfb[2] = MEM_K0_TO_K1(SYS_AllocateFramebuffer(rmode));
+            if (xfb[2] == NULL)  return false;
+        }
+        for (i = 0; i < XFB_COUNT; i++)  xfbState[i] = XFB_FREE;
+        xfbState[fb] = XFB_SHOWN;
+        xfbRetired   = -1;
+        GX_SetDrawDoneCallback(PresentDrawDone);
+        VIDEO_SetPreRetraceCallback(PresentRetrace);
+    }
+    else {
+        // Let the finished frames reach the screen
+        while (PresentOldest(XFB_READY) >= 0)  VIDEO_WaitVSync();
+        VIDEO_SetPreRetraceCallback(NULL);
+        GX_SetDrawDoneCallback(NULL);
+    }
+    pipelined = enable;
+    return true;
+}
+
+/**
+ * Get current frame pipelining setting.
+ * @return True if frames are pipelined.
+ */
+bool  GRRLIB_GetPipelined (void) {
+    return pipelined;
 }
 
 /**
  * Call this function after drawing.
  */
 void  GRRLIB_Render (void) {
-    GX_DrawDone();          // Tell the GX engine we are done drawing
-    GX_InvalidateTexAll();
+    const u8   clear = GRRLIB_Settings.dirtyMode ? GX_FALSE : GX_TRUE;
+    const u32  frame = frameNumber;
+    u64        start;
+    int        next;
 
-    fb ^= 1;  // Toggle framebuffer index
+    GRRLIB_QueueFlush();    // Draw the sprites still waiting in the queue
+    GRRLIB_FlushPrimitives();
+
+    lastStats = frameStats;
+    memset(&frameStats, 0, sizeof(frameStats));
+    if (++frameNumber == 0)  frameNumber = 1;
+    GRRLIB_FifoStats(&lastStats);
 
     GX_SetZMode      (GX_TRUE, GX_LEQUAL, GX_TRUE);
     GX_SetColorUpdate(GX_TRUE);
-    GX_CopyDisp      (xfb[fb], GX_TRUE);
 
-    VIDEO_SetNextFramebuffer(xfb[fb]);  // Select eXternal Frame Buffer
-    VIDEO_Flush();                      // Flush video buffer to screen
-    VIDEO_WaitVSync();                  // Wait for screen to update
-    // Interlaced screens require two frames to update
-    if (rmode->viTVMode &VI_NON_INTERLACE)  VIDEO_WaitVSync();
+    if (pipelined) {
+        start = gettime();
+        next  = PresentTarget();
+        lastStats.stall = diff_usec(start, gettime());
+
+        // In dirty rectangle mode the EFB keeps this frame to draw the next one over
+        GX_CopyDisp(xfb[next], clear);
+        xfbOrder[next] = xfbNext++;
+        xfbTime[next]  = gettime();
+        xfbFrame[next] = frame;
+        xfbState[next] = XFB_DRAWING;
+        GX_SetDrawDone();   // Raises the draw-done interrupt, no waiting
+        GRRLIB_FifoSubmit();
+        GX_InvalidateTexAll();
+        // The indexed colours are still in use: they are recycled as the ring wraps
+    }
+    else {
+        start = gettime();
+        GRRLIB_DrawDone();      // Tell the GX engine we are done drawing
+        lastStats.stall = diff_usec(start, gettime());
+        frameDone       = frame;
+        GX_InvalidateTexAll();
+        GX_InvVtxCache();       // The indexed colours are refilled from slot 0
+        colorNext = 0;          // The GP is done with the indexed colours
+
+        fb = PresentTarget();   // Toggle framebuffer index
+
+        // In dirty rectangle mode the EFB keeps this frame to draw the next one over
+        GX_CopyDisp(xfb[fb], clear);
+        GRRLIB_FifoSubmit();
+
+        start = gettime();
+        VIDEO_SetNextFramebuffer(xfb[fb]);  // Select eXternal Frame Buffer
+        VIDEO_Flush();                      // Flush video buffer to screen
+        VIDEO_WaitVSync();                  // Wait for screen to update
+        // Interlaced screens require two frames to update
+        if (rmode->viTVMode &VI_NON_INTERLACE)  VIDEO_WaitVSync();
+        // The frame was copied when the wait started
+        latency          = diff_usec(start, gettime());
+        lastStats.stall += latency;
+    }
+
+    // Nothing is dirty in the next frame until marked
+    if (GRRLIB_Settings.dirtyMode) {
+        GRRLIB_Settings.dirty.w = 0;
+        GRRLIB_Settings.dirty.h = 0;
+        GRRLIB_ClipReset();
+    }
+}
+
+/**
+ * Get the counters of the last rendered frame.
+ * Sprites found entirely outside the clipping area when they are drawn
+ * or queued are culled, the others are drawn. The stall is the time
+ * GRRLIB_Render spent waiting for the GPU or the retrace, and the latency
+ * the time between the end of the last frame put on screen and its
+ * display.
+ * @param stats Receives the counters.
+ */
+void  GRRLIB_GetDrawStats (GRRLIB_drawStats *stats) {
+    *stats         = lastStats;
+    stats->latency = latency;
 }
@@ -20,26 +20,95 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 THE SOFTWARE.
 ------------------------------------------------------------------------------*/
 
+#include <malloc.h>
+#include <string.h>
+
 #include <grrlib.h>
+#include "grrlib/GRRLIB_private.h"
+
+#define POOL_BLOCKS  32         /**< Most blocks kept by the render target pool. */
+
+/**
+ * A block of memory of the render target pool.
+ */
+typedef struct {
+    void  *data;    /**< The memory, 32 bytes aligned. NULL if the slot is empty. */
+    u32   size;     /**< Its size in bytes. */
+    bool  used;     /**< Held by a render target. */
+    u16   token;    /**< Sync token sent when the block was released. */
+    u32   frame;    /**< Frame number when the block was released. */
+} PoolBlock;
+
+static PoolBlock  pool[POOL_BLOCKS];
 
 /**
  * Make a snapshot of the screen in a texture WITHOUT ALPHA LAYER.
+ * The texture can be drawn right away. To read its pixels with the CPU,
+ * use GRRLIB_Screen2TextureAsync and wait for the copy.
  * @param posx top left corner of the grabbed part.
  * @param posy top left corner of the grabbed part.
  * @param tex A pointer to a texture representing the screen or NULL if an error occurs.
  * @param clear When this flag is set to true, the screen is cleared after copy.
  */
 void  GRRLIB_Screen2Texture (int posx, int posy, GRRLIB_texImg *tex, bool clear) {
-    if(tex->data != NULL) {
-        GX_SetTexCopySrc(posx, posy, tex->w, tex->h);
-        GX_SetTexCopyDst(tex->w, tex->h, GX_TF_RGBA8, GX_FALSE);
-        GX_CopyTex(tex->data, GX_FALSE);
-        GX_PixModeSync();
-        GRRLIB_FlushTex(tex);
-        if(clear) {
-            GX_CopyDisp(xfb[!fb], GX_TRUE);
-        }
+    GRRLIB_Screen2TextureAsync(posx, posy, tex, clear);
+}
+
+/**
+ * Make a snapshot of the screen in a texture WITHOUT ALPHA LAYER, without
+ * waiting for it. The texture can be drawn right away: the GP finishes the
+ * copy before it reads it. The CPU must wait for the returned token before
+ * reading the pixels.
+ * @param posx top left corner of the grabbed part.
+ * @param posy top left corner of the grabbed part.
+ * @param tex A pointer to a texture representing the screen or NULL if an error occurs.
+ * @param clear When this flag is set to true, the screen is cleared after copy.
+ * @return A token for GRRLIB_WaitCopy and GRRLIB_CopyDone.
+ */
+u16  GRRLIB_Screen2TextureAsync (int posx, int posy, GRRLIB_texImg *tex, bool clear) {
+    u16  token;
+
+    // Everything drawn so far must be in the EFB
+    GRRLIB_QueueFlush();
+    GRRLIB_FlushPrimitives();
+
+    if (tex->data == NULL)  return GRRLIB_PutSync();
+
+    // No dirty cache line may be written over the copy later
+    DCInvalidateRange(tex->data, GRRLIB_TexDataSize(tex));
+    GX_SetTexCopySrc(posx, posy, tex->w, tex->h);
+    GX_SetTexCopyDst(tex->w, tex->h, GRRLIB_TexFmtGX(tex->format), GX_FALSE);
+    GX_CopyTex(tex->data, GX_FALSE);
+    GX_PixModeSync();       // Only holds the GP, until the copy is in memory
+    GX_InvalidateTexAll();  // The texture cache may hold the previous pixels
+    token = GRRLIB_PutSync();
+    if (clear) {
+        GX_CopyDisp(GRRLIB_SpareXfb(), GX_TRUE);
     }
+    return token;
+}
+
+/**
+ * Tell whether a copy is done, without waiting.
+ * @param token A token returned by a copy.
+ * @return true if the pixels can be read by the CPU.
+ */
+bool  GRRLIB_CopyDone (const u16 token) {
+    return GRRLIB_SyncReached(token);
+}
+
+/**
+ * Wait until a copy is done, to read its pixels with the CPU.
+ * Textures that are only drawn never need this.
+ * @param token A token returned by a copy.
+ */
+void  GRRLIB_WaitCopy (const u16 token) {
+    if (GRRLIB_SyncReached(token))  return;
+
+    // The token may still be waiting in the FIFO
+    GRRLIB_FifoSubmit();
+    GX_Flush();
+    while (!GRRLIB_SyncReached(token)) ;
 }
 
 /**
@@ -47,6 +116,8 @@ void  GRRLIB_Screen2Texture (int posx, int posy, GRRLIB_texImg *tex, bool clear)
  * @see GRRLIB_CompoEnd
  */
 void GRRLIB_CompoStart (void) {
+    GRRLIB_QueueFlush();
+    GRRLIB_FlushPrimitives();
     GX_SetPixelFmt(GX_PF_RGBA6_Z24, GX_ZC_LINEAR);
     GX_PokeAlphaRead(GX_READ_NONE);
 }
@@ -65,3 +136,188 @@ void GRRLIB_CompoEnd(int posx, int posy, GRRLIB_texImg *tex) {
     if (rmode->aa)  GX_SetPixelFmt(GX_PF_RGB565_Z16, GX_ZC_LINEAR);
     else            GX_SetPixelFmt(GX_PF_RGB8_Z24  , GX_ZC_LINEAR);
 }
+
+/**
+ * Wait until the GP is done with the commands sent before a block was
+ * released, so its memory can be reused or freed.
+ * @param b A block that is not used.
+ */
+static
+void  PoolWait (const PoolBlock *b) {
+    // Tokens wrap around, but a frame three behind is always finished
+    if (GRRLIB_FrameNumber() - b->frame < 3)  GRRLIB_WaitCopy(b->token);
+}
+
+/**
+ * Get a block of memory from the render target pool.
+ * The smallest free block big enough is reused, else a new one is made.
+ * @param size Size in bytes.
+ * @return The memory, or NULL if there is not enough.
+ */
+static
+void*  PoolAlloc (const u32 size) {
+    PoolBlock  *best = NULL, *empty = NULL;
+    uint       i;
+
+    for (i = 0; i < POOL_BLOCKS; i++) {
+        if (pool[i].data == NULL) {
+            if (empty == NULL)  empty = &pool[i];
+        }
+        else if (!pool[i].used && pool[i].size >= size &&
+                 (best == NULL || pool[i].size < best->size)) {
+            best = &pool[i];
+        }
+    }
+
+    if (best == NULL) {
+        if (empty == NULL) {
+            // The table is full: drop a free block to make room
+            for (i = 0; i < POOL_BLOCKS; i++)
+                if (!pool[i].used)  break;
+            if (i == POOL_BLOCKS)  return NULL;
+            PoolWait(&pool[i]);
+            free(pool[i].data);
+            empty = &pool[i];
+        }
+        if ( !(empty->data = memalign(32, size)) )  return NULL;
+        empty->size = size;
+        best = empty;
+    }
+    else {
+        PoolWait(best);
+    }
+
+    best->used = true;
+    return best->data;
+}
+
+/**
+ * Give a block of memory back to the render target pool.
+ * @param data Memory from PoolAlloc.
+ */
+static
+void  PoolRelease (void *data) {
+    uint  i;
+
+    for (i = 0; i < POOL_BLOCKS; i++) {
+        if (pool[i].data == data) {
+            pool[i].used  = false;
+            pool[i].token = GRRLIB_PutSync();   // Ends the commands using it
+            pool[i].frame = GRRLIB_FrameNumber();
+            return;
+        }
+    }
+}
+
+/**
+ * Create a render target, to copy a part of the EFB into a texture.
+ * The width and height are rounded up to a multiple of 4 (8 for the width
+ * of I8 targets), doubled for a half size copy. A half size copy is scaled
+ * down by the box filter of the copy unit: it takes a quarter of the memory
+ * and of the copy bandwidth.
+ * The memory comes from a pool, so creating and freeing render targets
+ * every frame does not allocate.
+ * @param w Width of the EFB part to copy.
+ * @param h Height of the EFB part to copy.
+ * @param format Pixel format of the texture.
+ * @param half Set to true to copy at half the size.
+ * @return A render target, or NULL if there is not enough memory.
+ * @see GRRLIB_FreeRenderTarget
+ */
+GRRLIB_renderTarget*  GRRLIB_CreateRenderTarget (const uint w, const uint h,
+                                                 const GRRLIB_texFormat format,
+                                                 const bool half) {
+    const uint           alignh = half ? 8 : 4;
+    const uint           alignw = (format == GRRLIB_TEXFMT_I8) ? alignh * 2 : alignh;
+    GRRLIB_renderTarget  *rt;
+
+    if ( !(rt = calloc(1, sizeof(GRRLIB_renderTarget))) )  return NULL;
+
+    rt->srcw       = (w + alignw - 1) & ~(alignw - 1);
+    rt->srch       = (h + alignh - 1) & ~(alignh - 1);
+    rt->half       = half;
+    rt->tex.w      = half ? rt->srcw / 2 : rt->srcw;
+    rt->tex.h      = half ? rt->srch / 2 : rt->srch;
+    rt->tex.format = format;
+    GRRLIB_SetHandle(&rt->tex, 0, 0);
+
+    if ( !(rt->tex.data = PoolAlloc(GRRLIB_TexDataSize(&rt->tex))) ) {
+        free(rt);
+        return NULL;
+    }
+    return rt;
+}
+
+/**
+ * Free a render target. Its memory goes back to the pool, and is only
+ * reused or freed once the GP is done with the commands sent so far.
+ * @param rt The render target to free.
+ * @see GRRLIB_TrimRenderTargets
+ */
+void  GRRLIB_FreeRenderTarget (GRRLIB_renderTarget *rt) {
+    if (rt == NULL)  return;
+
+    PoolRelease(rt->tex.data);  // Not reused before the GP is done with it
+    free(rt);
+}
+
+/**
+ * Copy a part of the EFB into a render target, without waiting for it.
+ * The target can be drawn right away: the GP finishes the copy before it
+ * reads it. The CPU must wait for the returned token before reading the
+ * pixels.
+ * @param rt The render target.
+ * @param posx Top left corner of the copied part, a multiple of 2.
+ * @param posy Top left corner of the copied part, a multiple of 2.
+ * @param clear When this flag is set to true, the screen is cleared after copy.
+ * @return A token for GRRLIB_WaitCopy and GRRLIB_CopyDone.
+ */
+u16  GRRLIB_RenderTargetCopy (GRRLIB_renderTarget *rt, int posx, int posy, bool clear) {
+    u16  token;
+
+    // Everything drawn so far must be in the EFB
+    GRRLIB_QueueFlush();
+    GRRLIB_FlushPrimitives();
+
+    DCInvalidateRange(rt->tex.data, GRRLIB_TexDataSize(&rt->tex));
+    GX_SetTexCopySrc(posx & ~1, posy & ~1, rt->srcw, rt->srch);
+    GX_SetTexCopyDst(rt->tex.w, rt->tex.h, GRRLIB_TexFmtGX(rt->tex.format),
+                     rt->half ? GX_TRUE : GX_FALSE);
+    GX_CopyTex(rt->tex.data, GX_FALSE);
+    GX_PixModeSync();       // Only holds the GP, until the copy is in memory
+    GX_InvalidateTexAll();  // The texture cache may hold the previous copy
+    token = GRRLIB_PutSync();
+    if (clear) {
+        GX_CopyDisp(GRRLIB_SpareXfb(), GX_TRUE);
+    }
+    return token;
+}
+
+/**
+ * Free the pooled memory no render target is using.
+ * Waits for the GP if it may still use some of it.
+ */
+void  GRRLIB_TrimRenderTargets (void) {
+    uint  i;
+
+    for (i = 0; i < POOL_BLOCKS; i++) {
+        if (pool[i].data != NULL && !pool[i].used) {
+            PoolWait(&pool[i]);
+            free(pool[i].data);
+            pool[i].data = NULL;
+        }
+    }
+}
+
+/**
+ * Free the whole render target pool.
+ * Render targets must not be used after this.
+ */
+void  GRRLIB_ExitRenderTargets (void) {
+    uint  i;
+
+    for (i = 0; i < POOL_BLOCKS; i++) {
+        if (pool[i].data != NULL)  free(pool[i].data);
+    }
+    memset(pool, 0, sizeof(pool));
+}
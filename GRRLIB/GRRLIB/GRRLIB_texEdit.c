@@ -21,12 +21,17 @@ THE SOFTWARE.
 ------------------------------------------------------------------------------*/
 
 #include <malloc.h>
+#include <math.h>
 #include <pngu.h>
 #include <stdio.h>
 #include <jpeglib.h>
 #include <string.h>
 
 #include <grrlib.h>
+#include "grrlib/GRRLIB_private.h"
+
+#define RESIZE_BITS   (14)  /**< Fractional bits of the resampling weights.        */
+#define RESIZE_HBITS  (6)   /**< Fractional bits kept between the two passes.       */
 
 /**
  * This structure contains information about the type, size, and layout of a file that containing a device-independent bitmap (DIB).
@@ -111,6 +116,7 @@ void  RawTo4x4RGBA (const u8 *src, void *dst,
 
 /**
  * Load a texture from a buffer.
+ * The texture is premultiplied if GRRLIB_SetPremultiply is enabled.
  * @param my_img The JPEG, PNG or Bitmap buffer to load.
  * @return A GRRLIB_texImg structure filled with image information.
  */
@@ -138,10 +144,14 @@ GRRLIB_texImg*  GRRLIB_LoadTexturePNG (const u8 *my_png) {
     if(my_texture != NULL) {
         ctx = PNGU_SelectImageFromBuffer(my_png);
         PNGU_GetImageProperties(ctx, &imgProp);
-        my_texture->data = PNGU_DecodeTo4x4RGBA8(ctx, imgProp.imgWidth, imgProp.imgHeight, &width, &height, NULL);
+        if(GRRLIB_Settings.premultiply)
+            my_texture->data = PNGU_DecodeTo4x4RGBA8Premult(ctx, imgProp.imgWidth, imgProp.imgHeight, &width, &height, NULL);
+        else
+            my_texture->data = PNGU_DecodeTo4x4RGBA8(ctx, imgProp.imgWidth, imgProp.imgHeight, &width, &height, NULL);
         if(my_texture->data != NULL) {
             my_texture->w = width;
             my_texture->h = height;
+            my_texture->premult = GRRLIB_Settings.premultiply;
             GRRLIB_SetHandle( my_texture, 0, 0 );
             if(imgProp.imgWidth != width || imgProp.imgHeight != height) {
                 // PNGU has resized the texture
@@ -212,6 +222,7 @@ GRRLIB_texImg*  GRRLIB_LoadTextureBMP (const u8 *my_bmp) {
         if(my_texture->data != NULL && MyBitmapFileHeader.bfType == 0x4D42) {
             my_texture->w = MyBitmapHeader.biWidth;
             my_texture->h = MyBitmapHeader.biHeight;
+            my_texture->premult = GRRLIB_Settings.premultiply;  // Applied by GRRLIB_SetPixelTotexImg
             switch(MyBitmapHeader.biBitCount) {
                 case 32:    // RGBA images
                     i = 54;
@@ -382,7 +393,255 @@ GRRLIB_texImg*  GRRLIB_LoadTextureJPGEx (const u8 *my_jpg, const int my_size) {
 
     my_texture->w = cinfo.output_width;
     my_texture->h = cinfo.output_height;
+    my_texture->premult = GRRLIB_Settings.premultiply;  // Opaque, nothing to multiply
     GRRLIB_SetHandle( my_texture, 0, 0 );
     GRRLIB_FlushTex( my_texture );
     return my_texture;
 }
+
+/**
+ * Resampling filter kernel.
+ * @param x Distance to the filter centre, in filter units.
+ * @param filter The filter to evaluate.
+ * @return The (unnormalized) weight.
+ */
+static f32  ResizeKernel (f32 x, const GRRLIB_filterMode filter) {
+    x = fabsf(x);
+    switch (filter) {
+        case GRRLIB_FILTER_LANCZOS:
+            if (x < 1e-5f)  return 1.0f;
+            if (x >= 3.0f)  return 0.0f;
+            return (3.0f * sinf(M_PI * x) * sinf(M_PI * x / 3.0f)) / (M_PI * M_PI * x * x);
+        case GRRLIB_FILTER_BILINEAR:
+            return (x < 1.0f) ? 1.0f - x : 0.0f;
+        default:
+            return (x <= 0.5f) ? 1.0f : 0.0f;
+    }
+}
+
+/**
+ * Precompute the fixed point weights to resample one axis.
+ * Output pixel i reads taps source pixels starting at start[i], with the
+ * weights weights[i*taps ...]. Taps falling outside of the source are folded
+ * onto the edge pixels and the weights of each pixel sum to 1 << RESIZE_BITS.
+ * @param srcn Source size.
+ * @param dstn Destination size.
+ * @param filter The filter to use.
+ * @param taps Receives the number of taps per output pixel.
+ * @param start Receives the first source pixel of each output pixel.
+ * @return The weight table, to be freed by the caller, or NULL.
+ */
+static s16*  ResizeWeights (const uint srcn, const uint dstn,
+                            const GRRLIB_filterMode filter,
+                            int *taps, int *start) {
+    const f32  scale   = (f32)srcn / dstn;
+    const f32  fscale  = (scale > 1.0f) ? scale : 1.0f;
+    const f32  radius  = (filter == GRRLIB_FILTER_LANCZOS)  ? 3.0f :
+                         (filter == GRRLIB_FILTER_BILINEAR) ? 1.0f : 0.5f;
+    const f32  support = radius * fscale;
+    f32        *tmp;
+    s16        *weights;
+    int        n, i, j, k, lo, hi, first, last, sum, big;
+    f32        centre, total;
+
+    n = (filter == GRRLIB_FILTER_NEAREST) ? 1 : (int)ceilf(support) * 2 + 1;
+    if (n > (int)srcn)  n = srcn;
+    weights = calloc(dstn * n, sizeof(s16));
+    if (weights == NULL)  return NULL;
+    // The window grows with the downscale factor, keep it off the stack
+    tmp = malloc(n * sizeof(f32));
+    if (tmp == NULL) {
+        free(weights);
+        return NULL;
+    }
+
+    for (i = 0; i < (int)dstn; i++) {
+        s16  *w = weights + i*n;
+
+        centre = (i + 0.5f) * scale - 0.5f;
+        if (filter == GRRLIB_FILTER_NEAREST) {
+            lo = hi = (int)floorf(centre + 0.5f);
+        }
+        else {
+            lo = (int)ceilf (centre - support);
+            hi = (int)floorf(centre + support);
+        }
+
+        // The window of n source pixels, kept inside the source
+        first = (lo + hi + 1) / 2 - n / 2;
+        if (lo <= hi && hi - lo + 1 <= n)  first = lo;
+        if (first < 0)  first = 0;
+        if (first > (int)srcn - n)  first = srcn - n;
+        last = first + n - 1;
+        start[i] = first;
+
+        // Evaluate the filter, folding out-of-range taps onto the window
+        memset(tmp, 0, n * sizeof(f32));
+        total = 0.0f;
+        for (j = lo; j <= hi; j++) {
+            f32  v = (filter == GRRLIB_FILTER_NEAREST) ? 1.0f
+                   : ResizeKernel((j - centre) / fscale, filter);
+            k = (j < first) ? first : ((j > last) ? last : j);
+            tmp[k - first] += v;
+            total += v;
+        }
+        if (total == 0.0f) {
+            tmp[0] = total = 1.0f;
+        }
+
+        // Convert to fixed point, giving the rounding error to the biggest tap
+        sum = 0;
+        big = 0;
+        for (k = 0; k < n; k++) {
+            w[k] = (s16)floorf(tmp[k] / total * (1 << RESIZE_BITS) + 0.5f);
+            sum += w[k];
+            if (w[k] > w[big])  big = k;
+        }
+        w[big] += (1 << RESIZE_BITS) - sum;
+    }
+
+    free(tmp);
+    *taps = n;
+    return weights;
+}
+
+/**
+ * Create a resized copy of a texture.
+ * The filter weights are computed once per axis in fixed point, then the
+ * image is filtered horizontally and vertically, producing the destination
+ * one row at a time. Only the source rows under the vertical filter are
+ * kept in memory.
+ * @param tex The texture to resize, in GRRLIB_TEXFMT_RGBA8.
+ * @param w Width of the new texture, a multiple of 4.
+ * @param h Height of the new texture, a multiple of 4.
+ * @param filter The resampling filter.
+ * @return A new GRRLIB_texImg structure or NULL if an error occurs.
+ */
+GRRLIB_texImg*  GRRLIB_ResizeTexture (const GRRLIB_texImg *tex,
+                                      const uint w, const uint h,
+                                      const GRRLIB_filterMode filter) {
+    GRRLIB_texImg  *my_texture;
+    s16            *wx = NULL, *wy = NULL, *ring = NULL;
+    s16            **rows = NULL;
+    int            *sx, *sy;
+    u32            *line, *out;
+    int            tx, ty, loaded = 0;
+    uint           x, y;
+    int            i, j;
+
+    if (tex == NULL || tex->data == NULL || tex->format != GRRLIB_TEXFMT_RGBA8 ||
+        w == 0 || h == 0 || (w & 3) || (h & 3))
+        return NULL;
+
+    my_texture = GRRLIB_CreateEmptyTexture(w, h);
+    if (my_texture == NULL || my_texture->data == NULL) {
+        GRRLIB_FreeTexture(my_texture);
+        return NULL;
+    }
+
+    sx   = malloc((w + h) * sizeof(int));
+    if (sx != NULL) {
+        sy = sx + w;
+        wx = ResizeWeights(tex->w, w, filter, &tx, sx);
+        wy = ResizeWeights(tex->h, h, filter, &ty, sy);
+    }
+    line = malloc((tex->w + w) * sizeof(u32));
+    if (wy != NULL) {
+        ring = malloc(ty * w * 4 * sizeof(s16));
+        rows = malloc(ty * sizeof(s16*));
+    }
+    my_texture->premult = tex->premult;
+
+    if (sx != NULL && wx != NULL && wy != NULL && line != NULL &&
+        ring != NULL && rows != NULL) {
+        out = line + tex->w;
+        for (y = 0; y < h; y++) {
+            const s16  *wv = wy + y*ty;
+
+            // Horizontal pass over the source rows entering the window
+            for (; loaded < sy[y] + ty; loaded++) {
+                s16  *dst = ring + (loaded % ty) * w * 4;
+
+                GRRLIB_ReadTexRow(tex, 0, loaded, tex->w, line);
+                for (x = 0; x < w; x++, dst += 4) {
+                    const u32  *src = line + sx[x];
+                    const s16  *wh  = wx + x*tx;
+                    s32        r = 0, g = 0, b = 0, a = 0;
+                    for (i = 0; i < tx; i++) {
+                        r += wh[i] * (s32)R(src[i]);
+                        g += wh[i] * (s32)G(src[i]);
+                        b += wh[i] * (s32)B(src[i]);
+                        a += wh[i] * (s32)A(src[i]);
+                    }
+                    dst[0] = r >> (RESIZE_BITS - RESIZE_HBITS);
+                    dst[1] = g >> (RESIZE_BITS - RESIZE_HBITS);
+                    dst[2] = b >> (RESIZE_BITS - RESIZE_HBITS);
+                    dst[3] = a >> (RESIZE_BITS - RESIZE_HBITS);
+                }
+            }
+
+            // Vertical pass
+            for (j = 0; j < ty; j++)
+                rows[j] = ring + ((sy[y] + j) % ty) * w * 4;
+            for (x = 0; x < w; x++) {
+                s32  c[4] = { 0, 0, 0, 0 };
+                for (j = 0; j < ty; j++) {
+                    const s16  *p = rows[j] + x*4;
+                    c[0] += wv[j] * p[0];
+                    c[1] += wv[j] * p[1];
+                    c[2] += wv[j] * p[2];
+                    c[3] += wv[j] * p[3];
+                }
+                for (i = 0; i < 4; i++) {
+                    c[i] = (c[i] + (1 << (RESIZE_BITS + RESIZE_HBITS - 1)))
+                           >> (RESIZE_BITS + RESIZE_HBITS);
+                    if      (c[i] < 0)    c[i] = 0;
+                    else if (c[i] > 255)  c[i] = 255;
+                }
+                out[x] = RGBA(c[0], c[1], c[2], c[3]);
+            }
+            GRRLIB_WriteTexRow(my_texture, 0, y, w, out);
+        }
+        GRRLIB_FlushTex(my_texture);
+    }
+    else {
+        GRRLIB_FreeTexture(my_texture);
+        my_texture = NULL;
+    }
+
+    free(rows);
+    free(ring);
+    free(line);
+    free(wy);
+    free(wx);
+    free(sx);
+    return my_texture;
+}
+
+/**
+ * Premultiply the colours of a texture by their alpha.
+ * Does nothing if the texture is already premultiplied, or is not in
+ * GRRLIB_TEXFMT_RGBA8.
+ * @see GRRLIB_SetPremultiply
+ * @param tex The texture to convert.
+ */
+void  GRRLIB_PremultiplyTex (GRRLIB_texImg *tex) {
+    u8    *bp = (u8*)tex->data;
+    uint  nblocks = (tex->w * tex->h) >> 4;
+    uint  b, p;
+    u32   a, t;
+
+    if (tex->premult || tex->format != GRRLIB_TEXFMT_RGBA8)  return;
+    tex->premult = true;
+
+    // A block holds 16 AR pairs followed by 16 GB pairs
+    for (b = 0; b < nblocks; b++, bp += 64) {
+        for (p = 0; p < 32; p += 2) {
+            if ((a = bp[p]) == 255)  continue;
+            t = bp[p+ 1] * a + 128;  bp[p+ 1] = (t + (t >> 8)) >> 8;
+            t = bp[p+32] * a + 128;  bp[p+32] = (t + (t >> 8)) >> 8;
+            t = bp[p+33] * a + 128;  bp[p+33] = (t + (t >> 8)) >> 8;
+        }
+    }
+    GRRLIB_FlushTex(tex);
+}
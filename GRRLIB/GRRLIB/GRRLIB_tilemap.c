@@ -0,0 +1,599 @@
+/*------------------------------------------------------------------------------
+Copyright (c) 2012 The GRRLIB Team
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+------------------------------------------------------------------------------*/
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <grrlib.h>
+#include "grrlib/GRRLIB_private.h"
+
+extern  GRRLIB_drawSettings  GRRLIB_Settings;
+extern  Mtx                  GXmodelView2D;
+
+#define TILEMAP_MAXQUADS  16383     /**< Quads that fit in one GX_Begin. */
+#define TILEMAP_QUADSIZE  84        /**< Bytes of one quad in a display list.          */
+#define TILEMAP_QUADS16   36        /**< Same, with the compact vertex format.         */
+
+/**
+ * A chunk of a layer, as cached in a display list.
+ */
+typedef  struct TileChunk {
+    GRRLIB_dispList  *dl;       /**< Recorded chunk, NULL if not cached.  */
+    int              prev;      /**< More recently used chunk, or -1.     */
+    int              next;      /**< Less recently used chunk, or -1.     */
+    u32              frame;     /**< Last frame the list was called in.   */
+    bool             blank;     /**< Known to hold no visible tile.       */
+} TileChunk;
+
+/**
+ * Display list cache of a tilemap.
+ */
+struct GRRLIB_tileCache {
+    uint       chunk;           /**< Width and height of a chunk in tiles. */
+    uint       ncx;             /**< Chunks across the map.                */
+    uint       ncy;             /**< Chunks down the map.                  */
+    u32        budget;          /**< Bytes the lists may use, 0 for no cap. */
+    u32        used;            /**< Bytes used by the lists.              */
+    int        head;            /**< Most recently used chunk, or -1.      */
+    int        tail;            /**< Least recently used chunk, or -1.     */
+    TileChunk  *chunks;         /**< Chunks, layer by layer, row by row.   */
+};
+
+/**
+ * Create a tilemap with every cell empty.
+ * The tile size is the one given to GRRLIB_InitTileSet for the tileset.
+ * @param tileset The texture holding the tiles.
+ * @param w Width of the map in tiles.
+ * @param h Height of the map in tiles.
+ * @param layers Number of layers.
+ * @return A GRRLIB_tilemap structure, or NULL on failure.
+ */
+GRRLIB_tilemap*  GRRLIB_CreateTilemap (GRRLIB_texImg *tileset,
+                                       const uint w, const uint h,
+                                       const uint layers) {
+    GRRLIB_tilemap  *map;
+    uint            i, n;
+
+    if (tileset == NULL || !tileset->tiledtex || w == 0 || h == 0 || layers == 0)
+        return NULL;
+
+    map = calloc(1, sizeof(GRRLIB_tilemap));
+    if (map == NULL)  return NULL;
+
+    map->tileset = tileset;
+    map->w       = w;
+    map->h       = h;
+    map->layers  = layers;
+    map->tilew   = tileset->tilew;
+    map->tileh   = tileset->tileh;
+    map->nbtiles = tileset->nbtilew * tileset->nbtileh;
+    if (map->nbtiles > GRRLIB_TILE_ID)  map->nbtiles = GRRLIB_TILE_ID;  // Last id is GRRLIB_TILE_EMPTY
+
+    n          = w * h * layers;
+    map->tiles = malloc(n * sizeof(u16));
+    map->uv    = malloc(map->nbtiles * 4 * sizeof(f32));
+    if (map->tiles == NULL || map->uv == NULL) {
+        GRRLIB_FreeTilemap(map);
+        return NULL;
+    }
+
+    for (i = 0; i < n; i++)  map->tiles[i] = GRRLIB_TILE_EMPTY;
+
+    // Same coordinates as GRRLIB_DrawTile, worked out once
+    for (i = 0; i < map->nbtiles; i++) {
+        map->uv[i*4 + 0] = (i % tileset->nbtilew) * tileset->ofnormaltexx;
+        map->uv[i*4 + 1] = (i / tileset->nbtilew) * tileset->ofnormaltexy;
+        map->uv[i*4 + 2] = map->uv[i*4 + 0] + tileset->ofnormaltexx;
+        map->uv[i*4 + 3] = map->uv[i*4 + 1] + tileset->ofnormaltexy;
+    }
+    return map;
+}
+
+/**
+ * Free memory allocated for a tilemap.
+ * The tileset is not freed.
+ * @param map A GRRLIB_tilemap structure.
+ */
+void  GRRLIB_FreeTilemap (GRRLIB_tilemap *map) {
+    if (map == NULL)  return;
+
+    GRRLIB_SetTilemapCache(map, 0, 0);
+    free(map->tiles);
+    free(map->uv);
+    free(map);
+}
+
+/**
+ * Cache a tilemap in display lists, one per chunk of each layer.
+ * A chunk is recorded the first time it is seen, then replayed until one of
+ * its tiles changes; the draw colour is not part of the lists. Least
+ * recently used chunks are freed once the lists use more than the budget;
+ * chunks on screen are never freed, so the budget is a soft cap. A cached
+ * tilemap cannot be drawn while a display list is being recorded.
+ * @param map A GRRLIB_tilemap structure.
+ * @param chunk Width and height of a chunk in tiles, 0 to disable the cache.
+ * @param budget Bytes the display lists may use, 0 for no limit.
+ * @return true on success, false on allocation failure (cache disabled).
+ */
+bool  GRRLIB_SetTilemapCache (GRRLIB_tilemap *map, const uint chunk,
+                              const u32 budget) {
+    struct GRRLIB_tileCache  *cache;
+    uint                     i, n;
+
+    if (map == NULL)  return false;
+
+    if (map->cache != NULL) {
+        n = map->cache->ncx * map->cache->ncy * map->layers;
+        for (i = 0; i < n; i++)
+            GRRLIB_DisplayListFree(map->cache->chunks[i].dl);
+        free(map->cache->chunks);
+        free(map->cache);
+        map->cache = NULL;
+    }
+    if (chunk == 0)  return true;
+
+    cache = calloc(1, sizeof(struct GRRLIB_tileCache));
+    if (cache == NULL)  return false;
+
+    cache->chunk  = chunk;
+    cache->ncx    = (map->w + chunk - 1) / chunk;
+    cache->ncy    = (map->h + chunk - 1) / chunk;
+    cache->budget = budget;
+    cache->head   = -1;
+    cache->tail   = -1;
+
+    n             = cache->ncx * cache->ncy * map->layers;
+    cache->chunks = calloc(n, sizeof(TileChunk));
+    if (cache->chunks == NULL) {
+        free(cache);
+        return false;
+    }
+    for (i = 0; i < n; i++)
+        cache->chunks[i].prev = cache->chunks[i].next = -1;
+
+    map->cache = cache;
+    return true;
+}
+
+/**
+ * Set the tile of a cell.
+ * @param map A GRRLIB_tilemap structure.
+ * @param layer The layer to change.
+ * @param x Column of the cell.
+ * @param y Row of the cell.
+ * @param id Tile number (up to 0x3FFE), combined with GRRLIB_TILE_FLIPH and
+ *           GRRLIB_TILE_FLIPV, or GRRLIB_TILE_EMPTY.
+ */
+void  GRRLIB_SetTile (GRRLIB_tilemap *map, const uint layer,
+                      const uint x, const uint y, const u16 id) {
+    if (layer >= map->layers || x >= map->w || y >= map->h)  return;
+
+    map->tiles[(layer * map->h + y) * map->w + x] = id;
+
+    if (map->cache != NULL) {
+        const uint  c = map->cache->chunk;
+        TileChunk   *ch = &map->cache->chunks[(layer * map->cache->ncy + y / c)
+                                              * map->cache->ncx + x / c];
+
+        ch->blank = false;
+        GRRLIB_DisplayListInvalidate(ch->dl);
+    }
+}
+
+/**
+ * Get the tile of a cell.
+ * @param map A GRRLIB_tilemap structure.
+ * @param layer The layer to read.
+ * @param x Column of the cell.
+ * @param y Row of the cell.
+ * @return The tile id, GRRLIB_TILE_EMPTY outside the map.
+ */
+u16  GRRLIB_GetTile (const GRRLIB_tilemap *map, const uint layer,
+                     const uint x, const uint y) {
+    if (layer >= map->layers || x >= map->w || y >= map->h)
+        return GRRLIB_TILE_EMPTY;
+
+    return map->tiles[(layer * map->h + y) * map->w + x];
+}
+
+/**
+ * Check a tile id can be drawn.
+ * @param map A GRRLIB_tilemap structure.
+ * @param id The tile id.
+ * @return true if the id refers to a tile of the tileset.
+ */
+static inline
+bool  TileVisible (const GRRLIB_tilemap *map, const u16 id) {
+    return id != GRRLIB_TILE_EMPTY && (id & GRRLIB_TILE_ID) < map->nbtiles;
+}
+
+/**
+ * Count the tiles to draw in a window of cells.
+ * @param map A GRRLIB_tilemap structure.
+ * @param cells The cells of the layer.
+ * @param x0 First column.
+ * @param y0 First row.
+ * @param x1 Last column.
+ * @param y1 Last row.
+ * @return The number of visible tiles.
+ */
+static
+u32  TilemapCount (const GRRLIB_tilemap *map, const u16 *cells,
+                   const int x0, const int y0, const int x1, const int y1) {
+    u32  count = 0;
+    int  x, y;
+
+    for (y = y0; y <= y1; y++)
+        for (x = x0; x <= x1; x++)
+            if (TileVisible(map, cells[y * map->w + x]))  count++;
+    return count;
+}
+
+/**
+ * Send the tiles of a window of cells as a stream of quads.
+ * The tileset must already be bound and the colour set with
+ * GRRLIB_SetColorIndex.
+ * @param map A GRRLIB_tilemap structure.
+ * @param cells The cells of the layer.
+ * @param x0 First column.
+ * @param y0 First row.
+ * @param x1 Last column.
+ * @param y1 Last row.
+ * @param count Number of visible tiles in the window.
+ * @param ox Map x-coordinate, in pixels, sent as x = 0.
+ * @param oy Map y-coordinate, in pixels, sent as y = 0.
+ */
+static
+void  TilemapCells (GRRLIB_tilemap *map, const u16 *cells,
+                    const int x0, const int y0, const int x1, const int y1,
+                    u32 count, const f32 ox, const f32 oy) {
+    const f32  tw = map->tilew, th = map->tileh;
+    f32        ext[4] = { x0 * tw - ox, y0 * th - oy,
+                          (x1 + 1) * tw - ox, (y1 + 1) * th - oy };
+    const bool compact = GRRLIB_CompactOK() && GRRLIB_FitsS16(ext, 4);
+    const u32  max = GRRLIB_FifoQuads(compact ? TILEMAP_QUADS16 : TILEMAP_QUADSIZE);
+    int        x, y;
+    u32        batch = 0;
+    f32        px, py, s1, s2, t1, t2, tmp;
+    const f32  *uv;
+    u16        id;
+
+    for (y = y0; y <= y1; y++) {
+        py = y * th - oy;
+        for (x = x0; x <= x1; x++) {
+            id = cells[y * map->w + x];
+            if (!TileVisible(map, id))  continue;
+
+            if (batch == 0) {
+                batch = count < max ? count : max;
+                count -= batch;
+                GX_Begin(GX_QUADS, compact ? GRRLIB_VTXFMT_S16 : GX_VTXFMT0,
+                         batch * 4);
+                map->draws++;
+            }
+
+            uv = map->uv + (id & GRRLIB_TILE_ID) * 4;
+            s1 = uv[0];  t1 = uv[1];  s2 = uv[2];  t2 = uv[3];
+            if (id & GRRLIB_TILE_FLIPH) {  tmp = s1;  s1 = s2;  s2 = tmp;  }
+            if (id & GRRLIB_TILE_FLIPV) {  tmp = t1;  t1 = t2;  t2 = tmp;  }
+            px = x * tw - ox;
+
+            if (compact) {
+                const s16  l = GRRLIB_PosS16(px), r = GRRLIB_PosS16(px + tw);
+                const s16  t = GRRLIB_PosS16(py), b = GRRLIB_PosS16(py + th);
+                const u16  us1 = GRRLIB_TexU16(s1), us2 = GRRLIB_TexU16(s2);
+                const u16  ut1 = GRRLIB_TexU16(t1), ut2 = GRRLIB_TexU16(t2);
+
+                GX_Position2s16(l, t);
+                GX_Color1x8    (0);
+                GX_TexCoord2u16(us1, ut1);
+
+                GX_Position2s16(r, t);
+                GX_Color1x8    (0);
+                GX_TexCoord2u16(us2, ut1);
+
+                GX_Position2s16(r, b);
+                GX_Color1x8    (0);
+                GX_TexCoord2u16(us2, ut2);
+
+                GX_Position2s16(l, b);
+                GX_Color1x8    (0);
+                GX_TexCoord2u16(us1, ut2);
+            }
+            else {
+                GX_Position3f32(px, py, 0);
+                GX_Color1x8    (0);
+                GX_TexCoord2f32(s1, t1);
+
+                GX_Position3f32(px + tw, py, 0);
+                GX_Color1x8    (0);
+                GX_TexCoord2f32(s2, t1);
+
+                GX_Position3f32(px + tw, py + th, 0);
+                GX_Color1x8    (0);
+                GX_TexCoord2f32(s2, t2);
+
+                GX_Position3f32(px, py + th, 0);
+                GX_Color1x8    (0);
+                GX_TexCoord2f32(s1, t2);
+            }
+
+            map->quads++;
+            if (--batch == 0) {
+                GX_End();
+                GRRLIB_FifoSample();
+            }
+        }
+    }
+}
+
+/**
+ * Move a chunk to the front of the LRU list of the cache.
+ * @param cache The tilemap cache.
+ * @param i Index of the chunk.
+ * @param linked true if the chunk is already in the list.
+ */
+static
+void  ChunkTouch (struct GRRLIB_tileCache *cache, const int i, const bool linked) {
+    TileChunk  *ch = &cache->chunks[i];
+
+    if (linked) {
+        if (cache->head == i)  return;
+        if (ch->next != -1)  cache->chunks[ch->next].prev = ch->prev;
+        else                 cache->tail = ch->prev;
+        cache->chunks[ch->prev].next = ch->next;
+    }
+    ch->prev = -1;
+    ch->next = cache->head;
+    if (cache->head != -1)  cache->chunks[cache->head].prev = i;
+    else                    cache->tail = i;
+    cache->head = i;
+}
+
+/**
+ * Free the display list of a chunk and take it out of the LRU list.
+ * @param cache The tilemap cache.
+ * @param i Index of the chunk.
+ */
+static
+void  ChunkDrop (struct GRRLIB_tileCache *cache, const int i) {
+    TileChunk  *ch = &cache->chunks[i];
+
+    if (ch->prev != -1)  cache->chunks[ch->prev].next = ch->next;
+    else                 cache->head = ch->next;
+    if (ch->next != -1)  cache->chunks[ch->next].prev = ch->prev;
+    else                 cache->tail = ch->prev;
+    ch->prev = ch->next = -1;
+
+    cache->used -= ch->dl->capacity;
+    GRRLIB_DisplayListFree(ch->dl);
+    ch->dl = NULL;
+}
+
+/**
+ * Drop the least recently used chunks until the cache fits its budget.
+ * Chunks called in the current frame are kept, even over budget.
+ * @param cache The tilemap cache.
+ */
+static
+void  ChunkEvict (struct GRRLIB_tileCache *cache) {
+    while (cache->budget != 0 && cache->used > cache->budget && cache->tail != -1) {
+        if (cache->chunks[cache->tail].frame == GRRLIB_FrameNumber())  break;
+        ChunkDrop(cache, cache->tail);
+    }
+}
+
+/**
+ * Draw one chunk through its display list, recording it first if needed.
+ * Chunks are recorded relative to their top-left corner, so their
+ * coordinates stay small enough for the compact vertex format. A list
+ * already called in this frame is never freed nor recorded again before the
+ * next frame, the chunk is drawn directly instead.
+ * @param map A GRRLIB_tilemap structure.
+ * @param layer The layer of the chunk.
+ * @param cx Column of the chunk.
+ * @param cy Row of the chunk.
+ * @param scrollx Map x-coordinate, in pixels, shown at the left of the screen.
+ * @param scrolly Map y-coordinate, in pixels, shown at the top of the screen.
+ */
+static
+void  TilemapChunk (GRRLIB_tilemap *map, const uint layer,
+                    const uint cx, const uint cy,
+                    const f32 scrollx, const f32 scrolly) {
+    struct GRRLIB_tileCache  *cache = map->cache;
+    const int  i     = (layer * cache->ncy + cy) * cache->ncx + cx;
+    TileChunk  *ch   = &cache->chunks[i];
+    const u16  *cells = map->tiles + layer * map->w * map->h;
+    const int  x0    = cx * cache->chunk;
+    const int  y0    = cy * cache->chunk;
+    const f32  ox    = x0 * (f32)map->tilew;
+    const f32  oy    = y0 * (f32)map->tileh;
+    int        x1    = x0 + cache->chunk - 1;
+    int        y1    = y0 + cache->chunk - 1;
+    const bool busy  = ch->dl != NULL && ch->frame == GRRLIB_FrameNumber();
+    u32        count, need, capacity;
+    Mtx        mv;
+
+    if (ch->blank)  return;
+    if (x1 >= (int)map->w)  x1 = map->w - 1;
+    if (y1 >= (int)map->h)  y1 = map->h - 1;
+
+    guMtxTransApply(GXmodelView2D, mv, ox - scrollx, oy - scrolly, 0);
+    GX_LoadPosMtxImm(mv, GX_PNMTX0);
+
+    if (ch->dl == NULL || ch->dl->size == 0) {
+        count = TilemapCount(map, cells, x0, y0, x1, y1);
+        if (count == 0) {
+            ch->blank = true;
+            if (ch->dl != NULL && !busy)  ChunkDrop(cache, i);
+            return;
+        }
+        if (busy) {
+            TilemapCells(map, cells, x0, y0, x1, y1, count, ox, oy);
+            return;
+        }
+
+        // Quads, GX_Begin headers and the padding GX_EndDispList adds
+        need = count * ((x1 - x0 + 1) * map->tilew <= GRRLIB_POS_MAX &&
+                        (y1 - y0 + 1) * map->tileh <= GRRLIB_POS_MAX
+                        ? TILEMAP_QUADS16 : TILEMAP_QUADSIZE)
+             + (count / TILEMAP_MAXQUADS + 1) * 3 + 32;
+        if (ch->dl != NULL && ch->dl->capacity < need)  ChunkDrop(cache, i);
+        if (ch->dl == NULL) {
+            ch->dl = GRRLIB_DisplayListCreate(need);
+            if (ch->dl == NULL) {
+                TilemapCells(map, cells, x0, y0, x1, y1, count, ox, oy);
+                return;
+            }
+            cache->used += ch->dl->capacity;
+            ChunkTouch(cache, i, false);
+        }
+
+        GRRLIB_DisplayListInvalidate(ch->dl);
+        GRRLIB_DisplayListBegin(ch->dl, 0);
+        TilemapCells(map, cells, x0, y0, x1, y1, count, ox, oy);
+        capacity = ch->dl->capacity;
+        if (GRRLIB_DisplayListEnd(ch->dl) == 0) {
+            // The list grew on overflow, account for it before freeing it
+            cache->used += ch->dl->capacity - capacity;
+            ChunkDrop(cache, i);
+            TilemapCells(map, cells, x0, y0, x1, y1, count, ox, oy);
+            return;
+        }
+    }
+
+    ChunkTouch(cache, i, true);
+    GRRLIB_DisplayListCall(ch->dl);
+    ch->frame = GRRLIB_FrameNumber();
+    map->lists++;
+}
+
+/**
+ * Draw the visible tiles of one layer.
+ * @param map A GRRLIB_tilemap structure.
+ * @param layer The layer to draw.
+ * @param scrollx Map x-coordinate, in pixels, shown at the left of the screen.
+ * @param scrolly Map y-coordinate, in pixels, shown at the top of the screen.
+ */
+static
+void  TilemapLayer (GRRLIB_tilemap *map, const uint layer,
+                    const f32 scrollx, const f32 scrolly) {
+    const u16  *cells = map->tiles + layer * map->w * map->h;
+    int        x0, y0, x1, y1, cx, cy;
+
+    // Window of cells overlapping the screen
+    x0 = floorf(scrollx / map->tilew);
+    y0 = floorf(scrolly / map->tileh);
+    x1 = floorf((scrollx + rmode->fbWidth   - 1) / map->tilew);
+    y1 = floorf((scrolly + rmode->efbHeight - 1) / map->tileh);
+    if (x0 < 0)  x0 = 0;
+    if (y0 < 0)  y0 = 0;
+    if (x1 >= (int)map->w)  x1 = map->w - 1;
+    if (y1 >= (int)map->h)  y1 = map->h - 1;
+    if (x0 > x1 || y0 > y1)  return;
+
+    if (map->cache == NULL) {
+        TilemapCells(map, cells, x0, y0, x1, y1,
+                     TilemapCount(map, cells, x0, y0, x1, y1),
+                     scrollx, scrolly);
+        return;
+    }
+
+    for (cy = y0 / (int)map->cache->chunk; cy <= y1 / (int)map->cache->chunk; cy++)
+        for (cx = x0 / (int)map->cache->chunk; cx <= x1 / (int)map->cache->chunk; cx++)
+            TilemapChunk(map, layer, cx, cy, scrollx, scrolly);
+}
+
+/**
+ * Bind the tileset, draw a range of layers and restore the GX state.
+ * @param map A GRRLIB_tilemap structure.
+ * @param first First layer to draw.
+ * @param last Last layer to draw.
+ * @param scrollx Map x-coordinate, in pixels, shown at the left of the screen.
+ * @param scrolly Map y-coordinate, in pixels, shown at the top of the screen.
+ * @param color Color in RGBA format.
+ */
+static
+void  TilemapDraw (GRRLIB_tilemap *map, const uint first, const uint last,
+                   const f32 scrollx, const f32 scrolly, const u32 color) {
+    const GRRLIB_texImg  *tex = map->tileset;
+    const u32            col  = GRRLIB_TexColor(tex, color);
+    uint                 layer;
+
+    map->quads = 0;
+    map->draws = 0;
+    map->lists = 0;
+    if (tex->data == NULL)  return;
+
+    GRRLIB_BindTex(tex, tex->tilew * tex->nbtilew, tex->tileh * tex->nbtileh);
+
+    GRRLIB_SetColorIndex(col);
+    GX_LoadPosMtxImm(GXmodelView2D, GX_PNMTX0);
+
+    for (layer = first; layer <= last; layer++)
+        TilemapLayer(map, layer, scrollx, scrolly);
+
+    // Chunks moved the matrix
+    if (map->cache != NULL) {
+        ChunkEvict(map->cache);
+        GX_LoadPosMtxImm(GXmodelView2D, GX_PNMTX0);
+    }
+
+    GX_SetTevOp  (GX_TEVSTAGE0, GX_PASSCLR);
+    GX_SetVtxDesc(GX_VA_TEX0,   GX_NONE);
+    GX_SetVtxDesc(GX_VA_CLR0,   GX_DIRECT);
+}
+
+/**
+ * Draw one layer of a tilemap.
+ * Only the cells on screen are sent, as a single stream of quads.
+ * The flip of the tileset is ignored, use the flip bits of the tile ids.
+ * The number of quads and GX_Begin calls is left in map->quads and
+ * map->draws, the number of cached chunks replayed in map->lists.
+ * @param map A GRRLIB_tilemap structure.
+ * @param layer The layer to draw.
+ * @param scrollx Map x-coordinate, in pixels, shown at the left of the screen.
+ * @param scrolly Map y-coordinate, in pixels, shown at the top of the screen.
+ * @param color Color in RGBA format.
+ */
+void  GRRLIB_DrawTilemapLayer (GRRLIB_tilemap *map, const uint layer,
+                               const f32 scrollx, const f32 scrolly,
+                               const u32 color) {
+    if (map == NULL || layer >= map->layers)  return;
+
+    TilemapDraw(map, layer, layer, scrollx, scrolly, color);
+}
+
+/**
+ * Draw every layer of a tilemap, the first layer at the back.
+ * @param map A GRRLIB_tilemap structure.
+ * @param scrollx Map x-coordinate, in pixels, shown at the left of the screen.
+ * @param scrolly Map y-coordinate, in pixels, shown at the top of the screen.
+ * @param color Color in RGBA format.
+ */
+void  GRRLIB_DrawTilemap (GRRLIB_tilemap *map,
+                          const f32 scrollx, const f32 scrolly,
+                          const u32 color) {
+    if (map == NULL)  return;
+
+    TilemapDraw(map, 0, map->layers - 1, scrollx, scrolly, color);
+}
@@ -22,15 +22,477 @@ THE SOFTWARE.
 
 #include "grrlib/GRRLIB_private.h"
 #include <grrlib.h>
+#include <malloc.h>
 #include <wchar.h>
 #include <ft2build.h>
 #include FT_FREETYPE_H
+#include FT_CACHE_H
+
+#define ATLAS_W        512      /**< Width of the glyph atlas.                  */
+#define ATLAS_H        256      /**< Height of the glyph atlas.                 */
+#define ATLAS_PAD      1        /**< Empty texels around a glyph, so filtering does not bleed. */
+#define ATLAS_SHELVES  64       /**< Most shelves (rows of glyphs) in the atlas. */
+#define GLYPH_SLOTS    1024     /**< Most glyphs in the cache.                  */
+#define GLYPH_HASH     256      /**< Buckets of the glyph lookup table.         */
+#define GLYPH_NONE     0xFFFF   /**< End of a list of glyphs.                   */
+#define TEXT_QUADS     64       /**< Glyphs drawn by a single GX_Begin.         */
+#define ADVANCE_SLOTS  1024     /**< Cached glyph advances.                     */
+#define KERNING_SLOTS  512      /**< Cached kerning pairs.                      */
+#define FTC_FACES      8        /**< Faces kept open by the cache manager.      */
+#define FTC_SIZES      32       /**< Font sizes kept by the cache manager.      */
+#define ADVANCE_NONE   (-0x7FFFFFFF)    /**< Advance of a glyph that can not be loaded. */
+
+/**
+ * A glyph of the cache, rendered in the atlas.
+ */
+typedef struct {
+    FT_Face  face;      /**< Face of the glyph, NULL if the slot is free. */
+    FT_UInt  index;     /**< Glyph index in the face.                     */
+    u16      size;      /**< Size in pixels.                              */
+    u16      next;      /**< Next glyph in the bucket or the free list.   */
+    u16      x, y;      /**< Position in the atlas.                       */
+    u8       w, h;      /**< Size of the bitmap, 0 when there is none.    */
+    u8       shelf;     /**< Shelf holding the bitmap.                    */
+    s16      left;      /**< Offset of the bitmap from the pen.           */
+    s16      top;       /**< Offset of the bitmap from the baseline.      */
+    s32      advance;   /**< Horizontal advance in pixels.                */
+} Glyph;
+
+/**
+ * A row of the atlas, holding glyphs of about the same height.
+ */
+typedef struct {
+    u16  y, h;          /**< Position and height of the row.  */
+    u16  x;             /**< Start of the free part.          */
+    u32  used;          /**< Last frame a glyph of it was drawn in. */
+} Shelf;
+
+/**
+ * A glyph to draw, in screen coordinates.
+ */
+typedef struct {
+    f32  x, y;          /**< Top left corner. */
+    const Glyph  *g;    /**< The glyph.       */
+} TextQuad;
+
+/**
+ * The advance of a glyph at a size.
+ */
+typedef struct {
+    const GRRLIB_ttfFont  *font;    /**< Font of the glyph, NULL if the slot is free. */
+    FT_UInt  index;     /**< Glyph index.               */
+    u16      size;      /**< Size in pixels.            */
+    s32      advance;   /**< Horizontal advance in pixels, or ADVANCE_NONE. */
+} Advance;
+
+/**
+ * The kerning of a pair of glyphs at a size.
+ */
+typedef struct {
+    const GRRLIB_ttfFont  *font;    /**< Font of the pair, NULL if the slot is free. */
+    FT_UInt  left;      /**< Glyph index on the left.   */
+    FT_UInt  right;     /**< Glyph index on the right.  */
+    u16      size;      /**< Size in pixels.            */
+    s32      kerning;   /**< Horizontal kerning in pixels. */
+} Kerning;
 
 static FT_Library ftLibrary;        /**< A handle to a FreeType library instance. */
+static FTC_Manager    ftcManager;   /**< Faces and sizes used for metrics.      */
+static FTC_CMapCache  ftcCMap;      /**< Character code to glyph index cache.   */
+static Advance        advances[ADVANCE_SLOTS];
+static Kerning        kernings[KERNING_SLOTS];
+
+static GRRLIB_texImg  atlas;        /**< IA8 texture holding the cached glyphs. */
+static bool           atlasDirty;   /**< Glyphs were added since the last draw. */
+static Shelf          shelves[ATLAS_SHELVES];
+static uint           shelfCount;
+static Glyph          glyphs[GLYPH_SLOTS];
+static u16            glyphHash[GLYPH_HASH];
+static u16            glyphFree;
 
 // Static function prototypes
 static void DrawBitmap(FT_Bitmap *bitmap, int offset, int top, const u8 cR, const u8 cG, const u8 cB);
 
+/**
+ * Open a face for the FreeType cache manager, which owns it.
+ * @param face_id The GRRLIB_ttfFont of the face.
+ * @param library The FreeType library.
+ * @param req_data Unused.
+ * @param aface Receives the face.
+ * @return A FreeType error code.
+ */
+static
+FT_Error  FaceRequester (FTC_FaceID face_id, FT_Library library,
+                         FT_Pointer req_data, FT_Face *aface) {
+    const GRRLIB_ttfFont  *font = face_id;
+
+    return FT_New_Memory_Face(library, font->file_base, font->file_size, 0, aface);
+}
+
+/**
+ * Hash the key of a cached metric.
+ * @param font The font.
+ * @param size Size in pixels.
+ * @param a First glyph index.
+ * @param b Second glyph index, 0 if there is none.
+ * @return The hash.
+ */
+static inline
+u32  MetricHash (const GRRLIB_ttfFont *font, const uint size, const FT_UInt a, const FT_UInt b) {
+    return ((u32)((size_t)font >> 4) * 40503u) ^ (a * 2654435761u) ^ (b * 2246822519u) ^ size;
+}
+
+/**
+ * Get the face of a font set to a size, from the cache manager.
+ * Like FT_Set_Pixel_Sizes in the draw functions, sizes that fail become 12.
+ * @param font The font.
+ * @param size Size in pixels.
+ * @return The face, or NULL.
+ */
+static
+FT_Face  SizedFace (const GRRLIB_ttfFont *font, const uint size) {
+    FTC_ScalerRec  scaler = { (FTC_FaceID)font, 0, size, 1, 0, 0 };
+    FT_Size        ftSize;
+
+    if (FTC_Manager_LookupSize(ftcManager, &scaler, &ftSize)) {
+        scaler.height = 12;
+        if (FTC_Manager_LookupSize(ftcManager, &scaler, &ftSize))  return NULL;
+    }
+    return ftSize->face;
+}
+
+/**
+ * Get the glyph index of a character.
+ * @param font The font.
+ * @param code The character code.
+ * @return The glyph index, 0 if the font has no glyph for it.
+ */
+static inline
+FT_UInt  CharIndex (const GRRLIB_ttfFont *font, const FT_ULong code) {
+    return FTC_CMapCache_Lookup(ftcCMap, (FTC_FaceID)font, -1, code);
+}
+
+/**
+ * Get the advance of a glyph. The glyph is loaded without rendering on the
+ * first call only.
+ * @param font The font.
+ * @param size Size in pixels.
+ * @param index Glyph index.
+ * @return The advance in pixels, or ADVANCE_NONE if the glyph can not be loaded.
+ */
+static
+s32  GlyphAdvance (const GRRLIB_ttfFont *font, const uint size, const FT_UInt index) {
+    Advance  *e = &advances[MetricHash(font, size, index, 0) & (ADVANCE_SLOTS - 1)];
+    FT_Face  face;
+
+    if (e->font != font || e->index != index || e->size != size) {
+        e->font    = font;
+        e->index   = index;
+        e->size    = size;
+        face       = SizedFace(font, size);
+        e->advance = (face == NULL || FT_Load_Glyph(face, index, FT_LOAD_DEFAULT))
+                   ? ADVANCE_NONE : face->glyph->advance.x >> 6;
+    }
+    return e->advance;
+}
+
+/**
+ * Get the kerning of a pair of glyphs.
+ * @param font The font.
+ * @param size Size in pixels.
+ * @param left Glyph index on the left.
+ * @param right Glyph index on the right.
+ * @return The kerning in pixels.
+ */
+static
+s32  GlyphKerning (const GRRLIB_ttfFont *font, const uint size,
+                   const FT_UInt left, const FT_UInt right) {
+    Kerning    *e = &kernings[MetricHash(font, size, left, right) & (KERNING_SLOTS - 1)];
+    FT_Face    face;
+    FT_Vector  delta;
+
+    if (e->font != font || e->left != left || e->right != right || e->size != size) {
+        e->font    = font;
+        e->left    = left;
+        e->right   = right;
+        e->size    = size;
+        face       = SizedFace(font, size);
+        e->kerning = (face == NULL ||
+                      FT_Get_Kerning(face, left, right, FT_KERNING_DEFAULT, &delta))
+                   ? 0 : delta.x >> 6;
+    }
+    return e->kerning;
+}
+
+/**
+ * Empty the glyph cache.
+ */
+static
+void  AtlasReset (void) {
+    uint  i;
+
+    for (i = 0; i < GLYPH_SLOTS; i++) {
+        glyphs[i].face = NULL;
+        glyphs[i].next = (i + 1 < GLYPH_SLOTS) ? i + 1 : GLYPH_NONE;
+    }
+    for (i = 0; i < GLYPH_HASH; i++)  glyphHash[i] = GLYPH_NONE;
+    glyphFree  = 0;
+    shelfCount = 0;
+}
+
+/**
+ * Get the bucket of a glyph in the lookup table.
+ * @param face The face.
+ * @param size Size in pixels.
+ * @param index Glyph index.
+ * @return The bucket.
+ */
+static inline
+uint  GlyphBucket (const FT_Face face, const uint size, const FT_UInt index) {
+    return (((size_t)face >> 5) ^ (index * 2654435761u) ^ (size * 40503u)) & (GLYPH_HASH - 1);
+}
+
+/**
+ * Remove the glyphs matching a test from the cache.
+ * @param face Remove the glyphs of this face, or NULL.
+ * @param shelf Remove the glyphs of this shelf, or ATLAS_SHELVES.
+ */
+static
+void  GlyphPurge (const FT_Face face, const uint shelf) {
+    u16  *link, i;
+    uint b;
+
+    for (b = 0; b < GLYPH_HASH; b++) {
+        for (link = &glyphHash[b]; (i = *link) != GLYPH_NONE; ) {
+            Glyph  *g = &glyphs[i];
+            if ((face != NULL && g->face == face) ||
+                (shelf < ATLAS_SHELVES && g->w != 0 && g->shelf == shelf)) {
+                *link     = g->next;
+                g->face   = NULL;
+                g->next   = glyphFree;
+                glyphFree = i;
+            }
+            else {
+                link = &g->next;
+            }
+        }
+    }
+}
+
+/**
+ * Make room in the atlas by dropping its least recently drawn shelf.
+ * Only shelves last drawn in a frame the GP has finished can go, so there
+ * is no need to wait for it.
+ * @param h Height needed.
+ * @return The emptied shelf, or -1 if there is none.
+ */
+static
+int  ShelfEvict (const uint h) {
+    const u32  done = GRRLIB_FrameDone();
+    int        i, lru = -1;
+
+    for (i = 0; i < (int)shelfCount; i++) {
+        if (shelves[i].h >= h && (s32)(shelves[i].used - done) <= 0 &&
+            (lru < 0 || (s32)(shelves[i].used - shelves[lru].used) < 0))  lru = i;
+    }
+    if (lru < 0)  return -1;
+
+    GlyphPurge(NULL, lru);
+    shelves[lru].x = 0;
+    return lru;
+}
+
+/**
+ * Find room for a bitmap in the atlas: in the lowest shelf it fits in, else
+ * in a new shelf, else in the least recently drawn shelf.
+ * @param w Width of the bitmap, with padding.
+ * @param h Height of the bitmap, with padding.
+ * @return The shelf, or -1 if the atlas is full of glyphs the GP may still draw.
+ */
+static
+int  ShelfAlloc (const uint w, const uint h) {
+    const uint  rh  = (h + 3) & ~3;     // Similar heights share shelves
+    const uint  top = shelfCount ? shelves[shelfCount-1].y + shelves[shelfCount-1].h : 0;
+    int         i, best = -1;
+
+    for (i = 0; i < (int)shelfCount; i++) {
+        if (shelves[i].h >= h && shelves[i].h <= rh + 4 && shelves[i].x + w <= ATLAS_W &&
+            (best < 0 || shelves[i].h < shelves[best].h))  best = i;
+    }
+    if (best >= 0)  return best;
+
+    if (shelfCount < ATLAS_SHELVES && top + rh <= ATLAS_H) {
+        shelves[shelfCount].y = top;
+        shelves[shelfCount].h = rh;
+        shelves[shelfCount].x = 0;
+        return shelfCount++;
+    }
+    return ShelfEvict(h);
+}
+
+/**
+ * Copy the bitmap of the current glyph of a face into the atlas.
+ * The texels are white, with the coverage as alpha.
+ * @param bitmap The bitmap.
+ * @param x Position in the atlas.
+ * @param y Position in the atlas.
+ * @param w Size of the area to fill, with padding.
+ * @param h Size of the area to fill, with padding.
+ */
+static
+void  AtlasWrite (const FT_Bitmap *bitmap, const uint x, const uint y,
+                  const uint w, const uint h) {
+    u8    *data = atlas.data;
+    uint  i, j, by;
+
+    for (j = 0; j < h; j++) {
+        for (i = 0; i < w; i++) {
+            const uint  tx  = x + i, ty = y + j;
+            u8          *t  = data + ((((ty >> 2) * (ATLAS_W >> 2) + (tx >> 2)) << 5) |
+                                     (((ty & 3) << 3) | ((tx & 3) << 1)));
+            t[0] = (i < bitmap->width && j < bitmap->rows)
+                 ? bitmap->buffer[j * bitmap->pitch + i] : 0;
+            t[1] = 0xFF;
+        }
+    }
+
+    // Write the block rows down to main memory
+    for (by = y >> 2; by < (y + h + 3) >> 2; by++) {
+        DCFlushRange(data + ((by * (ATLAS_W >> 2) + (x >> 2)) << 5),
+                     (((x + w + 3) >> 2) - (x >> 2)) << 5);
+    }
+    atlasDirty = true;
+}
+
+/**
+ * Get a glyph from the cache, rendering it in the atlas if needed.
+ * The size of the face must already be set.
+ * @param face The face.
+ * @param size Size in pixels.
+ * @param index Glyph index.
+ * @param out Receives the glyph.
+ * @return 0 if the glyph is cached, 1 if it is only rendered in the glyph
+ *         slot of the face (too big or no room left), -1 if it can not be loaded.
+ */
+static
+int  GlyphGet (FT_Face face, const uint size, const FT_UInt index, const Glyph **out) {
+    const uint    b = GlyphBucket(face, size, index);
+    FT_GlyphSlot  slot = face->glyph;
+    Glyph         *g;
+    u16           i;
+    int           shelf = -1;
+
+    if (atlas.data == NULL) {
+        if ( !(atlas.data = memalign(32, ATLAS_W * ATLAS_H * 2)) )
+            return FT_Load_Glyph(face, index, FT_LOAD_RENDER) ? -1 : 1;
+        atlas.w      = ATLAS_W;
+        atlas.h      = ATLAS_H;
+        atlas.format = GRRLIB_TEXFMT_IA8;
+        AtlasReset();
+    }
+
+    for (i = glyphHash[b]; i != GLYPH_NONE; i = glyphs[i].next) {
+        g = &glyphs[i];
+        if (g->face == face && g->index == index && g->size == size) {
+            if (g->w != 0)  shelves[g->shelf].used = GRRLIB_FrameNumber();
+            *out = g;
+            return 0;
+        }
+    }
+
+    if (FT_Load_Glyph(face, index, FT_LOAD_RENDER))  return -1;
+
+    if (glyphFree == GLYPH_NONE) {
+        // Out of slots: drop a shelf to free some
+        if (ShelfEvict(0) < 0 || glyphFree == GLYPH_NONE)  return 1;
+    }
+    if (slot->bitmap.width > 0 && slot->bitmap.rows > 0) {
+        const uint  w = slot->bitmap.width + ATLAS_PAD;
+        const uint  h = slot->bitmap.rows  + ATLAS_PAD;
+
+        if (w > 255 || h > ATLAS_H / 4)  return 1;
+        if ((shelf = ShelfAlloc(w, h)) < 0)  return 1;
+    }
+
+    i         = glyphFree;
+    g         = &glyphs[i];
+    glyphFree = g->next;
+
+    g->face    = face;
+    g->index   = index;
+    g->size    = size;
+    g->left    = slot->bitmap_left;
+    g->top     = slot->bitmap_top;
+    g->advance = slot->advance.x >> 6;
+    g->w       = 0;
+    g->h       = 0;
+    if (shelf >= 0) {
+        g->shelf = shelf;
+        g->x     = shelves[shelf].x;
+        g->y     = shelves[shelf].y;
+        g->w     = slot->bitmap.width;
+        g->h     = slot->bitmap.rows;
+        AtlasWrite(&slot->bitmap, g->x, g->y, g->w + ATLAS_PAD, g->h + ATLAS_PAD);
+        shelves[shelf].x   += g->w + ATLAS_PAD;
+        shelves[shelf].used = GRRLIB_FrameNumber();
+    }
+    g->next      = glyphHash[b];
+    glyphHash[b] = i;
+
+    *out = g;
+    return 0;
+}
+
+/**
+ * Draw glyphs of the atlas as textured quads.
+ * @param quad The glyphs.
+ * @param n Number of glyphs.
+ * @param color Text color in RGBA format.
+ */
+static
+void  TextFlush (const TextQuad *quad, const uint n, const u32 color) {
+    const f32  sw = 1.0f / ATLAS_W, sh = 1.0f / ATLAS_H;
+    bool       compact = GRRLIB_CompactOK();
+    uint       i, k;
+
+    if (n == 0)  return;
+
+    for (i = 0; i < n; i++) {
+        const f32  pos[4] = { quad[i].x, quad[i].y,
+                              quad[i].x + quad[i].g->w, quad[i].y + quad[i].g->h };
+        if (!GRRLIB_FitsS16(pos, 4))  compact = false;
+    }
+
+    if (atlasDirty) {
+        GX_InvalidateTexAll();  // The texture cache may hold the previous glyphs
+        atlasDirty = false;
+    }
+    GRRLIB_BindTex(&atlas, ATLAS_W, ATLAS_H);
+
+    GX_Begin(GX_QUADS, compact ? GRRLIB_VTXFMT_S16 : GX_VTXFMT0, n * 4);
+    for (i = 0; i < n; i++) {
+        const Glyph  *g = quad[i].g;
+        for (k = 0; k < 4; k++) {
+            const u32  dx = (k == 1 || k == 2) ? g->w : 0;
+            const u32  dy = (k >= 2) ? g->h : 0;
+            if (compact) {
+                GX_Position2s16(GRRLIB_PosS16(quad[i].x + dx), GRRLIB_PosS16(quad[i].y + dy));
+                GX_Color1u32   (color);
+                GX_TexCoord2u16(GRRLIB_TexU16((g->x + dx) * sw), GRRLIB_TexU16((g->y + dy) * sh));
+            }
+            else {
+                GX_Position3f32(quad[i].x + dx, quad[i].y + dy, 0);
+                GX_Color1u32   (color);
+                GX_TexCoord2f32((g->x + dx) * sw, (g->y + dy) * sh);
+            }
+        }
+    }
+    GX_End();
+
+    GX_SetTevOp  (GX_TEVSTAGE0, GX_PASSCLR);
+    GX_SetVtxDesc(GX_VA_TEX0,   GX_NONE);
+}
+
 
 /**
  * Initialize FreeType library.
@@ -40,6 +502,20 @@ int GRRLIB_InitTTF () {
     if (FT_Init_FreeType(&ftLibrary)) {
         return -1;
     }
+    // The memos miss on every new font and size, keep enough of them to refill them cheaply
+    if (FTC_Manager_New(ftLibrary, FTC_FACES, FTC_SIZES, 0, FaceRequester, NULL, &ftcManager)) {
+        ftcManager = NULL;
+        FT_Done_FreeType(ftLibrary);
+        ftLibrary = NULL;
+        return -1;
+    }
+    if (FTC_CMapCache_New(ftcManager, &ftcCMap)) {
+        FTC_Manager_Done(ftcManager);
+        ftcManager = NULL;
+        FT_Done_FreeType(ftLibrary);
+        ftLibrary = NULL;
+        return -1;
+    }
     return 0;
 }
 
@@ -47,7 +523,18 @@ int GRRLIB_InitTTF () {
  * Call this when your done with FreeType.
  */
 void GRRLIB_ExitTTF (void) {
-    FT_Done_FreeType(ftLibrary);
+    if (ftcManager != NULL) {
+        FTC_Manager_Done(ftcManager);
+        ftcManager = NULL;
+    }
+    if (ftLibrary != NULL) {
+        FT_Done_FreeType(ftLibrary);
+        ftLibrary = NULL;
+    }
+    if (atlas.data != NULL) {
+        free(atlas.data);
+        atlas.data = NULL;
+    }
 }
 
 /**
@@ -62,6 +549,8 @@ GRRLIB_ttfFont* GRRLIB_LoadTTF (const u8* file_base, s32 file_size) {
     GRRLIB_ttfFont* myFont = (GRRLIB_ttfFont*)malloc(sizeof(GRRLIB_ttfFont));
     FT_New_Memory_Face(ftLibrary, file_base, file_size, 0, &Face);
     myFont->kerning = FT_HAS_KERNING(Face);
+    myFont->file_base = file_base;
+    myFont->file_size = file_size;
 /*
     if (FT_Set_Pixel_Sizes(Face, 0, fontSize)) {
         FT_Set_Pixel_Sizes(Face, 0, 12);
@@ -77,6 +566,15 @@ GRRLIB_ttfFont* GRRLIB_LoadTTF (const u8* file_base, s32 file_size) {
  */
 void  GRRLIB_FreeTTF (GRRLIB_ttfFont *myFont) {
     if(myFont) {
+        uint  i;
+
+        // A new font could get the same address
+        if (atlas.data != NULL)  GlyphPurge(myFont->face, ATLAS_SHELVES);
+        for (i = 0; i < ADVANCE_SLOTS; i++)
+            if (advances[i].font == myFont)  advances[i].font = NULL;
+        for (i = 0; i < KERNING_SLOTS; i++)
+            if (kernings[i].font == myFont)  kernings[i].font = NULL;
+        FTC_Manager_RemoveFaceID(ftcManager, (FTC_FaceID)myFont);
         FT_Done_Face(myFont->face);
         free(myFont);
         myFont = NULL;
@@ -129,32 +627,54 @@ void GRRLIB_PrintfTTFW(int x, int y, GRRLIB_ttfFont *myFont, const wchar_t *utf3
     FT_UInt glyphIndex = 0;
     FT_UInt previousGlyph = 0;
     u8 cR = R(color), cG = G(color), cB = B(color);
+    const Glyph *g;
+    TextQuad quad[TEXT_QUADS];
+    uint n = 0;
 
     if (FT_Set_Pixel_Sizes(Face, 0, fontSize)) {
         FT_Set_Pixel_Sizes(Face, 0, 12);
     }
 
+    GRRLIB_FlushPrimitives();
+
     /* Loop over each character, until the
      * end of the string is reached, or until the pixel width is too wide */
     while(*utf32) {
-        glyphIndex = FT_Get_Char_Index(myFont->face, *utf32++);
+        glyphIndex = CharIndex(myFont, *utf32++);
 
         if (myFont->kerning && previousGlyph && glyphIndex) {
-            FT_Vector delta;
-            FT_Get_Kerning(myFont->face, previousGlyph, glyphIndex, FT_KERNING_DEFAULT, &delta);
-            penX += delta.x >> 6;
-        }
-        if (FT_Load_Glyph(myFont->face, glyphIndex, FT_LOAD_RENDER)) {
-            continue;
+            penX += GlyphKerning(myFont, fontSize, previousGlyph, glyphIndex);
         }
 
-        DrawBitmap(&slot->bitmap,
-                   penX + slot->bitmap_left + x,
-                   penY - slot->bitmap_top + y,
-                   cR, cG, cB);
-        penX += slot->advance.x >> 6;
+        switch (GlyphGet(Face, fontSize, glyphIndex, &g)) {
+            case -1:
+                continue;
+            case 1:
+                // Not in the atlas: draw the bitmap of the glyph slot
+                TextFlush(quad, n, color);
+                n = 0;
+                DrawBitmap(&slot->bitmap,
+                           penX + slot->bitmap_left + x,
+                           penY - slot->bitmap_top + y,
+                           cR, cG, cB);
+                penX += slot->advance.x >> 6;
+                break;
+            default:
+                if (g->w != 0) {
+                    quad[n].x = penX + g->left + x;
+                    quad[n].y = penY - g->top + y;
+                    quad[n].g = g;
+                    if (++n == TEXT_QUADS) {
+                        TextFlush(quad, n, color);
+                        n = 0;
+                    }
+                }
+                penX += g->advance;
+                break;
+        }
         previousGlyph = glyphIndex;
     }
+    TextFlush(quad, n, color);
 }
 
 /**
@@ -170,15 +690,33 @@ static void DrawBitmap(FT_Bitmap *bitmap, int offset, int top, const u8 cR, cons
     FT_Int i, j, p, q;
     FT_Int x_max = offset + bitmap->width;
     FT_Int y_max = top + bitmap->rows;
+    bool compact = GRRLIB_CompactOK() &&
+                   offset >= GRRLIB_POS_MIN && x_max <= GRRLIB_POS_MAX &&
+                   top    >= GRRLIB_POS_MIN && y_max <= GRRLIB_POS_MAX;
+
+    if (bitmap->rows == 0) {
+        return;
+    }
 
+    // One batch of points per column of the glyph
     for ( i = offset, p = 0; i < x_max; i++, p++ ) {
-        for ( j = top, q = 0; j < y_max; j++, q++ ) {
-            GX_Begin(GX_POINTS, GX_VTXFMT0, 1);
+        if (compact) {
+            GX_Begin(GX_POINTS, GRRLIB_VTXFMT_S16, bitmap->rows);
+            for ( j = top, q = 0; j < y_max; j++, q++ ) {
+                GX_Position2s16(i * (1 << GRRLIB_POS_FRAC), j * (1 << GRRLIB_POS_FRAC));
+                GX_Color4u8(cR, cG, cB,
+                            bitmap->buffer[ q * bitmap->width + p ]);
+            }
+        }
+        else {
+            GX_Begin(GX_POINTS, GX_VTXFMT0, bitmap->rows);
+            for ( j = top, q = 0; j < y_max; j++, q++ ) {
                 GX_Position3f32(i, j, 0);
                 GX_Color4u8(cR, cG, cB,
                             bitmap->buffer[ q * bitmap->width + p ]);
-            GX_End();
+            }
         }
+        GX_End();
     }
 }
 
@@ -218,28 +756,23 @@ unsigned int GRRLIB_WidthTTFW(GRRLIB_ttfFont *myFont, const wchar_t *utf32, unsi
         return 0;
     }
 
-    FT_Face Face = (FT_Face)myFont->face;
     unsigned int penX = 0;
     FT_UInt glyphIndex;
     FT_UInt previousGlyph = 0;
+    s32 advance;
 
-    if(FT_Set_Pixel_Sizes(myFont->face, 0, fontSize)) {
-         FT_Set_Pixel_Sizes(myFont->face, 0, 12);
-    }
-
+    // Only cached metrics: nothing is rendered
     while(*utf32) {
-        glyphIndex = FT_Get_Char_Index(myFont->face, *utf32++);
+        glyphIndex = CharIndex(myFont, *utf32++);
 
         if(myFont->kerning && previousGlyph && glyphIndex) {
-            FT_Vector delta;
-            FT_Get_Kerning(Face, previousGlyph, glyphIndex, FT_KERNING_DEFAULT, &delta);
-            penX += delta.x >> 6;
+            penX += GlyphKerning(myFont, fontSize, previousGlyph, glyphIndex);
         }
-        if(FT_Load_Glyph(Face, glyphIndex, FT_LOAD_RENDER)) {
+        if((advance = GlyphAdvance(myFont, fontSize, glyphIndex)) == ADVANCE_NONE) {
             continue;
         }
 
-        penX += Face->glyph->advance.x >> 6;
+        penX += advance;
         previousGlyph = glyphIndex;
     }
 
@@ -89,12 +89,71 @@ typedef  enum GRRLIB_blendMode {
     GRRLIB_BLEND_SCREEN = 2,    /**< Alpha Light Blending. */
     GRRLIB_BLEND_MULTI  = 3,    /**< Multiply Blending. */
     GRRLIB_BLEND_INV    = 4,    /**< Invert Color Blending. */
+    GRRLIB_BLEND_PREMULT = 5,   /**< Premultiplied Alpha Blending. */
 } GRRLIB_blendMode;
 
 #define GRRLIB_BLEND_NONE   (GRRLIB_BLEND_ALPHA)    /**< Alias for GRRLIB_BLEND_ALPHA. */
 #define GRRLIB_BLEND_LIGHT  (GRRLIB_BLEND_ADD)      /**< Alias for GRRLIB_BLEND_ADD. */
 #define GRRLIB_BLEND_SHADE  (GRRLIB_BLEND_MULTI)    /**< Alias for GRRLIB_BLEND_MULTI. */
 
+//------------------------------------------------------------------------------
+/**
+ * How texture effects sample pixels lying outside of the texture.
+ */
+typedef  enum GRRLIB_edgeMode {
+    GRRLIB_EDGE_CLAMP = 0,      /**< Repeat the nearest edge pixel. */
+    GRRLIB_EDGE_WRAP  = 1,      /**< Wrap around to the opposite edge. */
+    GRRLIB_EDGE_ZERO  = 2,      /**< Use transparent black. */
+} GRRLIB_edgeMode;
+
+//------------------------------------------------------------------------------
+/**
+ * GRRLIB texture mirroring, applied when the texture is drawn.
+ */
+typedef  enum GRRLIB_flipMode {
+    GRRLIB_FLIP_NONE = 0,       /**< Draw the texture as is. */
+    GRRLIB_FLIP_H    = 1,       /**< Mirror the texture horizontally. */
+    GRRLIB_FLIP_V    = 2,       /**< Mirror the texture vertically. */
+    GRRLIB_FLIP_HV   = 3,       /**< Mirror the texture both ways (same as a 180 degree rotation). */
+} GRRLIB_flipMode;
+
+//------------------------------------------------------------------------------
+/**
+ * GRRLIB texture pixel formats.
+ * Only GRRLIB_TEXFMT_RGBA8 textures can be read or edited by the CPU, the
+ * other ones are for render targets and glyph atlases.
+ */
+typedef  enum GRRLIB_texFormat {
+    GRRLIB_TEXFMT_RGBA8  = 0,   /**< 32 bits, 8 bits per component. */
+    GRRLIB_TEXFMT_RGB565 = 1,   /**< 16 bits, no alpha. */
+    GRRLIB_TEXFMT_RGB5A3 = 2,   /**< 16 bits, 3 bits of alpha or none. */
+    GRRLIB_TEXFMT_I8     = 3,   /**< 8 bits of intensity (grey). */
+    GRRLIB_TEXFMT_IA8    = 4,   /**< 8 bits of intensity and 8 bits of alpha. */
+} GRRLIB_texFormat;
+
+//------------------------------------------------------------------------------
+/**
+ * GRRLIB texture resampling filters.
+ */
+typedef  enum GRRLIB_filterMode {
+    GRRLIB_FILTER_NEAREST  = 0, /**< Nearest neighbour, blocky but fast. */
+    GRRLIB_FILTER_BILINEAR = 1, /**< Bilinear (area averaging when shrinking). */
+    GRRLIB_FILTER_LANCZOS  = 2, /**< Lanczos-3, sharpest result. */
+} GRRLIB_filterMode;
+
+#define GRRLIB_KERNEL_MAX   (7)     /**< Largest kernel size accepted by GRRLIB_BMFX_Convolve. */
+
+//------------------------------------------------------------------------------
+/**
+ * Structure to hold a rectangle, in pixels.
+ */
+typedef  struct GRRLIB_rect {
+    int    x;           /**< Left edge.   */
+    int    y;           /**< Top edge.    */
+    uint   w;           /**< Width.       */
+    uint   h;           /**< Height.      */
+} GRRLIB_rect;
+
 //------------------------------------------------------------------------------
 /**
  * Structure to hold the current drawing settings.
@@ -103,8 +162,41 @@ typedef  struct GRRLIB_drawSettings {
     bool              antialias;    /**< AntiAlias is enabled when set to true. */
     GRRLIB_blendMode  blend;        /**< Blending Mode.                         */
     int               lights;       /**< Active lights.                         */
+    bool              premultiply;  /**< Loaded textures are premultiplied.     */
+    bool              premultColor; /**< Draw colours are premultiplied.        */
+    GRRLIB_rect       clip;         /**< Current clipping rectangle.            */
+    bool              dirtyMode;    /**< Only the dirty area is redrawn.        */
+    GRRLIB_rect       dirty;        /**< Dirty area of the frame being drawn.   */
 } GRRLIB_drawSettings;
 
+//------------------------------------------------------------------------------
+/**
+ * Structure to hold the counters of a frame.
+ */
+typedef  struct GRRLIB_drawStats {
+    uint   drawn;       /**< Sprites sent to GX.                        */
+    uint   culled;      /**< Sprites dropped outside the clipping area. */
+    u32    stall;       /**< Time GRRLIB_Render waited, in microseconds. */
+    u32    latency;     /**< Time to reach the screen, in microseconds.  */
+    u32    fifoPeak;    /**< Most bytes waiting in the command FIFO.     */
+    u32    fifoStalls;  /**< Times the CPU had to wait for FIFO space.   */
+} GRRLIB_drawStats;
+
+//------------------------------------------------------------------------------
+/**
+ * Structure to hold the options of GRRLIB_InitEx.
+ * Fields left to 0 get the default value.
+ * With a double FIFO the GP only gets the commands when half of the FIFO is
+ * used, which GRRLIB checks between its own primitives. Code drawing with GX
+ * directly must keep each GX_Begin under half of fifoSize and call
+ * GRRLIB_FifoSample after each GX_End.
+ */
+typedef  struct GRRLIB_initOptions {
+    u32    fifoSize;    /**< Size of a command FIFO in bytes (Default: 256 KiB). */
+    u8     fifoCount;   /**< 2 for a double FIFO, else 1 (Default: 1).           */
+    bool   pipelined;   /**< Start with pipelined frames (Default: false).       */
+} GRRLIB_initOptions;
+
 //------------------------------------------------------------------------------
 /**
  * Structure to hold the texture information.
@@ -126,9 +218,67 @@ typedef  struct GRRLIB_texImg {
     f32    ofnormaltexx;/**< Offset of normalized texture on x. */
     f32    ofnormaltexy;/**< Offset of normalized texture on y. */
 
+    GRRLIB_flipMode flip;/**< Mirroring applied when drawing. */
+    bool   premult;     /**< Colours are premultiplied by alpha. */
+    GRRLIB_texFormat format;/**< Pixel format of the data. */
+
     void  *data;        /**< Pointer to the texture data. */
 } GRRLIB_texImg;
 
+//------------------------------------------------------------------------------
+/**
+ * Structure to hold a render target: a texture the EFB is copied into.
+ */
+typedef  struct GRRLIB_renderTarget {
+    GRRLIB_texImg  tex; /**< The texture holding the copy, to draw it.  */
+    uint   srcw;        /**< Width of the copied part of the EFB.       */
+    uint   srch;        /**< Height of the copied part of the EFB.      */
+    bool   half;        /**< The copy is scaled down to half the size.  */
+} GRRLIB_renderTarget;
+
+//------------------------------------------------------------------------------
+/**
+ * GRRLIB post-processing operations.
+ */
+typedef  enum GRRLIB_postOp {
+    GRRLIB_POST_COPY   = 0, /**< Copy an area of the EFB into a target. */
+    GRRLIB_POST_DRAW   = 1, /**< Draw a target, tinted and blended. */
+    GRRLIB_POST_BRIGHT = 2, /**< Draw what is brighter than a threshold in a target. */
+    GRRLIB_POST_BLUR   = 3, /**< Draw the average of 4 filtered taps of a target. */
+    GRRLIB_POST_GRADE  = 4, /**< Draw a target with a colour grade. */
+} GRRLIB_postOp;
+
+#define GRRLIB_POST_TARGETS  4  /**< Most targets used by a post-processing chain. */
+
+//------------------------------------------------------------------------------
+/**
+ * Structure to describe one pass of a post-processing chain.
+ * Every pass works on the top left area of the EFB whose size is the
+ * screen size divided by scale. Draw passes stretch the target over it.
+ */
+typedef  struct GRRLIB_postPass {
+    GRRLIB_postOp     op;       /**< What the pass does. */
+    u8                target;   /**< Target written by COPY, read by the others. */
+    u8                target2;  /**< GRADE: I8 copy of the target, for saturation. */
+    u8                scale;    /**< 1 for the full screen, 2 for half of it... */
+    bool              half;     /**< COPY: halve the area with the copy filter. */
+    GRRLIB_texFormat  format;   /**< COPY: pixel format of the target. */
+    GRRLIB_blendMode  blend;    /**< DRAW: blending mode. */
+    u32               color;    /**< DRAW tint, BRIGHT threshold, GRADE gain. */
+    u32               color2;   /**< GRADE lift. */
+    f32               param;    /**< BLUR tap distance in texels, GRADE saturation. */
+} GRRLIB_postPass;
+
+//------------------------------------------------------------------------------
+/**
+ * Structure to hold a post-processing chain and its render targets.
+ */
+typedef  struct GRRLIB_postChain {
+    GRRLIB_postPass      *pass;     /**< The passes, run in order. */
+    uint                 count;     /**< Number of passes. */
+    GRRLIB_renderTarget  *target[GRRLIB_POST_TARGETS];  /**< Targets of the passes. */
+} GRRLIB_postChain;
+
 //------------------------------------------------------------------------------
 /**
  * Structure to hold the bytemap character information.
@@ -163,8 +313,125 @@ typedef  struct GRRLIB_bytemapFont {
 typedef  struct GRRLIB_Font {
     void *face;     /**< A TTF face object. */
     bool kerning;   /**< true whenever a face object contains kerning data that can be accessed with FT_Get_Kerning. */
+    const u8 *file_base;    /**< Buffer with the TTF data, for the FreeType cache. */
+    s32  file_size;         /**< Size of the TTF buffer. */
 } GRRLIB_ttfFont;
 
+//------------------------------------------------------------------------------
+/**
+ * Structure describing one sprite of a GRRLIB_DrawImgBatch call.
+ * The part of the texture drawn is, in order of preference, the sub-rectangle
+ * if partw and parth are set, the tile frame if the texture is a tileset and
+ * frame is not negative, or else the whole texture.
+ */
+typedef  struct GRRLIB_sprite {
+    f32    x;           /**< Specifies the x-coordinate of the upper-left corner. */
+    f32    y;           /**< Specifies the y-coordinate of the upper-left corner. */
+    f32    degrees;     /**< Angle of rotation.           */
+    f32    scaleX;      /**< Specifies the x-coordinate scale. */
+    f32    scaleY;      /**< Specifies the y-coordinate scale. */
+    u32    color;       /**< Color in RGBA format.        */
+    s16    frame;       /**< Tile to draw, -1 for none.   */
+    u16    partx;       /**< Left of the sub-rectangle.   */
+    u16    party;       /**< Top of the sub-rectangle.    */
+    u16    partw;       /**< Width of the sub-rectangle, 0 for none.  */
+    u16    parth;       /**< Height of the sub-rectangle, 0 for none. */
+} GRRLIB_sprite;
+
+//------------------------------------------------------------------------------
+/**
+ * Structure describing a particle to emit.
+ * The alpha of the colours is ignored, unless the texture is premultiplied
+ * and GRRLIB_SetPremultColor is enabled: an alpha of 255 then blends the
+ * particle over the background, and an alpha of 0 adds it.
+ */
+typedef  struct GRRLIB_particle {
+    f32    x;           /**< Horizontal position of the centre.       */
+    f32    y;           /**< Vertical position of the centre.         */
+    f32    vx;          /**< Horizontal speed, in pixels per update.  */
+    f32    vy;          /**< Vertical speed, in pixels per update.    */
+    f32    rot;         /**< Angle of rotation, in degrees.           */
+    f32    vrot;        /**< Rotation speed, in degrees per update.   */
+    f32    scale;       /**< Scale of the texture.                    */
+    f32    growth;      /**< Scale multiplier applied each update.    */
+    f32    alpha;       /**< Opacity, from 0 to 1.                    */
+    f32    fade;        /**< Opacity multiplier applied each update.  */
+    f32    life;        /**< Updates left before the particle dies.   */
+    u32    color;       /**< Color in RGBA format.                    */
+    u32    colorEnd;    /**< Color to turn into, in the same format.  */
+    f32    colorRate;   /**< Progress to colorEnd per update, from 0 to 1. */
+} GRRLIB_particle;
+
+/**
+ * Structure to hold a pool of particles sharing a texture.
+ * Each property is stored in its own array, indexed by particle.
+ */
+typedef  struct GRRLIB_emitter {
+    GRRLIB_texImg  *tex;        /**< Texture of the particles.          */
+    uint   count;               /**< Number of live particles.          */
+    uint   capacity;            /**< Maximum number of particles.       */
+    f32    ax;                  /**< Horizontal acceleration (gravity, wind...). */
+    f32    ay;                  /**< Vertical acceleration.             */
+    f32    drag;                /**< Speed multiplier applied each update. */
+
+    f32    *x;                  /**< Horizontal positions. */
+    f32    *y;                  /**< Vertical positions.   */
+    f32    *vx;                 /**< Horizontal speeds.    */
+    f32    *vy;                 /**< Vertical speeds.      */
+    f32    *rot;                /**< Angles.               */
+    f32    *vrot;               /**< Rotation speeds.      */
+    f32    *scale;              /**< Scales.               */
+    f32    *growth;             /**< Scale multipliers.    */
+    f32    *alpha;              /**< Opacities.            */
+    f32    *fade;               /**< Opacity multipliers.  */
+    f32    *life;               /**< Updates left.         */
+    f32    *blend;              /**< Color progress, 0 to 1. */
+    f32    *blendRate;          /**< Color progress per update. */
+    u32    *color;              /**< Start colors.         */
+    u32    *colorEnd;           /**< End colors.           */
+} GRRLIB_emitter;
+
+//------------------------------------------------------------------------------
+#define GRRLIB_TILE_FLIPH   (0x8000)    /**< Tile id bit: mirror the tile horizontally. */
+#define GRRLIB_TILE_FLIPV   (0x4000)    /**< Tile id bit: mirror the tile vertically.   */
+#define GRRLIB_TILE_ID      (0x3FFF)    /**< Mask of the tile number in a tile id.      */
+#define GRRLIB_TILE_EMPTY   (0xFFFF)    /**< Tile id of an empty cell, reserves tile 0x3FFF. */
+
+/**
+ * Structure to hold a tilemap.
+ */
+typedef  struct GRRLIB_tilemap {
+    GRRLIB_texImg  *tileset;    /**< Tileset, set up with GRRLIB_InitTileSet. */
+    uint   w;                   /**< Width of the map in tiles.         */
+    uint   h;                   /**< Height of the map in tiles.        */
+    uint   layers;              /**< Number of layers.                  */
+    uint   tilew;               /**< Width of a tile in pixels.         */
+    uint   tileh;               /**< Height of a tile in pixels.        */
+    uint   nbtiles;             /**< Number of tiles in the tileset.    */
+    u16    *tiles;              /**< Tile ids, layer by layer, row by row. */
+    f32    *uv;                 /**< Texture coordinates s1,t1,s2,t2 of each tile. */
+
+    struct GRRLIB_tileCache *cache; /**< Display list cache, NULL if disabled. */
+
+    u32    quads;               /**< Quads sent by the last draw.       */
+    u32    draws;               /**< GX_Begin calls made by the last draw. */
+    u32    lists;               /**< Display lists called by the last draw. */
+} GRRLIB_tilemap;
+
+//------------------------------------------------------------------------------
+/**
+ * Structure to hold a recorded GX display list.
+ */
+typedef  struct GRRLIB_dispList {
+    void  *data;        /**< Command buffer, 32-byte aligned.           */
+    u32   capacity;     /**< Size of the command buffer in bytes.       */
+    u32   size;         /**< Size of the recorded list, 0 if none.      */
+    u32   key;          /**< Value the list was recorded for.           */
+    bool  recording;    /**< A recording is in progress.                */
+    bool  called;       /**< The list was called since the last wait.   */
+    u16   token;        /**< Draw sync token sent after the last call.  */
+} GRRLIB_dispList;
+
 //==============================================================================
 // Allow general access to screen and frame information
 //==============================================================================
@@ -178,9 +445,9 @@ typedef  struct GRRLIB_Font {
 # define GRR_INITS(...)
 #endif
 
-GRR_EXTERN  GXRModeObj  *rmode;
-GRR_EXTERN  void        *xfb[2]  GRR_INITS(NULL, NULL);
-GRR_EXTERN  u32         fb       GRR_INIT(0);
+GRR_EXTERN  GXRModeObj    *rmode;
+GRR_EXTERN  void          *xfb[3]  GRR_INITS(NULL, NULL, NULL);
+GRR_EXTERN  volatile u32  fb       GRR_INIT(0);     // Set by the retrace interrupt when pipelined
 //==============================================================================
 // procedure and function prototypes
 // Inline function handling - http://www.greenend.org.uk/rjk/2003/03/inline.html
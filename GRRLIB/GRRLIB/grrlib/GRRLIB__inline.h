@@ -69,8 +69,6 @@ INLINE  void  GRRLIB_NPlot       (const guVector v[], const u32 color[],
                                   const long n);
 INLINE  void  GRRLIB_NGone       (const guVector v[], const u32 color[],
                                   const long n);
-INLINE  void  GRRLIB_NGoneFilled (const guVector v[], const u32 color[],
-                                  const long n);
 
 //------------------------------------------------------------------------------
 // GRRLIB_fbGX.h -
@@ -100,6 +98,9 @@ INLINE  u32   GRRLIB_GetPixelFromtexImg (const int x, const int y,
 INLINE  void  GRRLIB_SetPixelTotexImg   (const int x, const int y,
                                          GRRLIB_texImg *tex, const u32 color);
 
+INLINE  u32   GRRLIB_Premultiply        (const u32 color);
+INLINE  u32   GRRLIB_Unpremultiply      (const u32 color);
+
 INLINE u32 GRRLIB_GetPixelFromFB (int x, int y);
 INLINE void GRRLIB_SetPixelToFB (int x, int y, u32 pokeColor);
 
@@ -109,13 +110,24 @@ INLINE  void              GRRLIB_SetBlend        (const GRRLIB_blendMode blendmo
 INLINE  GRRLIB_blendMode  GRRLIB_GetBlend        (void);
 INLINE  void              GRRLIB_SetAntiAliasing (const bool aa);
 INLINE  bool              GRRLIB_GetAntiAliasing (void);
+INLINE  void              GRRLIB_SetPremultiply  (const bool premult);
+INLINE  bool              GRRLIB_GetPremultiply  (void);
+INLINE  void              GRRLIB_SetPremultColor (const bool premult);
+INLINE  bool              GRRLIB_GetPremultColor (void);
+INLINE  void              GRRLIB_SetDirtyMode    (const bool enable);
+INLINE  bool              GRRLIB_GetDirtyMode    (void);
+INLINE  void              GRRLIB_MarkDirty       (const int x, const int y,
+                                                  const int width, const int height);
 
 //------------------------------------------------------------------------------
 // GRRLIB_texSetup.h - Create and setup textures
 INLINE  GRRLIB_texImg*  GRRLIB_CreateEmptyTexture (const uint w, const uint h);
 INLINE  void            GRRLIB_ClearTex           (GRRLIB_texImg* tex);
+INLINE  uint            GRRLIB_TexDataSize        (const GRRLIB_texImg *tex);
 INLINE  void            GRRLIB_FlushTex           (GRRLIB_texImg *tex);
+INLINE  void            GRRLIB_FlushTexRect       (GRRLIB_texImg *tex, const GRRLIB_rect *rect);
 INLINE  void            GRRLIB_FreeTexture        (GRRLIB_texImg *tex);
+INLINE  void            GRRLIB_SetFlip            (GRRLIB_texImg *tex, const GRRLIB_flipMode flip);
 
 //==============================================================================
 // Definitions of inlined functions
@@ -58,6 +58,15 @@ void  GRRLIB_BMFX_FlipH     (const GRRLIB_texImg *texsrc,
 void  GRRLIB_BMFX_FlipV     (const GRRLIB_texImg *texsrc,
                              GRRLIB_texImg *texdest);
 
+void  GRRLIB_BMFX_Rotate90  (const GRRLIB_texImg *texsrc,
+                             GRRLIB_texImg *texdest);
+
+void  GRRLIB_BMFX_Rotate180 (const GRRLIB_texImg *texsrc,
+                             GRRLIB_texImg *texdest);
+
+void  GRRLIB_BMFX_Rotate270 (const GRRLIB_texImg *texsrc,
+                             GRRLIB_texImg *texdest);
+
 void  GRRLIB_BMFX_Grayscale (const GRRLIB_texImg *texsrc,
                              GRRLIB_texImg *texdest);
 
@@ -76,16 +85,159 @@ void  GRRLIB_BMFX_Scatter   (const GRRLIB_texImg *texsrc,
 void  GRRLIB_BMFX_Pixelate  (const GRRLIB_texImg *texsrc,
                              GRRLIB_texImg *texdest, const u32 factor);
 
+void  GRRLIB_BMFX_Convolve  (const GRRLIB_texImg *texsrc,
+                             GRRLIB_texImg *texdest,
+                             const s32 *kernel, const u32 size,
+                             const s32 divisor, const s32 bias,
+                             const GRRLIB_edgeMode edgeMode);
+
+void  GRRLIB_BMFX_ColorMatrix (const GRRLIB_texImg *texsrc,
+                               GRRLIB_texImg *texdest, const f32 matrix[20]);
+
+void  GRRLIB_BMFX_LUT         (const GRRLIB_texImg *texsrc,
+                               GRRLIB_texImg *texdest,
+                               const u8 *lutR, const u8 *lutG,
+                               const u8 *lutB, const u8 *lutA);
+
+void  GRRLIB_BMFX_PaletteSwap (const GRRLIB_texImg *texsrc,
+                               GRRLIB_texImg *texdest,
+                               const u32 *from, const u32 *to, const uint n);
+
+void  GRRLIB_BMFX_FlipHRect       (const GRRLIB_texImg *texsrc,
+                                  GRRLIB_texImg *texdest,
+                                  const GRRLIB_rect *rect,
+                                  const int dx, const int dy);
+
+void  GRRLIB_BMFX_FlipVRect       (const GRRLIB_texImg *texsrc,
+                                  GRRLIB_texImg *texdest,
+                                  const GRRLIB_rect *rect,
+                                  const int dx, const int dy);
+
+void  GRRLIB_BMFX_Rotate90Rect    (const GRRLIB_texImg *texsrc,
+                                  GRRLIB_texImg *texdest,
+                                  const GRRLIB_rect *rect,
+                                  const int dx, const int dy);
+
+void  GRRLIB_BMFX_Rotate180Rect   (const GRRLIB_texImg *texsrc,
+                                  GRRLIB_texImg *texdest,
+                                  const GRRLIB_rect *rect,
+                                  const int dx, const int dy);
+
+void  GRRLIB_BMFX_Rotate270Rect   (const GRRLIB_texImg *texsrc,
+                                  GRRLIB_texImg *texdest,
+                                  const GRRLIB_rect *rect,
+                                  const int dx, const int dy);
+
+void  GRRLIB_BMFX_GrayscaleRect   (const GRRLIB_texImg *texsrc,
+                                  GRRLIB_texImg *texdest,
+                                  const GRRLIB_rect *rect,
+                                  const int dx, const int dy);
+
+void  GRRLIB_BMFX_SepiaRect       (const GRRLIB_texImg *texsrc,
+                                  GRRLIB_texImg *texdest,
+                                  const GRRLIB_rect *rect,
+                                  const int dx, const int dy);
+
+void  GRRLIB_BMFX_InvertRect      (const GRRLIB_texImg *texsrc,
+                                  GRRLIB_texImg *texdest,
+                                  const GRRLIB_rect *rect,
+                                  const int dx, const int dy);
+
+void  GRRLIB_BMFX_BlurRect        (const GRRLIB_texImg *texsrc,
+                                  GRRLIB_texImg *texdest,
+                                  const GRRLIB_rect *rect,
+                                  const int dx, const int dy,
+                                  const u32 factor);
+
+void  GRRLIB_BMFX_ScatterRect     (const GRRLIB_texImg *texsrc,
+                                  GRRLIB_texImg *texdest,
+                                  const GRRLIB_rect *rect,
+                                  const int dx, const int dy,
+                                  const u32 factor);
+
+void  GRRLIB_BMFX_PixelateRect    (const GRRLIB_texImg *texsrc,
+                                  GRRLIB_texImg *texdest,
+                                  const GRRLIB_rect *rect,
+                                  const int dx, const int dy,
+                                  const u32 factor);
+
+void  GRRLIB_BMFX_ConvolveRect    (const GRRLIB_texImg *texsrc,
+                                  GRRLIB_texImg *texdest,
+                                  const GRRLIB_rect *rect,
+                                  const int dx, const int dy,
+                                  const s32 *kernel, const u32 size,
+                                  const s32 divisor, const s32 bias,
+                                  const GRRLIB_edgeMode edgeMode);
+
+void  GRRLIB_BMFX_ColorMatrixRect (const GRRLIB_texImg *texsrc,
+                                  GRRLIB_texImg *texdest,
+                                  const GRRLIB_rect *rect,
+                                  const int dx, const int dy,
+                                  const f32 matrix[20]);
+
+void  GRRLIB_BMFX_LUTRect         (const GRRLIB_texImg *texsrc,
+                                  GRRLIB_texImg *texdest,
+                                  const GRRLIB_rect *rect,
+                                  const int dx, const int dy,
+                                  const u8 *lutR, const u8 *lutG,
+                                  const u8 *lutB, const u8 *lutA);
+
+void  GRRLIB_BMFX_PaletteSwapRect (const GRRLIB_texImg *texsrc,
+                                  GRRLIB_texImg *texdest,
+                                  const GRRLIB_rect *rect,
+                                  const int dx, const int dy,
+                                  const u32 *from, const u32 *to,
+                                  const uint n);
+
+void  GRRLIB_BMFX_LUTGamma     (u8 lut[256], const f32 gamma);
+void  GRRLIB_BMFX_LUTLevels    (u8 lut[256], const u8 inBlack, const u8 inWhite,
+                                const f32 gamma,
+                                const u8 outBlack, const u8 outWhite);
+void  GRRLIB_BMFX_LUTPosterize (u8 lut[256], const u8 levels);
+
 //------------------------------------------------------------------------------
 // GRRLIB_core.c - GRRLIB core functions
-int   GRRLIB_Init (void);
+int   GRRLIB_Init   (void);
+int   GRRLIB_InitEx (const GRRLIB_initOptions *opt);
 void  GRRLIB_Exit (void);
+void  GRRLIB_FifoSample (void);
+
+//------------------------------------------------------------------------------
+// GRRLIB_dispList.c - Display list recording and replay
+GRRLIB_dispList*  GRRLIB_DisplayListCreate     (const u32 size);
+void              GRRLIB_DisplayListFree       (GRRLIB_dispList *dl);
+bool              GRRLIB_DisplayListBegin      (GRRLIB_dispList *dl,
+                                                const u32 key);
+u32               GRRLIB_DisplayListEnd        (GRRLIB_dispList *dl);
+void              GRRLIB_DisplayListCall       (GRRLIB_dispList *dl);
+void              GRRLIB_DisplayListInvalidate (GRRLIB_dispList *dl);
 
 //------------------------------------------------------------------------------
 // GRRLIB_fbAdvanced.c - Render to framebuffer: Advanced primitives
 void  GRRLIB_Circle (const f32 x,  const f32 y,  const f32 radius,
                      const u32 color, const u8 filled);
 
+void  GRRLIB_Arc (const f32 x, const f32 y, const f32 radius,
+                  const f32 start, const f32 end,
+                  const u32 color, const u8 filled);
+
+void  GRRLIB_RoundedRectangle (const f32 x, const f32 y,
+                               const f32 width, const f32 height,
+                               const f32 radius,
+                               const u32 color, const u8 filled);
+
+void  GRRLIB_ThickLine (const f32 x1, const f32 y1,
+                        const f32 x2, const f32 y2,
+                        const f32 width, const u32 color);
+
+void  GRRLIB_NGoneFilled (const guVector v[], const u32 color[], const long n);
+
+//------------------------------------------------------------------------------
+// GRRLIB_fbBatch.c - Render to framebuffer: Batched primitives
+void  GRRLIB_FlushPrimitives (void);
+bool  GRRLIB_BatchPrim       (const u8 fmt, const guVector v[],
+                              const u32 color[], const long n);
+
 //------------------------------------------------------------------------------
 // GRRLIB_fileIO - File I/O (SD Card)
 int             GRRLIB_LoadFile            (const char* filename,
@@ -93,6 +245,25 @@ int             GRRLIB_LoadFile            (const char* filename,
 GRRLIB_texImg*  GRRLIB_LoadTextureFromFile (const char* filename);
 bool            GRRLIB_ScrShot             (const char* filename);
 
+//------------------------------------------------------------------------------
+// GRRLIB_particle.c - Particle systems
+GRRLIB_emitter*  GRRLIB_CreateEmitter (GRRLIB_texImg *tex, const uint capacity);
+void             GRRLIB_FreeEmitter   (GRRLIB_emitter *em);
+int              GRRLIB_EmitParticle  (GRRLIB_emitter *em,
+                                       const GRRLIB_particle *p);
+void             GRRLIB_UpdateEmitter (GRRLIB_emitter *em);
+void             GRRLIB_DrawEmitter   (GRRLIB_emitter *em);
+
+//------------------------------------------------------------------------------
+// GRRLIB_post.c - Post-processing chains
+GRRLIB_postChain*  GRRLIB_CreatePostChain (const GRRLIB_postPass *pass, const uint count);
+GRRLIB_postChain*  GRRLIB_CreatePostBloom (const u32 threshold, const u32 tint);
+GRRLIB_postChain*  GRRLIB_CreatePostBlur  (const uint levels);
+GRRLIB_postChain*  GRRLIB_CreatePostGrade (const u32 gain, const u32 lift,
+                                           const f32 saturation);
+void               GRRLIB_ApplyPostChain  (const GRRLIB_postChain *chain);
+void               GRRLIB_FreePostChain   (GRRLIB_postChain *chain);
+
 //------------------------------------------------------------------------------
 // GRRLIB_print.c - Will someone please tell me what these are :)
 void  GRRLIB_Printf   (const f32 xpos, const f32 ypos,
@@ -103,6 +274,25 @@ void  GRRLIB_PrintBMF (const f32 xpos, const f32 ypos,
                        const GRRLIB_bytemapFont *bmf,
                        const char *text, ...);
 
+//------------------------------------------------------------------------------
+// GRRLIB_queue.c - Deferred sprite queue
+void  GRRLIB_QueueImg   (const u8 layer, const f32 xpos, const f32 ypos,
+                         const GRRLIB_texImg *tex, const f32 degrees,
+                         const f32 scaleX, const f32 scaleY, const u32 color);
+
+void  GRRLIB_QueueTile  (const u8 layer, const f32 xpos, const f32 ypos,
+                         const GRRLIB_texImg *tex, const f32 degrees,
+                         const f32 scaleX, const f32 scaleY, const u32 color,
+                         const int frame);
+
+void  GRRLIB_QueuePart  (const u8 layer, const f32 xpos, const f32 ypos,
+                         const f32 partx, const f32 party,
+                         const f32 partw, const f32 parth,
+                         const GRRLIB_texImg *tex, const f32 degrees,
+                         const f32 scaleX, const f32 scaleY, const u32 color);
+
+void  GRRLIB_QueueFlush (void);
+
 //------------------------------------------------------------------------------
 // GRRLIB_render.c - Rendering functions
 void  GRRLIB_DrawImg  (const f32 xpos, const f32 ypos, const GRRLIB_texImg *tex,
@@ -123,13 +313,29 @@ void  GRRLIB_DrawPart (const f32 xpos, const f32 ypos, const f32 partx, const f3
 
 void  GRRLIB_DrawTileQuad (const guVector pos[4], GRRLIB_texImg *tex, const u32 color, const int frame);
 
+uint  GRRLIB_DrawImgBatch (const GRRLIB_texImg *tex,
+                           const GRRLIB_sprite *sprites, const uint n);
+
 void  GRRLIB_Render  (void);
+void  GRRLIB_GetDrawStats (GRRLIB_drawStats *stats);
+bool  GRRLIB_SetPipelined (const bool enable);
+bool  GRRLIB_GetPipelined (void);
+void  GRRLIB_WaitFrames   (void);
 
 //------------------------------------------------------------------------------
 // GRRLIB_snapshot.c - Create a texture containing a snapshot of a part of the framebuffer
 void  GRRLIB_Screen2Texture (int posx, int posy, GRRLIB_texImg *tex, bool clear);
+u16   GRRLIB_Screen2TextureAsync (int posx, int posy, GRRLIB_texImg *tex, bool clear);
+bool  GRRLIB_CopyDone (const u16 token);
+void  GRRLIB_WaitCopy (const u16 token);
 void  GRRLIB_CompoStart (void);
 void  GRRLIB_CompoEnd(int posx, int posy, GRRLIB_texImg *tex);
+GRRLIB_renderTarget*  GRRLIB_CreateRenderTarget (const uint w, const uint h,
+                                                 const GRRLIB_texFormat format,
+                                                 const bool half);
+void  GRRLIB_FreeRenderTarget  (GRRLIB_renderTarget *rt);
+u16   GRRLIB_RenderTargetCopy  (GRRLIB_renderTarget *rt, int posx, int posy, bool clear);
+void  GRRLIB_TrimRenderTargets (void);
 
 //------------------------------------------------------------------------------
 // GRRLIB_texEdit.c - Modifying the content of a texture
@@ -138,6 +344,10 @@ GRRLIB_texImg*  GRRLIB_LoadTexturePNG (const u8 *my_png);
 GRRLIB_texImg*  GRRLIB_LoadTextureJPG (const u8 *my_jpg);
 GRRLIB_texImg*  GRRLIB_LoadTextureJPGEx (const u8 *my_jpg, const int);
 GRRLIB_texImg*  GRRLIB_LoadTextureBMP (const u8 *my_bmp);
+GRRLIB_texImg*  GRRLIB_ResizeTexture  (const GRRLIB_texImg *tex,
+                                       const uint w, const uint h,
+                                       const GRRLIB_filterMode filter);
+void            GRRLIB_PremultiplyTex (GRRLIB_texImg *tex);
 
 //------------------------------------------------------------------------------
 // GRRLIB_gecko.c - USB_Gecko output facilities
@@ -170,6 +380,27 @@ void GRRLIB_SetLightSpec(u8 num, guVector dir, f32 shy, u32 lightcolor, u32 spec
 void GRRLIB_SetLightSpot(u8 num, guVector pos, guVector lookat, f32 angAttn0, f32 angAttn1, f32 angAttn2, f32 distAttn0, f32 distAttn1, f32 distAttn2, u32 lightcolor);
 void GRRLIB_SetLightOff(void);
 
+//------------------------------------------------------------------------------
+// GRRLIB_tilemap.c - Tilemap rendering
+GRRLIB_tilemap*  GRRLIB_CreateTilemap    (GRRLIB_texImg *tileset,
+                                          const uint w, const uint h,
+                                          const uint layers);
+void             GRRLIB_FreeTilemap      (GRRLIB_tilemap *map);
+bool             GRRLIB_SetTilemapCache  (GRRLIB_tilemap *map, const uint chunk,
+                                          const u32 budget);
+void             GRRLIB_SetTile          (GRRLIB_tilemap *map, const uint layer,
+                                          const uint x, const uint y,
+                                          const u16 id);
+u16              GRRLIB_GetTile          (const GRRLIB_tilemap *map,
+                                          const uint layer,
+                                          const uint x, const uint y);
+void             GRRLIB_DrawTilemapLayer (GRRLIB_tilemap *map, const uint layer,
+                                          const f32 scrollx, const f32 scrolly,
+                                          const u32 color);
+void             GRRLIB_DrawTilemap      (GRRLIB_tilemap *map,
+                                          const f32 scrollx, const f32 scrolly,
+                                          const u32 color);
+
 //------------------------------------------------------------------------------
 // GRRLIB_ttf.c - FreeType function for GRRLIB
 GRRLIB_ttfFont* GRRLIB_LoadTTF(const u8* file_base, s32 file_size);
@@ -25,17 +25,21 @@ THE SOFTWARE.
  * Inline functions to control clipping.
  */
 
+extern  GRRLIB_drawSettings  GRRLIB_Settings;
+
 /**
  * Reset the clipping to normal.
+ * In dirty rectangle mode this is the dirty area.
  */
 INLINE
 void  GRRLIB_ClipReset (void) {
-    GX_SetClipMode( GX_CLIP_ENABLE );
-    GX_SetScissor( 0, 0, rmode->fbWidth, rmode->efbHeight );
+    GRRLIB_ClipDrawing( 0, 0, rmode->fbWidth, rmode->efbHeight );
 }
 
 /**
  * Clip the drawing area to an rectangle.
+ * Sprites entirely outside of it are not sent to GX at all. In dirty
+ * rectangle mode the rectangle is further cut to the dirty area.
  * @param x The x-coordinate of the rectangle.
  * @param y The y-coordinate of the rectangle.
  * @param width The width of the rectangle.
@@ -44,6 +48,25 @@ void  GRRLIB_ClipReset (void) {
 INLINE
 void  GRRLIB_ClipDrawing (const int x, const int y,
                           const int width, const int height) {
+    const GRRLIB_rect  *d = &GRRLIB_Settings.dirty;
+    int                x1 = x, y1 = y, x2 = x + width, y2 = y + height;
+
+    GRRLIB_FlushPrimitives();
+
+    if (GRRLIB_Settings.dirtyMode) {
+        if (x1 < d->x)                 x1 = d->x;
+        if (y1 < d->y)                 y1 = d->y;
+        if (x2 > d->x + (int)d->w)     x2 = d->x + d->w;
+        if (y2 > d->y + (int)d->h)     y2 = d->y + d->h;
+    }
+    if (x2 < x1)  x2 = x1;
+    if (y2 < y1)  y2 = y1;
+
     GX_SetClipMode( GX_CLIP_ENABLE );
-    GX_SetScissor( x, y, width, height );
+    GX_SetScissor( x1, y1, x2 - x1, y2 - y1 );
+
+    GRRLIB_Settings.clip.x = x1;
+    GRRLIB_Settings.clip.y = y1;
+    GRRLIB_Settings.clip.w = x2 - x1;
+    GRRLIB_Settings.clip.h = y2 - y1;
 }
@@ -46,14 +46,3 @@ INLINE
 void  GRRLIB_NGone (const guVector v[], const u32 color[], const long n) {
     GRRLIB_GXEngine(v, color, n, GX_LINESTRIP);
 }
-
-/**
- * Draw a filled polygon.
- * @param v The vector containing the coordinates of the polygon.
- * @param color The color of the filled polygon in RGBA format.
- * @param n Number of points in the vector.
- */
-INLINE
-void  GRRLIB_NGoneFilled (const guVector v[], const u32 color[], const long n) {
-    GRRLIB_GXEngine(v, color, n, GX_TRIANGLEFAN);
-}
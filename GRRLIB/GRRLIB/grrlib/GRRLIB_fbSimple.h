@@ -43,10 +43,9 @@ void  GRRLIB_FillScreen (const u32 color) {
  */
 INLINE
 void  GRRLIB_Plot (const f32 x,  const f32 y, const u32 color) {
-    GX_Begin(GX_POINTS, GX_VTXFMT0, 1);
-        GX_Position3f32(x, y, 0.0f);
-        GX_Color1u32(color);
-    GX_End();
+    const guVector  v = {x, y, 0.0f};
+
+    GRRLIB_BatchPrim(GX_POINTS, &v, &color, 1);
 }
 
 /**
@@ -61,12 +60,10 @@ void  GRRLIB_Plot (const f32 x,  const f32 y, const u32 color) {
 INLINE
 void  GRRLIB_Line (const f32 x1, const f32 y1,
                    const f32 x2, const f32 y2, const u32 color) {
-    GX_Begin(GX_LINES, GX_VTXFMT0, 2);
-        GX_Position3f32(x1, y1, 0.0f);
-        GX_Color1u32(color);
-        GX_Position3f32(x2, y2, 0.0f);
-        GX_Color1u32(color);
-    GX_End();
+    const guVector  v[2] = {{x1, y1, 0.0f}, {x2, y2, 0.0f}};
+    const u32       c[2] = {color, color};
+
+    GRRLIB_BatchPrim(GX_LINES, v, c, 2);
 }
 
 /**
@@ -84,31 +81,10 @@ void  GRRLIB_Rectangle (const f32 x,      const f32 y,
                         const u32 color, const bool filled) {
     f32 x2 = x + width;
     f32 y2 = y + height;
+    const guVector  v[5] = {{x, y, 0.0f}, {x2, y, 0.0f}, {x2, y2, 0.0f},
+                            {x, y2, 0.0f}, {x, y, 0.0f}};
+    const u32       c[5] = {color, color, color, color, color};
 
-    if (filled) {
-        GX_Begin(GX_QUADS, GX_VTXFMT0, 4);
-            GX_Position3f32(x, y, 0.0f);
-            GX_Color1u32(color);
-            GX_Position3f32(x2, y, 0.0f);
-            GX_Color1u32(color);
-            GX_Position3f32(x2, y2, 0.0f);
-            GX_Color1u32(color);
-            GX_Position3f32(x, y2, 0.0f);
-            GX_Color1u32(color);
-        GX_End();
-    }
-    else {
-        GX_Begin(GX_LINESTRIP, GX_VTXFMT0, 5);
-            GX_Position3f32(x, y, 0.0f);
-            GX_Color1u32(color);
-            GX_Position3f32(x2, y, 0.0f);
-            GX_Color1u32(color);
-            GX_Position3f32(x2, y2, 0.0f);
-            GX_Color1u32(color);
-            GX_Position3f32(x, y2, 0.0f);
-            GX_Color1u32(color);
-            GX_Position3f32(x, y, 0.0f);
-            GX_Color1u32(color);
-        GX_End();
-    }
+    if (filled)  GRRLIB_BatchPrim(GX_QUADS,     v, c, 4);
+    else         GRRLIB_BatchPrim(GX_LINESTRIP, v, c, 5);
 }
@@ -30,8 +30,45 @@ THE SOFTWARE.
 #define _SHIFTR(v, s, w)    \
     ((u32)(((u32)(v) >> (s)) & ((0x01 << (w)) - 1)))
 
+/**
+ * Multiply the red, green and blue components of a colour by its alpha.
+ * @param color The colour in RGBA format.
+ * @return The premultiplied colour in RGBA format.
+ */
+INLINE
+u32  GRRLIB_Premultiply (const u32 color) {
+    const u32  a = A(color);
+    u32        r, g, b;
+
+    if (a == 255)  return color;
+    r = R(color) * a + 128;  r = (r + (r >> 8)) >> 8;
+    g = G(color) * a + 128;  g = (g + (g >> 8)) >> 8;
+    b = B(color) * a + 128;  b = (b + (b >> 8)) >> 8;
+    return RGBA(r, g, b, a);
+}
+
+/**
+ * Divide the red, green and blue components of a colour by its alpha.
+ * @param color The premultiplied colour in RGBA format.
+ * @return The colour in RGBA format.
+ */
+INLINE
+u32  GRRLIB_Unpremultiply (const u32 color) {
+    const u32  a = A(color);
+    u32        r, g, b;
+
+    if (a == 255)  return color;
+    if (a == 0)    return 0;
+    r = (R(color) * 255 + (a >> 1)) / a;  if (r > 255)  r = 255;
+    g = (G(color) * 255 + (a >> 1)) / a;  if (g > 255)  g = 255;
+    b = (B(color) * 255 + (a >> 1)) / a;  if (b > 255)  b = 255;
+    return RGBA(r, g, b, a);
+}
+
 /**
  * Return the color value of a pixel from a GRRLIB_texImg.
+ * The colour of a premultiplied texture is returned unpremultiplied.
+ * Only GRRLIB_TEXFMT_RGBA8 textures can be read, others return 0.
  * @param x Specifies the x-coordinate of the pixel in the texture.
  * @param y Specifies the y-coordinate of the pixel in the texture.
  * @param tex The texture to get the color from.
@@ -44,14 +81,19 @@ u32  GRRLIB_GetPixelFromtexImg (const int x, const int y,
     register u32  ar;
     register u8*  bp = (u8*)tex->data;
 
+    if (tex->format != GRRLIB_TEXFMT_RGBA8)  return 0;
+
     offs = (((y&(~3))<<2)*tex->w) + ((x&(~3))<<4) + ((((y&3)<<2) + (x&3)) <<1);
 
     ar =                 (u32)(*((u16*)(bp+offs   )));
-    return (ar<<24) | ( ((u32)(*((u16*)(bp+offs+32)))) <<8) | (ar>>8);  // Wii is big-endian
+    ar = (ar<<24) | ( ((u32)(*((u16*)(bp+offs+32)))) <<8) | (ar>>8);  // Wii is big-endian
+    return tex->premult ? GRRLIB_Unpremultiply(ar) : ar;
 }
 
 /**
  * Set the color value of a pixel to a GRRLIB_texImg.
+ * The colour is premultiplied if the texture is.
+ * Only GRRLIB_TEXFMT_RGBA8 textures can be written, others are left as is.
  * @see GRRLIB_FlushTex
  * @param x Specifies the x-coordinate of the pixel in the texture.
  * @param y Specifies the y-coordinate of the pixel in the texture.
@@ -63,11 +105,14 @@ void  GRRLIB_SetPixelTotexImg (const int x, const int y,
                                GRRLIB_texImg *tex, const u32 color) {
     register u32  offs;
     register u8*  bp = (u8*)tex->data;
+    register u32  c  = tex->premult ? GRRLIB_Premultiply(color) : color;
+
+    if (tex->format != GRRLIB_TEXFMT_RGBA8)  return;
 
     offs = (((y&(~3))<<2)*tex->w) + ((x&(~3))<<4) + ((((y&3)<<2) + (x&3)) <<1);
 
-    *((u16*)(bp+offs   )) = (u16)((color <<8) | (color >>24));
-    *((u16*)(bp+offs+32)) = (u16) (color >>8);
+    *((u16*)(bp+offs   )) = (u16)((c <<8) | (c >>24));
+    *((u16*)(bp+offs+32)) = (u16) (c >>8);
 }
 
 /**
@@ -33,6 +33,7 @@ THE SOFTWARE.
 #define __GRRLIB_PRIVATE_H__
 
 #include <ogc/libversion.h>
+#include <grrlib.h>
 
 /**
  * Used for version checking.
@@ -42,6 +43,117 @@ THE SOFTWARE.
  */
 #define GRRLIB_VERSION(a,b,c) ((a)*65536+(b)*256+(c))
 
+//------------------------------------------------------------------------------
+// Compact 2D vertex format, set up by GRRLIB_Init and GRRLIB_2dMode
+#define GRRLIB_VTXFMT_S16  GX_VTXFMT1  /**< s16 x,y positions and u16 s,t texture coordinates. */
+#define GRRLIB_POS_FRAC    4           /**< Fractional bits of a position (1/16 pixel).   */
+#define GRRLIB_TEX_FRAC    15          /**< Fractional bits of a texture coordinate.      */
+#define GRRLIB_POS_MIN     (-2048.0f)  /**< Smallest position the format can hold.        */
+#define GRRLIB_POS_MAX     ( 2047.0f)  /**< Largest position the format can hold.         */
+
+/**
+ * Convert a position to the compact vertex format.
+ * @param v Position in pixels, between GRRLIB_POS_MIN and GRRLIB_POS_MAX.
+ * @return The fixed point position.
+ */
+static inline
+s16  GRRLIB_PosS16 (const f32 v) {
+    return (s16)(v * (1 << GRRLIB_POS_FRAC) + (v < 0.0f ? -0.5f : 0.5f));
+}
+
+/**
+ * Convert a texture coordinate to the compact vertex format.
+ * @param v Texture coordinate, between 0 and 1.
+ * @return The fixed point texture coordinate.
+ */
+static inline
+u16  GRRLIB_TexU16 (const f32 v) {
+    return (u16)(v * (1 << GRRLIB_TEX_FRAC) + 0.5f);
+}
+
+/**
+ * Check a set of x,y positions can use the compact vertex format.
+ * @param pos The positions.
+ * @param n Number of values in pos.
+ * @return true if every value is in range.
+ */
+static inline
+bool  GRRLIB_FitsS16 (const f32 *pos, const uint n) {
+    uint  i;
+
+    for (i = 0; i < n; i++)
+        if (pos[i] < GRRLIB_POS_MIN || pos[i] > GRRLIB_POS_MAX)  return false;
+    return true;
+}
+
+/**
+ * Get the vertex colour to draw a texture with.
+ * Premultiplied textures need a premultiplied colour to fade correctly,
+ * unless GRRLIB_SetPremultColor says the caller already did it.
+ * @param tex The texture being drawn.
+ * @param color Color in RGBA format.
+ * @return The colour to send to GX.
+ */
+static inline
+u32  GRRLIB_TexColor (const GRRLIB_texImg *tex, const u32 color) {
+    return (tex->premult && !GRRLIB_Settings.premultColor)
+           ? GRRLIB_Premultiply(color) : color;
+}
+
+//------------------------------------------------------------------------------
+// GRRLIB_bmfx.c - Bitmap f/x
+void GRRLIB_ReadTexRow  (const GRRLIB_texImg *tex, const int x, const int y,
+                         const uint n, u32 *row);
+void GRRLIB_WriteTexRow (GRRLIB_texImg *tex, const int x, const int y,
+                         const uint n, const u32 *row);
+
+//------------------------------------------------------------------------------
+// GRRLIB_core.c - GRRLIB core functions
+u16  GRRLIB_PutSync     (void);
+bool GRRLIB_SyncReached (const u16 token);
+void GRRLIB_DrawDone    (void);
+void GRRLIB_FifoSubmit  (void);
+uint GRRLIB_FifoQuads   (const uint quadSize);
+void GRRLIB_FifoListed  (const bool listed);
+void GRRLIB_FifoStats   (GRRLIB_drawStats *stats);
+
+//------------------------------------------------------------------------------
+// GRRLIB_fbBatch.c - Render to framebuffer: Batched primitives
+bool GRRLIB_CompactOK   (void);
+void GRRLIB_BatchMode2D (const bool mode2d);
+
+//------------------------------------------------------------------------------
+// GRRLIB_fbAdvanced.c - Render to framebuffer: Advanced primitives
+void GRRLIB_ExitShapes (void);
+
+//------------------------------------------------------------------------------
+// GRRLIB_queue.c - Deferred sprite queue
+void GRRLIB_ExitQueue (void);
+
+//------------------------------------------------------------------------------
+// GRRLIB_render.c - Rendering functions
+void GRRLIB_SinCos        (const f32 degrees, f32 *s, f32 *c);
+u8   GRRLIB_TexFmtGX      (const GRRLIB_texFormat format);
+void GRRLIB_BindTex       (const GRRLIB_texImg *tex, const uint w, const uint h);
+void GRRLIB_SetColorIndex (const u32 color);
+u32  GRRLIB_FrameNumber   (void);
+u32  GRRLIB_FrameDone     (void);
+void GRRLIB_SpriteCorners (const GRRLIB_texImg *tex,
+                           const f32 xpos, const f32 ypos,
+                           const f32 width, const f32 height,
+                           const f32 degrees,
+                           const f32 scaleX, const f32 scaleY, f32 pos[8]);
+bool GRRLIB_BoxVisible    (const f32 minx, const f32 miny,
+                           const f32 maxx, const f32 maxy,
+                           const GRRLIB_rect *clip);
+bool GRRLIB_QuadVisible   (const f32 pos[8], const GRRLIB_rect *clip);
+void* GRRLIB_SpareXfb     (void);
+void GRRLIB_ExitImgBatch  (void);
+
+//------------------------------------------------------------------------------
+// GRRLIB_snapshot.c - Create a texture containing a snapshot of a part of the framebuffer
+void GRRLIB_ExitRenderTargets (void);
+
 //------------------------------------------------------------------------------
 // GRRLIB_ttf.c - FreeType function for GRRLIB
 int GRRLIB_InitTTF();
@@ -42,6 +42,7 @@ extern  GRRLIB_drawSettings  GRRLIB_Settings;
  */
 INLINE
 void  GRRLIB_SetBlend (const GRRLIB_blendMode blendmode) {
+    GRRLIB_FlushPrimitives();
     GRRLIB_Settings.blend = blendmode;
     switch (GRRLIB_Settings.blend) {
         case GRRLIB_BLEND_ALPHA:
@@ -59,6 +60,9 @@ void  GRRLIB_SetBlend (const GRRLIB_blendMode blendmode) {
         case GRRLIB_BLEND_INV:
             GX_SetBlendMode(GX_BM_BLEND, GX_BL_INVSRCCLR, GX_BL_INVSRCCLR, GX_LO_CLEAR);
             break;
+        case GRRLIB_BLEND_PREMULT:
+            GX_SetBlendMode(GX_BM_BLEND, GX_BL_ONE, GX_BL_INVSRCALPHA, GX_LO_CLEAR);
+            break;
     }
 }
 
@@ -89,3 +93,107 @@ bool  GRRLIB_GetAntiAliasing (void) {
     return GRRLIB_Settings.antialias;
 }
 
+/**
+ * Premultiply the colours of the textures loaded from now on by their alpha.
+ * Premultiplied textures must be drawn with GRRLIB_BLEND_PREMULT. The colour
+ * passed to the draw functions stays in straight alpha, it is premultiplied
+ * when the texture is drawn so fades keep working, unless
+ * GRRLIB_SetPremultColor is enabled.
+ * @param premult Set to true to premultiply new textures (Default: Disabled).
+ */
+INLINE
+void  GRRLIB_SetPremultiply (const bool premult) {
+    GRRLIB_Settings.premultiply = premult;
+}
+
+/**
+ * Get current texture premultiplication setting.
+ * @return True if loaded textures are premultiplied.
+ */
+INLINE
+bool  GRRLIB_GetPremultiply (void) {
+    return GRRLIB_Settings.premultiply;
+}
+
+/**
+ * Pass the colour given to the draw functions as already premultiplied.
+ * This only applies to premultiplied textures. The colour is sent as is,
+ * so its alpha sets how much of the background is covered: RGBA(r, g, b, 0)
+ * adds the texture to the framebuffer, and alpha and additive sprites can
+ * share one batch with GRRLIB_BLEND_PREMULT. Fading must then scale the red,
+ * green, blue and alpha components together.
+ * @param premult Set to true to pass premultiplied colours (Default: Disabled).
+ */
+INLINE
+void  GRRLIB_SetPremultColor (const bool premult) {
+    GRRLIB_Settings.premultColor = premult;
+}
+
+/**
+ * Get current draw colour premultiplication setting.
+ * @return True if the draw colours are taken as premultiplied.
+ */
+INLINE
+bool  GRRLIB_GetPremultColor (void) {
+    return GRRLIB_Settings.premultColor;
+}
+
+/**
+ * Turn dirty rectangle mode on/off.
+ * In this mode the screen is not cleared by GRRLIB_Render: a frame starts
+ * with the image of the previous one and only the areas marked with
+ * GRRLIB_MarkDirty are drawn again. Drawing is clipped to those areas and
+ * sprites outside of them are skipped, so a mostly static screen can
+ * still issue all its draws for little cost. The first frame is entirely
+ * dirty.
+ * @param enable Set to true to only redraw the dirty areas (Default: Disabled).
+ */
+INLINE
+void  GRRLIB_SetDirtyMode (const bool enable) {
+    GRRLIB_Settings.dirtyMode = enable;
+    GRRLIB_Settings.dirty.x   = 0;
+    GRRLIB_Settings.dirty.y   = 0;
+    GRRLIB_Settings.dirty.w   = rmode->fbWidth;
+    GRRLIB_Settings.dirty.h   = rmode->efbHeight;
+    GRRLIB_ClipReset();
+}
+
+/**
+ * Get current dirty rectangle mode setting.
+ * @return True if only the dirty areas are redrawn.
+ */
+INLINE
+bool  GRRLIB_GetDirtyMode (void) {
+    return GRRLIB_Settings.dirtyMode;
+}
+
+/**
+ * Mark an area of the screen to be drawn again in dirty rectangle mode.
+ * Areas are merged into their bounding box, which becomes the clipping
+ * area. Mark them before drawing the frame, the dirty area is emptied by
+ * GRRLIB_Render.
+ * @param x The x-coordinate of the area.
+ * @param y The y-coordinate of the area.
+ * @param width The width of the area.
+ * @param height The height of the area.
+ */
+INLINE
+void  GRRLIB_MarkDirty (const int x, const int y,
+                        const int width, const int height) {
+    GRRLIB_rect  *d = &GRRLIB_Settings.dirty;
+    int          x1 = x, y1 = y, x2 = x + width, y2 = y + height;
+
+    if (width <= 0 || height <= 0)  return;
+
+    if (d->w != 0 && d->h != 0) {
+        if (x1 > d->x)                 x1 = d->x;
+        if (y1 > d->y)                 y1 = d->y;
+        if (x2 < d->x + (int)d->w)     x2 = d->x + d->w;
+        if (y2 < d->y + (int)d->h)     y2 = d->y + d->h;
+    }
+    d->x = x1;
+    d->y = y1;
+    d->w = x2 - x1;
+    d->h = y2 - y1;
+    GRRLIB_ClipReset();
+}
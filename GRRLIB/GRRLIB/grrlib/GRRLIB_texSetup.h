@@ -54,6 +54,22 @@ GRRLIB_texImg*  GRRLIB_CreateEmptyTexture (const uint w, const uint h)
     return my_texture;
 }
 
+/**
+ * Get the size of the pixel data of a texture.
+ * @param tex The texture.
+ * @return The size in bytes.
+ */
+INLINE
+uint  GRRLIB_TexDataSize (const GRRLIB_texImg *tex) {
+    switch (tex->format) {
+        case GRRLIB_TEXFMT_I8:      return tex->w * tex->h;
+        case GRRLIB_TEXFMT_RGB565:
+        case GRRLIB_TEXFMT_RGB5A3:
+        case GRRLIB_TEXFMT_IA8:     return tex->w * tex->h * 2;
+        default:                    return tex->w * tex->h * 4;
+    }
+}
+
 /**
  * Write the contents of a texture in the data cache down to main memory.
  * For performance the CPU holds a data cache where modifications are stored before they get written down to main memory.
@@ -61,7 +77,33 @@ GRRLIB_texImg*  GRRLIB_CreateEmptyTexture (const uint w, const uint h)
  */
 INLINE
 void  GRRLIB_FlushTex (GRRLIB_texImg *tex) {
-    DCFlushRange(tex->data, tex->w * tex->h * 4);
+    DCFlushRange(tex->data, GRRLIB_TexDataSize(tex));
+}
+
+/**
+ * Write a rectangle of a texture in the data cache down to main memory.
+ * Only the rows of 4x4 blocks covering the rectangle are flushed, which is
+ * much cheaper than GRRLIB_FlushTex when a small part of a big texture
+ * has been modified.
+ * @param tex The texture to flush.
+ * @param rect The modified area, in pixels.
+ */
+INLINE
+void  GRRLIB_FlushTexRect (GRRLIB_texImg *tex, const GRRLIB_rect *rect) {
+    const uint  bx0 = rect->x >> 2;
+    const uint  bx1 = (rect->x + rect->w + 3) >> 2;
+    const uint  by1 = (rect->y + rect->h + 3) >> 2;
+    uint        by  = rect->y >> 2;
+
+    if (bx0 == 0 && bx1 == (tex->w >> 2)) {
+        // Full width: the block rows are contiguous
+        DCFlushRange((u8*)tex->data + by * (tex->w << 4), (by1 - by) * (tex->w << 4));
+        return;
+    }
+    for (; by < by1; by++) {
+        DCFlushRange((u8*)tex->data + ((by * (tex->w >> 2) + bx0) << 6),
+                     (bx1 - bx0) << 6);
+    }
 }
 
 /**
@@ -83,6 +125,18 @@ void  GRRLIB_FreeTexture (GRRLIB_texImg *tex) {
  */
 INLINE
 void  GRRLIB_ClearTex(GRRLIB_texImg* tex) {
-    memset(tex->data, 0, (tex->h * tex->w) << 2);
+    memset(tex->data, 0, GRRLIB_TexDataSize(tex));
     GRRLIB_FlushTex(tex);
 }
+
+/**
+ * Mirror a texture when it is drawn, without touching its pixels.
+ * The texture coordinates are swapped by the render functions, so a single
+ * texture can be used for both orientations of a sprite.
+ * @param tex The texture to mirror.
+ * @param flip The mirroring to apply (Default: GRRLIB_FLIP_NONE).
+ */
+INLINE
+void  GRRLIB_SetFlip (GRRLIB_texImg *tex, const GRRLIB_flipMode flip) {
+    tex->flip = flip;
+}
@@ -30,6 +30,7 @@ void pngu_read_data_from_buffer (png_structp png_ptr, png_bytep data, png_size_t
 void pngu_write_data_to_buffer (png_structp png_ptr, png_bytep data, png_size_t length);
 void pngu_flush_data_to_buffer (png_structp png_ptr);
 int pngu_clamp (int value, int min, int max);
+PNGU_u8 * pngu_decode_4x4rgba8 (IMGCTX ctx, PNGU_u32 width, PNGU_u32 height, int * dstWidth, int * dstHeight, PNGU_u8 *dstPtr, int premultiply);
 
 
 // PNGU Image context struct
@@ -562,8 +563,18 @@ static inline PNGU_u32 coordsRGBA8(PNGU_u32 x, PNGU_u32 y, PNGU_u32 w)
 	return ((((y >> 2) * (w >> 2) + (x >> 2)) << 5) + ((y & 3) << 2) + (x & 3)) << 1;
 }
 
-// Coded by Tantric for WiiMC (http://www.wiimc.org)
 PNGU_u8 * PNGU_DecodeTo4x4RGBA8 (IMGCTX ctx, PNGU_u32 width, PNGU_u32 height, int * dstWidth, int * dstHeight, PNGU_u8 *dstPtr)
+{
+	return pngu_decode_4x4rgba8 (ctx, width, height, dstWidth, dstHeight, dstPtr, 0);
+}
+
+PNGU_u8 * PNGU_DecodeTo4x4RGBA8Premult (IMGCTX ctx, PNGU_u32 width, PNGU_u32 height, int * dstWidth, int * dstHeight, PNGU_u8 *dstPtr)
+{
+	return pngu_decode_4x4rgba8 (ctx, width, height, dstWidth, dstHeight, dstPtr, 1);
+}
+
+// Coded by Tantric for WiiMC (http://www.wiimc.org)
+PNGU_u8 * pngu_decode_4x4rgba8 (IMGCTX ctx, PNGU_u32 width, PNGU_u32 height, int * dstWidth, int * dstHeight, PNGU_u8 *dstPtr, int premultiply)
 {
 	PNGU_u8 default_alpha = 255;    // default alpha value, which is used if the source image doesn't have an alpha channel.
 	PNGU_u8 *dst;
@@ -619,10 +630,11 @@ PNGU_u8 * PNGU_DecodeTo4x4RGBA8 (IMGCTX ctx, PNGU_u32 width, PNGU_u32 height, in
 
 			if(y >= newHeight || x >= newWidth)
 			{
+				// Transparent padding, black once premultiplied
 				dst[offset] = 0;
-				dst[offset+1] = 255;
-				dst[offset+32] = 255;
-				dst[offset+33] = 255;
+				dst[offset+1] = premultiply ? 0 : 255;
+				dst[offset+32] = premultiply ? 0 : 255;
+				dst[offset+33] = premultiply ? 0 : 255;
 			}
 			else
 			{
@@ -641,9 +653,20 @@ PNGU_u8 * PNGU_DecodeTo4x4RGBA8 (IMGCTX ctx, PNGU_u32 width, PNGU_u32 height, in
 						pixel = &(ctx->row_pointers[y][x*4]);
 
 					dst[offset] = pixel[3]; // Alpha
-					dst[offset+1] = pixel[0]; // Red
-					dst[offset+32] = pixel[1]; // Green
-					dst[offset+33] = pixel[2]; // Blue
+					if (premultiply && pixel[3] != 255)
+					{
+						// Scale the colour by alpha: (c * a) / 255, rounded
+						PNGU_u32 t;
+						t = pixel[0] * pixel[3] + 128;  dst[offset+1] = (t + (t >> 8)) >> 8;
+						t = pixel[1] * pixel[3] + 128;  dst[offset+32] = (t + (t >> 8)) >> 8;
+						t = pixel[2] * pixel[3] + 128;  dst[offset+33] = (t + (t >> 8)) >> 8;
+					}
+					else
+					{
+						dst[offset+1] = pixel[0]; // Red
+						dst[offset+32] = pixel[1]; // Green
+						dst[offset+33] = pixel[2]; // Blue
+					}
 				}
 				else
 				{
@@ -153,6 +153,10 @@ int PNGU_DecodeTo4x4RGB5A3 (IMGCTX ctx, PNGU_u32 width, PNGU_u32 height, void *b
 // destination address.
 PNGU_u8 * PNGU_DecodeTo4x4RGBA8 (IMGCTX ctx, PNGU_u32 width, PNGU_u32 height, int * dstWidth, int * dstHeight, PNGU_u8 *dstPtr);
 
+// Same as PNGU_DecodeTo4x4RGBA8, but the colour channels are multiplied by the alpha channel
+// (premultiplied alpha) while the image is tiled.
+PNGU_u8 * PNGU_DecodeTo4x4RGBA8Premult (IMGCTX ctx, PNGU_u32 width, PNGU_u32 height, int * dstWidth, int * dstHeight, PNGU_u8 *dstPtr);
+
 // Encodes an YCbYCr image in PNG format and stores it in the selected device or memory buffer. You need to 
 // specify context, image dimensions, destination address and stride in pixels (stride = buffer width - image width).
 int PNGU_EncodeFromYCbYCr (IMGCTX ctx, PNGU_u32 width, PNGU_u32 height, void *buffer, PNGU_u32 stride);
@@ -34,9 +34,10 @@ int main() {
 
     GRRLIB_Settings.antialias = false;
 
-    GRRLIB_texImg *tex_screen[10];
+    // The screens hold no alpha: 16 bits per pixel is plenty
+    GRRLIB_renderTarget *tex_screen[10];
     for(i=0; i<10; i++) {
-        tex_screen[i] = GRRLIB_CreateEmptyTexture(rmode->fbWidth, rmode->efbHeight);
+        tex_screen[i] = GRRLIB_CreateRenderTarget(rmode->fbWidth, rmode->efbHeight, GRRLIB_TEXFMT_RGB565, false);
     }
 
     GRRLIB_texImg *tex_ball = GRRLIB_LoadTexture(ball);
@@ -63,9 +64,9 @@ int main() {
     while(1) {
         PAD_ScanPads();
 
-        GRRLIB_DrawImg(0, 0, tex_screen[screen_index], 0, 1, 1, 0xFFFFFFFF);
+        GRRLIB_DrawImg(0, 0, &tex_screen[screen_index]->tex, 0, 1, 1, 0xFFFFFFFF);
         GRRLIB_DrawImg(((R + r-ff)*cos(t-f) - d*cos(((R + r-f)/r)*t))+rmode->fbWidth/2-32, ((R + r-ff)*sin(t) - d*sin(((R + r)/r)*t)-f)+rmode->efbHeight/2-32, tex_ball, 1, 1, 1, 0xFFFFFFFF);
-        GRRLIB_Screen2Texture(0, 0, tex_screen[screen_index], GX_FALSE);
+        GRRLIB_RenderTargetCopy(tex_screen[screen_index], 0, 0, GX_FALSE);
         GRRLIB_Printf((640-(16*6*5))/2+5, 200+5, tex_font, 0x00000088, 5, "%06d",(int)spr);
         GRRLIB_Printf((640-(16*6*5))/2, 200, tex_font, 0xFFEEEE88, 5, "%06d",(int)spr);
 
@@ -93,7 +94,7 @@ int main() {
     GRRLIB_FreeTexture(tex_ball);
     GRRLIB_FreeTexture(tex_font);
     for(i=0; i<10; i++) {
-        GRRLIB_FreeTexture(tex_screen[i]);
+        GRRLIB_FreeRenderTarget(tex_screen[i]);
     }
     GRRLIB_Exit(); // Be a good boy, clear the memory allocated by GRRLIB
     return 0;